@@ -0,0 +1,138 @@
+#include "mockhost.hpp"
+#include <geany++/configschema.hpp>
+#include <geany++/pluginconfig.hpp>
+
+#ifdef HAVE_CONFIG_H
+#include <geany++/config.h>
+#endif
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+
+// default number of plugins loaded and iterations per benchmark
+#define DEFAULT_PLUGINS    10
+#define DEFAULT_ITERATIONS 100000
+
+using Bench::MockHost;
+
+namespace
+{
+
+	constexpr Geany::ConfigKey<int> BENCH_VALUE{ "bench", "value", 42 };
+
+	struct BenchSettings : public Geany::ConfigSchema
+	{
+		Geany::ConfigValue<int> value;
+
+		BenchSettings(Geany::PluginConfig &config)
+			: ConfigSchema(config), value(*this, BENCH_VALUE)
+		{
+		}
+	};
+
+	// runs @a func @a iterations times and prints the time per call
+	void run(const char *name, size_t iterations, const std::function<void()> &func)
+	{
+		typedef std::chrono::steady_clock clock;
+		// warm up caches and any lazily created state first
+		for (size_t i = 0; i < iterations / 100 + 1; i++)
+			func();
+		auto start = clock::now();
+		for (size_t i = 0; i < iterations; i++)
+			func();
+		auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(clock::now() - start);
+		std::printf("%-40s %12.1f ns/op %10zu ops\n", name,
+			double(elapsed.count()) / iterations, iterations);
+	}
+
+	void usage(const char *prog)
+	{
+		std::fprintf(stderr,
+			"usage: %s [-p PLUGINS] [-n ITERATIONS] PLUGIN_MODULE\n", prog);
+		std::exit(EXIT_FAILURE);
+	}
+
+}
+
+int main(int argc, char **argv)
+{
+	size_t n_plugins = DEFAULT_PLUGINS;
+	size_t iterations = DEFAULT_ITERATIONS;
+	const char *module = nullptr;
+
+	for (int i = 1; i < argc; i++)
+	{
+		if (std::strcmp(argv[i], "-p") == 0 && i + 1 < argc)
+			n_plugins = std::strtoul(argv[++i], nullptr, 10);
+		else if (std::strcmp(argv[i], "-n") == 0 && i + 1 < argc)
+			iterations = std::strtoul(argv[++i], nullptr, 10);
+		else if (argv[i][0] != '-' && !module)
+			module = argv[i];
+		else
+			usage(argv[0]);
+	}
+	if (!module || iterations == 0)
+		usage(argv[0]);
+
+	MockHost host;
+	size_t loaded = host.load_plugins(module, n_plugins);
+	if (loaded != n_plugins)
+	{
+		std::fprintf(stderr, "only %zu of %zu plugins loaded\n", loaded, n_plugins);
+		return EXIT_FAILURE;
+	}
+	std::printf("%zu plugins, %zu iterations\n\n", loaded, iterations);
+
+	GeanyDocument *doc = host.open_document("/tmp/bench.c",
+		"int main(void)\n{\n\treturn 0;\n}\n");
+
+	run("editor-notify SCN_UPDATEUI", iterations, [&]() {
+		host.notify(doc, SCN_UPDATEUI);
+	});
+
+	run("editor-notify SCN_PAINTED (unhandled)", iterations, [&]() {
+		host.notify(doc, SCN_PAINTED);
+	});
+
+	size_t pos = 0;
+	run("insert and delete a character", iterations, [&]() {
+		host.insert_text(doc, pos, "x");
+		host.delete_text(doc, pos, 1);
+		pos = (pos + 7) % host.text(doc).size();
+	});
+
+	run("document open and close", iterations / 10, [&]() {
+		GeanyDocument *d = host.open_document("/tmp/bench2.c", "int x;\n");
+		host.close_document(d);
+	});
+
+	run("document activate", iterations, [&]() {
+		host.activate_document(doc);
+	});
+
+	Geany::PluginConfig &config = host.plugins().front()->config;
+	config.keyfile().set_integer(BENCH_VALUE.group, BENCH_VALUE.name, 42);
+	BenchSettings settings(config);
+	volatile int sink = 0;
+
+	config.begin_group(BENCH_VALUE.group);
+	run("PluginConfig::get<int>", iterations, [&]() {
+		sink = sink + config.get<int>(BENCH_VALUE.name);
+	});
+	config.end_group();
+
+	run("ConfigValue<int>::get", iterations, [&]() {
+		sink = sink + settings.value.get();
+	});
+
+	int value = 0;
+	run("ConfigValue<int>::set", iterations / 10, [&]() {
+		settings.value.set(value++);
+	});
+	config.flush();
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,40 @@
+#include <geany++/iplugin.hpp>
+#include <geany++/document.hpp>
+#include <geany++/editor.hpp>
+
+#ifdef HAVE_CONFIG_H
+#include <geany++/config.h>
+#endif
+
+// A plugin doing about the least a real plugin does with each document,
+// so the benchmarks measure the framework's dispatch and not the plugin.
+struct BenchPlugin final : public Geany::IPlugin
+{
+	unsigned long updates;
+	unsigned long modifications;
+
+	BenchPlugin(Geany::PluginData &init_data)
+		: Geany::IPlugin(init_data),
+		  updates(0),
+		  modifications(0)
+	{
+	}
+
+	void document_open(Geany::Document &doc) override
+	{
+		Geany::Editor *editor = doc.editor();
+		editor->signal_update_ui().connect([this](const SCNotification&) {
+			updates++;
+			return false;
+		});
+		editor->signal_modified().connect([this](const SCNotification &nt) {
+			if (nt.modificationType & (SC_MOD_INSERTTEXT | SC_MOD_DELETETEXT))
+				modifications++;
+			return false;
+		});
+		IPlugin::document_open(doc);
+	}
+};
+
+
+GEANYCPP_DEFINE_PLUGIN(BenchPlugin);
@@ -0,0 +1,131 @@
+#include "mockhost.hpp"
+#include <geany++/completion.hpp>
+#include <geany++/diagnostics.hpp>
+
+#ifdef HAVE_CONFIG_H
+#include <geany++/config.h>
+#endif
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <thread>
+
+// how long to wait for work handed to the worker threads
+#define WAIT_MSEC 5000
+
+using Bench::MockHost;
+
+namespace
+{
+
+	int failures = 0;
+
+	void check(bool ok, const char *what)
+	{
+		std::printf("%s: %s\n", ok ? "ok" : "FAIL", what);
+		if (!ok)
+			failures++;
+	}
+
+	// runs the host's main loop until @a done or the time is up
+	bool wait_for(MockHost &host, const std::function<bool()> &done)
+	{
+		auto deadline = std::chrono::steady_clock::now() +
+			std::chrono::milliseconds(WAIT_MSEC);
+		while (!done())
+		{
+			if (std::chrono::steady_clock::now() > deadline)
+				return false;
+			host.run_pending();
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		}
+		return true;
+	}
+
+	struct Words : public Geany::CompletionProvider
+	{
+		std::atomic<int> calls;
+
+		Words(Geany::IPlugin &plugin)
+			: CompletionProvider(plugin),
+			  calls(0)
+		{
+		}
+
+		void complete(const Geany::CompletionContext &ctx,
+			std::vector<Geany::CompletionItem> &items) override
+		{
+			items.emplace_back(ctx.prefix + "_word");
+			calls++;
+		}
+	};
+
+	// types a word at the start of @a doc, like Scintilla notifies it
+	void type_word(MockHost &host, GeanyDocument *doc, const std::string &word)
+	{
+		host.insert_text(doc, 0, word);
+		host.send_message(doc->editor->sci, SCI_GOTOPOS, word.size(), 0);
+		SCNotification nt;
+		std::memset(&nt, 0, sizeof(nt));
+		nt.nmhdr.code = SCN_CHARADDED;
+		nt.ch = word.back();
+		host.notify(doc, nt);
+	}
+
+	// the only plugin never touches the editors, so completion must
+	// not depend on some plugin having wrapped them
+	void check_completion(MockHost &host)
+	{
+		Geany::IPlugin &plugin = *host.plugins().front()->plugin;
+		GeanyDocument *before = host.open_document("/tmp/check-before.c", "");
+		Words words(plugin);
+		GeanyDocument *after = host.open_document("/tmp/check-after.c", "");
+
+		type_word(host, before, "abc");
+		check(wait_for(host, [&]() { return words.calls == 1; }),
+			"completion on a document opened before the provider");
+		type_word(host, after, "abc");
+		check(wait_for(host, [&]() { return words.calls == 2; }),
+			"completion on a document opened after the provider");
+
+		words.remove();
+		host.close_document(after);
+		host.close_document(before);
+	}
+
+	// MSBuild project prefixes, one without a line after it at the very
+	// end of the output
+	void check_diagnostics()
+	{
+		Geany::Build::DiagnosticStore store;
+		Geany::Build::DiagnosticParser parser(store, "/tmp");
+		parser.feed("1>a.c:1:2: error: one\n3>\n12>b.c:3: warning: two\n3>");
+		parser.finish();
+		parser.parse_all();
+		check(store.list().size() == 2, "MSBuild prefixed diagnostics");
+		check(store.list().size() == 2 && store.list()[1].line == 3,
+			"a line with only an MSBuild prefix");
+	}
+
+}
+
+int main(int argc, char **argv)
+{
+	const char *module = (argc > 1) ? argv[1] : CHECK_PLUGIN;
+
+	MockHost host;
+	if (host.load_plugins(module, 1) != 1)
+	{
+		std::fprintf(stderr, "unable to load %s\n", module);
+		return EXIT_FAILURE;
+	}
+
+	check_completion(host);
+	check_diagnostics();
+
+	return (failures == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,18 @@
+#include <geany++/iplugin.hpp>
+
+#ifdef HAVE_CONFIG_H
+#include <geany++/config.h>
+#endif
+
+// A plugin which does nothing, so the checks see the framework on its
+// own, e.g. with editors no plugin has wrapped.
+struct CheckPlugin final : public Geany::IPlugin
+{
+	CheckPlugin(Geany::PluginData &init_data)
+		: Geany::IPlugin(init_data)
+	{
+	}
+};
+
+
+GEANYCPP_DEFINE_PLUGIN(CheckPlugin);
@@ -0,0 +1,3 @@
+// The proxy plugin is normally a module Geany loads, the benchmarks build
+// it into the program so the mock host can call it directly.
+#include "../geany++/proxy.cpp"
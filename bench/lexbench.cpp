@@ -0,0 +1,264 @@
+#include "mockhost.hpp"
+#include <geany++/containerlexer.hpp>
+#include <geany++/editor.hpp>
+
+#ifdef HAVE_CONFIG_H
+#include <geany++/config.h>
+#endif
+
+#include <cctype>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <string>
+
+// default size of the generated file and number of edits timed
+#define DEFAULT_LINES  1000000
+#define DEFAULT_EDITS  100
+
+// lines on screen, what Scintilla asks to have styled after an edit
+#define VIEWPORT_LINES 60
+
+// lines styled per ContainerLexer::style_ahead() call, as when idle
+#define LOOK_AHEAD_LINES 1024
+
+using Bench::MockHost;
+using Geany::Scintilla;
+
+namespace
+{
+
+	enum
+	{
+		CLIKE_DEFAULT,
+		CLIKE_COMMENT,
+		CLIKE_NUMBER,
+		CLIKE_STRING,
+		CLIKE_IDENTIFIER
+	};
+
+	enum
+	{
+		STATE_CODE,
+		STATE_COMMENT
+	};
+
+	// a C-like language with block comments, the only state carried
+	// from one line to the next
+	class CLikeLexer : public Geany::ContainerLexer
+	{
+	protected:
+		int lex_line(const char *text, size_t length, int state,
+			Geany::StyleWriter &styles) override
+		{
+			size_t i = 0;
+			while (i < length)
+			{
+				char c = text[i];
+				if (state == STATE_COMMENT)
+				{
+					while (i < length && !(text[i] == '*' && i + 1 < length && text[i + 1] == '/'))
+						i++;
+					if (i < length)
+					{
+						i += 2;
+						state = STATE_CODE;
+					}
+					styles.style_to(i, CLIKE_COMMENT);
+				}
+				else if (c == '/' && i + 1 < length && text[i + 1] == '*')
+				{
+					i += 2;
+					state = STATE_COMMENT;
+				}
+				else if (c == '"')
+				{
+					i++;
+					while (i < length && text[i] != '"' && text[i] != '\n')
+						i += text[i] == '\\' ? 2 : 1;
+					i = std::min(i + 1, length);
+					styles.style_to(i, CLIKE_STRING);
+				}
+				else if (std::isdigit(static_cast<unsigned char>(c)))
+				{
+					while (i < length && std::isalnum(static_cast<unsigned char>(text[i])))
+						i++;
+					styles.style_to(i, CLIKE_NUMBER);
+				}
+				else if (std::isalpha(static_cast<unsigned char>(c)) || c == '_')
+				{
+					while (i < length && (std::isalnum(static_cast<unsigned char>(text[i])) || text[i] == '_'))
+						i++;
+					styles.style_to(i, CLIKE_IDENTIFIER);
+				}
+				else
+				{
+					i++;
+					styles.style_to(i, CLIKE_DEFAULT);
+				}
+			}
+			return state;
+		}
+	};
+
+	std::string generate(size_t n_lines)
+	{
+		std::string text;
+		text.reserve(n_lines * 32);
+		char line[128];
+		for (size_t i = 0; i < n_lines; i++)
+		{
+			if (i % 1000 == 10)
+				std::snprintf(line, sizeof(line), "/* block comment %zu\n", i);
+			else if (i % 1000 == 13)
+				std::snprintf(line, sizeof(line), "   ends here */\n");
+			else if (i % 7 == 0)
+				std::snprintf(line, sizeof(line), "\tputs(\"line %zu\");\n", i);
+			else
+				std::snprintf(line, sizeof(line), "\tint value_%zu = %zu;\n", i, i * 31);
+			text += line;
+		}
+		return text;
+	}
+
+	// returns the time @a func took in milliseconds
+	double time_ms(const std::function<void()> &func)
+	{
+		typedef std::chrono::steady_clock clock;
+		auto start = clock::now();
+		func();
+		return std::chrono::duration<double, std::milli>(clock::now() - start).count();
+	}
+
+	class LexBench
+	{
+	public:
+		LexBench(MockHost &host, GeanyDocument *doc, CLikeLexer &lexer)
+			: m_host(host), m_doc(doc), m_lexer(lexer)
+		{
+		}
+
+		int line_start(size_t line)
+		{
+			return scintilla_send_message(m_doc->editor->sci, SCI_POSITIONFROMLINE, line, 0);
+		}
+
+		// what Scintilla sends when painting lines up to @a last_line
+		double style_needed(size_t last_line)
+		{
+			SCNotification nt;
+			std::memset(&nt, 0, sizeof(nt));
+			nt.nmhdr.code = SCN_STYLENEEDED;
+			nt.position = line_start(last_line + 1);
+			return time_ms([&]() { m_host.notify(m_doc, nt); });
+		}
+
+		// edits @a n_edits lines from @a first_line on with @a edit,
+		// restyling the screen after each, then prints the average
+		void run_edits(const char *name, size_t first_line, size_t n_edits,
+			const std::function<void(size_t)> &edit)
+		{
+			double total = 0;
+			m_lexer.reset_stats();
+			for (size_t i = 0; i < n_edits; i++)
+			{
+				size_t line = first_line + i * 3;
+				edit(line);
+				total += style_needed(line + VIEWPORT_LINES);
+			}
+			print(name, total / n_edits, n_edits);
+		}
+
+		void print(const char *name, double ms, size_t n = 1)
+		{
+			const Geany::ContainerLexer::Stats &stats = m_lexer.stats();
+			std::printf("%-44s %12.3f ms %12.1f lines %8.1f runs\n", name, ms,
+				double(stats.lines_lexed) / n, double(stats.style_runs) / n);
+			m_lexer.reset_stats();
+		}
+
+	private:
+		MockHost &m_host;
+		GeanyDocument *m_doc;
+		CLikeLexer &m_lexer;
+	};
+
+	void usage(const char *prog)
+	{
+		std::fprintf(stderr, "usage: %s [-l LINES] [-e EDITS]\n", prog);
+		std::exit(EXIT_FAILURE);
+	}
+
+}
+
+int main(int argc, char **argv)
+{
+	size_t n_lines = DEFAULT_LINES;
+	size_t n_edits = DEFAULT_EDITS;
+
+	for (int i = 1; i < argc; i++)
+	{
+		if (std::strcmp(argv[i], "-l") == 0 && i + 1 < argc)
+			n_lines = std::strtoul(argv[++i], nullptr, 10);
+		else if (std::strcmp(argv[i], "-e") == 0 && i + 1 < argc)
+			n_edits = std::strtoul(argv[++i], nullptr, 10);
+		else
+			usage(argv[0]);
+	}
+	if (n_lines < 2 * n_edits * 3 + VIEWPORT_LINES)
+		usage(argv[0]);
+
+	MockHost host;
+	GeanyDocument *doc = host.open_document("/tmp/lexbench.txt", generate(n_lines),
+		host.filetype("None"));
+	Geany::Document *document = host.proxy().documents.lookup(doc);
+	Scintilla &sci = *document->editor();
+	std::printf("%zu lines, %zu bytes, %zu edits\n\n", n_lines,
+		host.text(doc).size(), n_edits);
+
+	CLikeLexer lexer;
+	LexBench bench(host, doc, lexer);
+	lexer.attach(sci);
+
+	bench.print("first screen", bench.style_needed(VIEWPORT_LINES));
+	bench.print("jump to the end of the file", bench.style_needed(n_lines - 1));
+
+	size_t middle = n_lines / 2;
+	bench.run_edits("type a character, restyle the screen", middle, n_edits,
+		[&](size_t line) {
+			host.insert_text(doc, bench.line_start(line) + 5, "x");
+		});
+	bench.run_edits("open a block comment, restyle the screen", middle, n_edits,
+		[&](size_t line) {
+			host.insert_text(doc, bench.line_start(line), "/*");
+		});
+	bench.run_edits("close it again", middle, n_edits,
+		[&](size_t line) {
+			host.delete_text(doc, bench.line_start(line), 2);
+		});
+
+	// with look-ahead the file is lexed while idle, a jump then finds
+	// its lines styled
+	lexer.invalidate(0);
+	bench.print("lex the whole file ahead", time_ms([&]() {
+		while (lexer.style_ahead(LOOK_AHEAD_LINES))
+			;
+	}));
+	bench.print("jump to the end after lexing ahead", bench.style_needed(n_lines - 1));
+
+	// what a lexer without the framework does on every edit: restyle
+	// from the top of the file with a message per character, only the
+	// messages are timed here
+	lexer.detach();
+	int end = bench.line_start(middle + VIEWPORT_LINES);
+	double naive = time_ms([&]() {
+		sci.start_styling(0, 0xff);
+		for (int pos = 0; pos < end; pos++)
+			sci.set_styling(1, CLIKE_DEFAULT);
+	});
+	std::printf("%-44s %12.3f ms\n", "SCI_SETSTYLING per character to the middle", naive);
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,1138 @@
+#include "mockhost.hpp"
+
+#ifdef HAVE_CONFIG_H
+#include <geany++/config.h>
+#endif
+
+#include <glib/gstdio.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cstdarg>
+#include <cstring>
+#include <stdexcept>
+
+// the proxy plugin's module entry point and callbacks, linked into the
+// benchmark program rather than loaded
+extern "C" void geany_load_module(GeanyPlugin *plugin);
+
+namespace Bench
+{
+
+	static MockHost *g_host = nullptr;
+
+	struct MockHost::Buffer
+	{
+		GeanyEditor *editor;
+		std::string text;
+		size_t caret;
+		size_t anchor;
+		bool modified;
+		bool readonly;
+		int lexer;
+		std::vector<size_t> line_starts;
+		bool lines_valid;
+		// one byte per character like Scintilla's style buffer
+		std::string styles;
+		std::vector<int> line_states;
+		size_t end_styled;
+		size_t styling_pos;
+
+		Buffer(GeanyEditor *editor)
+			: editor(editor), caret(0), anchor(0), modified(false),
+			  readonly(false), lexer(0), lines_valid(false), end_styled(0),
+			  styling_pos(0)
+		{
+		}
+
+		const std::vector<size_t> &lines()
+		{
+			if (!lines_valid)
+			{
+				line_starts.clear();
+				line_starts.push_back(0);
+				for (size_t i = 0; i < text.size(); i++)
+				{
+					if (text[i] == '\n')
+						line_starts.push_back(i + 1);
+				}
+				lines_valid = true;
+			}
+			return line_starts;
+		}
+
+		size_t line_from_position(size_t pos)
+		{
+			auto &starts = lines();
+			auto it = std::upper_bound(starts.begin(), starts.end(), pos);
+			return (it - starts.begin()) - 1;
+		}
+
+		size_t line_start(size_t line)
+		{
+			auto &starts = lines();
+			return line < starts.size() ? starts[line] : text.size();
+		}
+
+		size_t line_end(size_t line)
+		{
+			auto &starts = lines();
+			if (line + 1 < starts.size())
+				return starts[line + 1] - 1;
+			return text.size();
+		}
+
+		size_t clamp(intptr_t pos) const
+		{
+			if (pos < 0)
+				return 0;
+			return std::min(static_cast<size_t>(pos), text.size());
+		}
+
+		// line states move with their lines like in Scintilla, a split
+		// line's new part starts with the state of the line it came from
+		void insert_line_states(size_t line, size_t count)
+		{
+			if (count > 0 && line < line_states.size())
+				line_states.insert(line_states.begin() + line + 1, count, line_states[line]);
+		}
+
+		void remove_line_states(size_t line, size_t count)
+		{
+			if (line + 1 >= line_states.size())
+				return;
+			count = std::min(count, line_states.size() - line - 1);
+			line_states.erase(line_states.begin() + line + 1,
+				line_states.begin() + line + 1 + count);
+		}
+
+		void styles_changed(size_t pos)
+		{
+			end_styled = std::min(end_styled, pos);
+		}
+	};
+
+	static int count_lines(const char *text, size_t length)
+	{
+		return std::count(text, text + length, '\n');
+	}
+
+	// Geany's more common filetypes, names as in filetype_extensions.conf
+	// so recorded sessions find theirs, index 0 is "None" like in Geany
+	static const struct MockFiletype
+	{
+		const char *name;
+		const char *extension;
+		const char *pattern;
+	}
+	mock_filetypes[] =
+	{
+		{ "None", "", "*" },
+		{ "C", "c", "*.c" },
+		{ "C++", "cpp", "*.cpp" },
+		{ "CSS", "css", "*.css" },
+		{ "Conf", "conf", "*.conf" },
+		{ "Go", "go", "*.go" },
+		{ "HTML", "html", "*.html" },
+		{ "Java", "java", "*.java" },
+		{ "Javascript", "js", "*.js" },
+		{ "Make", "mak", "Makefile*" },
+		{ "Markdown", "md", "*.md" },
+		{ "PHP", "php", "*.php" },
+		{ "Python", "py", "*.py" },
+		{ "Rust", "rs", "*.rs" },
+		{ "Sh", "sh", "*.sh" },
+		{ "XML", "xml", "*.xml" },
+	};
+
+	static GeanyFiletype *new_filetype(int id, const char *name,
+		const char *extension, const char *pattern)
+	{
+		auto ft = g_new0(GeanyFiletype, 1);
+		ft->id = static_cast<GeanyFiletypeID>(id);
+		ft->name = g_strdup(name);
+		ft->title = g_strdup_printf("%s file", name);
+		ft->extension = g_strdup(extension);
+		ft->pattern = g_new0(gchar*, 2);
+		ft->pattern[0] = g_strdup(pattern);
+		return ft;
+	}
+
+	MockHost::MockHost()
+		: m_proxy_plugin(nullptr),
+		  m_proxy_data(nullptr),
+		  m_current(nullptr),
+		  m_next_doc_id(1),
+		  m_registered_data(nullptr),
+		  m_quiet(false)
+	{
+		if (g_host)
+			throw std::logic_error("only one MockHost can exist at a time");
+
+		gchar *dir = g_dir_make_tmp("geany++-bench-XXXXXX", nullptr);
+		if (!dir)
+			throw std::runtime_error("unable to create a temporary directory");
+		m_config_dir = dir;
+		g_free(dir);
+
+		std::memset(&m_data, 0, sizeof(m_data));
+		std::memset(&m_app, 0, sizeof(m_app));
+		std::memset(&m_widgets, 0, sizeof(m_widgets));
+		std::memset(&m_project, 0, sizeof(m_project));
+
+		m_app.configdir = const_cast<gchar*>(m_config_dir.c_str());
+		m_data.app = &m_app;
+		m_data.main_widgets = &m_widgets;
+		m_data.documents_array = g_ptr_array_new();
+		m_data.filetypes_array = g_ptr_array_new();
+		m_data.template_prefs = g_new0(GeanyTemplatePrefs, 1);
+		m_data.template_prefs->developer = g_strdup("");
+		m_data.template_prefs->company = g_strdup("");
+		m_data.template_prefs->mail = g_strdup("");
+		m_data.template_prefs->initials = g_strdup("");
+		m_data.template_prefs->version = g_strdup("");
+
+		for (size_t i = 0; i < G_N_ELEMENTS(mock_filetypes); i++)
+		{
+			const MockFiletype &ft = mock_filetypes[i];
+			g_ptr_array_add(m_data.filetypes_array,
+				new_filetype(i, ft.name, ft.extension, ft.pattern));
+		}
+
+		g_host = this;
+
+		m_proxy_plugin = new_plugin();
+		geany_load_module(m_proxy_plugin);
+		if (!m_proxy_plugin->funcs->init ||
+			!m_proxy_plugin->funcs->init(m_proxy_plugin, nullptr))
+		{
+			g_host = nullptr;
+			throw std::runtime_error("the proxy plugin failed to initialize");
+		}
+		m_proxy_data = m_registered_data;
+	}
+
+	MockHost::~MockHost()
+	{
+		unload_plugins();
+		close_project();
+		close_all();
+		run_pending();
+
+		if (m_proxy_plugin->funcs->cleanup)
+			m_proxy_plugin->funcs->cleanup(m_proxy_plugin, m_proxy_data);
+		free_plugin(m_proxy_plugin);
+		m_handlers.clear();
+
+		for (guint i = 0; i < m_data.documents_array->len; i++)
+			g_free(m_data.documents_array->pdata[i]);
+		g_ptr_array_free(m_data.documents_array, TRUE);
+		for (guint i = 0; i < m_data.filetypes_array->len; i++)
+		{
+			auto ft = static_cast<GeanyFiletype*>(m_data.filetypes_array->pdata[i]);
+			g_free(ft->name);
+			g_free(ft->title);
+			g_free(ft->extension);
+			g_strfreev(ft->pattern);
+			g_free(ft);
+		}
+		g_ptr_array_free(m_data.filetypes_array, TRUE);
+		g_free(m_data.template_prefs->developer);
+		g_free(m_data.template_prefs->company);
+		g_free(m_data.template_prefs->mail);
+		g_free(m_data.template_prefs->initials);
+		g_free(m_data.template_prefs->version);
+		g_free(m_data.template_prefs);
+
+		for (auto &fn : m_spec_files)
+			g_unlink(fn.c_str());
+		for (auto &fn : m_spec_files)
+			g_unlink(Geany::replace_extension(fn, MODULE_EXTENSION).c_str());
+		std::string plugins_dir = Glib::build_filename(m_config_dir, "plugins");
+		// plugin config files, best effort
+		Glib::Dir dir(plugins_dir);
+		for (auto name : dir)
+		{
+			std::string sub = Glib::build_filename(plugins_dir, name);
+			if (Glib::file_test(sub, Glib::FILE_TEST_IS_DIR))
+			{
+				Glib::Dir subdir(sub);
+				for (auto file : subdir)
+					g_unlink(Glib::build_filename(sub, file).c_str());
+			}
+			g_rmdir(sub.c_str());
+		}
+		g_rmdir(plugins_dir.c_str());
+		g_rmdir(m_config_dir.c_str());
+
+		g_host = nullptr;
+	}
+
+	MockHost *MockHost::instance()
+	{
+		return g_host;
+	}
+
+	GeanyPlugin *MockHost::new_plugin()
+	{
+		auto plugin = g_new0(GeanyPlugin, 1);
+		plugin->info = g_new0(GeanyPluginInfo, 1);
+		plugin->funcs = g_new0(GeanyPluginFuncs, 1);
+		plugin->proxy_funcs = g_new0(GeanyProxyFuncs, 1);
+		plugin->geany_data = &m_data;
+		return plugin;
+	}
+
+	void MockHost::free_plugin(GeanyPlugin *plugin)
+	{
+		g_free(plugin->info);
+		g_free(plugin->funcs);
+		g_free(plugin->proxy_funcs);
+		g_free(plugin);
+	}
+
+	void MockHost::register_plugin(GeanyPlugin*, gpointer pdata, GDestroyNotify)
+	{
+		m_registered_data = pdata;
+	}
+
+	size_t MockHost::load_plugins(const std::string &module, size_t count)
+	{
+		auto probe = m_proxy_plugin->proxy_funcs->probe;
+		auto load = m_proxy_plugin->proxy_funcs->load;
+		if (!probe || !load)
+			throw std::runtime_error("the proxy didn't register as a proxy");
+
+		size_t loaded = 0;
+		for (size_t i = 0; i < count; i++)
+		{
+			// the proxy finds the module next to the .plugin file
+			std::string base = Glib::build_filename(m_config_dir,
+				"bench-" + std::to_string(m_spec_files.size()));
+			std::string spec = base + SPEC_EXTENSION;
+			std::string so = base + MODULE_EXTENSION;
+			std::string contents = "[" GROUP_NAME "]\nname=Bench " +
+				std::to_string(m_spec_files.size()) + "\n";
+			if (!g_file_set_contents(spec.c_str(), contents.c_str(), -1, nullptr) ||
+				symlink(module.c_str(), so.c_str()) != 0)
+			{
+				throw std::runtime_error("unable to set up plugin " + spec);
+			}
+			m_spec_files.push_back(spec);
+
+			if (probe(m_proxy_plugin, spec.c_str(), m_proxy_data) == PROXY_IGNORED)
+				continue;
+
+			GeanyPlugin *plugin = new_plugin();
+			m_registered_data = nullptr;
+			gpointer load_data = load(m_proxy_plugin, plugin, spec.c_str(), m_proxy_data);
+			if (!load_data)
+			{
+				free_plugin(plugin);
+				continue;
+			}
+
+			bool ok = plugin->funcs->init && plugin->funcs->init(plugin, m_registered_data);
+			m_loaded.push_back(LoadedPlugin{ plugin, load_data, ok });
+			if (ok)
+			{
+				m_plugin_data.push_back(Geany::PluginData::from_data(m_registered_data));
+				loaded++;
+			}
+		}
+		// let the plugins see the documents that are already open
+		run_pending();
+		return loaded;
+	}
+
+	void MockHost::unload_plugins()
+	{
+		auto unload = m_proxy_plugin->proxy_funcs->unload;
+		for (auto it = m_loaded.rbegin(); it != m_loaded.rend(); ++it)
+		{
+			if (it->initialized && it->plugin->funcs->cleanup)
+				it->plugin->funcs->cleanup(it->plugin, it->load_data);
+			if (unload)
+				unload(m_proxy_plugin, it->plugin, it->load_data, m_proxy_data);
+			free_plugin(it->plugin);
+		}
+		m_loaded.clear();
+		m_plugin_data.clear();
+	}
+
+	//
+	// Signal emission
+	//
+
+	void MockHost::connect(const char *signal_name, GCallback callback, gpointer user_data)
+	{
+		m_handlers.push_back(Handler{ signal_name, callback, user_data });
+	}
+
+	template< class... Args >
+	void MockHost::emit(const char *signal_name, Args... args)
+	{
+		typedef void (*Func)(GObject*, Args..., gpointer);
+		for (size_t i = 0; i < m_handlers.size(); i++)
+		{
+			const Handler &h = m_handlers[i];
+			if (h.signal_name == signal_name)
+				reinterpret_cast<Func>(h.callback)(nullptr, args..., h.user_data);
+		}
+	}
+
+	bool MockHost::emit_notify(GeanyEditor *editor, SCNotification *nt)
+	{
+		typedef gboolean (*Func)(GObject*, GeanyEditor*, SCNotification*, gpointer);
+		for (size_t i = 0; i < m_handlers.size(); i++)
+		{
+			const Handler &h = m_handlers[i];
+			if (h.signal_name == "editor-notify" &&
+				reinterpret_cast<Func>(h.callback)(nullptr, editor, nt, h.user_data))
+			{
+				return true;
+			}
+		}
+		return false;
+	}
+
+	bool MockHost::notify(GeanyDocument *doc, unsigned int code)
+	{
+		SCNotification nt;
+		std::memset(&nt, 0, sizeof(nt));
+		nt.nmhdr.code = code;
+		return notify(doc, nt);
+	}
+
+	bool MockHost::notify(GeanyDocument *doc, SCNotification &nt)
+	{
+		g_return_val_if_fail(DOC_VALID(doc), false);
+		nt.nmhdr.hwndFrom = doc->editor->sci;
+		nt.nmhdr.idFrom = 0;
+		return emit_notify(doc->editor, &nt);
+	}
+
+	void MockHost::run_pending()
+	{
+		auto ctx = g_main_context_default();
+		while (g_main_context_pending(ctx))
+			g_main_context_iteration(ctx, FALSE);
+	}
+
+	//
+	// Documents
+	//
+
+	GeanyDocument *MockHost::create_document(const std::string &filename,
+		const std::string &text, GeanyFiletype *ft)
+	{
+		// like Geany, re-use the first closed document's slot
+		GeanyDocument *doc = nullptr;
+		for (guint i = 0; i < m_data.documents_array->len; i++)
+		{
+			auto d = static_cast<GeanyDocument*>(m_data.documents_array->pdata[i]);
+			if (!d->is_valid)
+			{
+				doc = d;
+				break;
+			}
+		}
+		if (!doc)
+		{
+			doc = g_new0(GeanyDocument, 1);
+			doc->index = m_data.documents_array->len;
+			g_ptr_array_add(m_data.documents_array, doc);
+		}
+
+		doc->id = m_next_doc_id++;
+		doc->file_name = filename.empty() ? nullptr : g_strdup(filename.c_str());
+		doc->real_path = doc->file_name ? g_strdup(doc->file_name) : nullptr;
+		doc->encoding = g_strdup("UTF-8");
+		doc->file_type = ft ? ft : filetypes_detect_from_file(doc->file_name);
+
+		auto editor = g_new0(GeanyEditor, 1);
+		editor->document = doc;
+		editor->sci = SCINTILLA(g_object_new(scintilla_get_type(), nullptr));
+		editor->sci->pscin = new Buffer(editor);
+		doc->editor = editor;
+		doc->is_valid = TRUE;
+
+		Buffer &buf = buffer(editor->sci);
+		buf.text = text;
+		buf.styles.assign(text.size(), '\0');
+		return doc;
+	}
+
+	void MockHost::destroy_document(GeanyDocument *doc)
+	{
+		doc->is_valid = FALSE;
+		if (m_current == doc)
+			m_current = nullptr;
+		ScintillaObject *sci = doc->editor->sci;
+		delete static_cast<Buffer*>(sci->pscin);
+		sci->pscin = nullptr;
+		g_object_unref(sci);
+		g_free(doc->editor);
+		g_free(doc->file_name);
+		g_free(doc->real_path);
+		g_free(doc->encoding);
+		doc->editor = nullptr;
+		doc->file_name = nullptr;
+		doc->real_path = nullptr;
+		doc->encoding = nullptr;
+	}
+
+	// like Geany, "document-filetype-set" comes before new/open
+	GeanyDocument *MockHost::new_document(const std::string &filename,
+		const std::string &text, GeanyFiletype *ft)
+	{
+		auto doc = create_document(filename, text, ft);
+		emit("document-filetype-set", doc, static_cast<GeanyFiletype*>(nullptr));
+		emit("document-new", doc);
+		activate_document(doc);
+		return doc;
+	}
+
+	GeanyDocument *MockHost::open_document(const std::string &filename,
+		const std::string &text, GeanyFiletype *ft)
+	{
+		auto doc = create_document(filename, text, ft);
+		emit("document-filetype-set", doc, static_cast<GeanyFiletype*>(nullptr));
+		emit("document-open", doc);
+		activate_document(doc);
+		return doc;
+	}
+
+	void MockHost::close_document(GeanyDocument *doc)
+	{
+		g_return_if_fail(DOC_VALID(doc));
+		emit("document-close", doc);
+		destroy_document(doc);
+	}
+
+	void MockHost::close_all()
+	{
+		for (guint i = 0; i < m_data.documents_array->len; i++)
+		{
+			auto doc = static_cast<GeanyDocument*>(m_data.documents_array->pdata[i]);
+			if (doc->is_valid)
+				close_document(doc);
+		}
+	}
+
+	void MockHost::activate_document(GeanyDocument *doc)
+	{
+		g_return_if_fail(DOC_VALID(doc));
+		m_current = doc;
+		emit("document-activate", doc);
+	}
+
+	void MockHost::save_document(GeanyDocument *doc)
+	{
+		g_return_if_fail(DOC_VALID(doc));
+		emit("document-before-save", doc);
+		send_message(doc->editor->sci, SCI_SETSAVEPOINT, 0, 0);
+		doc->changed = FALSE;
+		emit("document-save", doc);
+	}
+
+	void MockHost::reload_document(GeanyDocument *doc)
+	{
+		g_return_if_fail(DOC_VALID(doc));
+		emit("document-reload", doc);
+	}
+
+	void MockHost::set_filetype(GeanyDocument *doc, GeanyFiletype *ft)
+	{
+		g_return_if_fail(DOC_VALID(doc));
+		GeanyFiletype *old_ft = doc->file_type;
+		doc->file_type = ft;
+		emit("document-filetype-set", doc, old_ft);
+	}
+
+	void MockHost::emit_document(const char *signal_name, GeanyDocument *doc)
+	{
+		g_return_if_fail(DOC_VALID(doc));
+		emit(signal_name, doc);
+	}
+
+	GeanyFiletype *MockHost::filetype(const std::string &name) const
+	{
+		for (guint i = 0; i < m_data.filetypes_array->len; i++)
+		{
+			auto ft = static_cast<GeanyFiletype*>(m_data.filetypes_array->pdata[i]);
+			if (name == ft->name)
+				return ft;
+		}
+		return nullptr;
+	}
+
+	//
+	// Projects
+	//
+
+	void MockHost::open_project(const std::string &name, const std::string &base_path)
+	{
+		close_project();
+		m_project.name = g_strdup(name.c_str());
+		m_project.base_path = g_strdup(base_path.c_str());
+		m_project.file_name = g_strdup_printf("%s/%s.geany", base_path.c_str(), name.c_str());
+		m_app.project = &m_project;
+
+		GKeyFile *kf = g_key_file_new();
+		g_key_file_set_string(kf, "project", "name", name.c_str());
+		g_key_file_set_string(kf, "project", "base_path", base_path.c_str());
+		emit("project-open", kf);
+		g_key_file_free(kf);
+	}
+
+	void MockHost::close_project()
+	{
+		if (!m_app.project)
+			return;
+		emit("project-close");
+		m_app.project = nullptr;
+		g_free(m_project.name);
+		g_free(m_project.base_path);
+		g_free(m_project.file_name);
+		std::memset(&m_project, 0, sizeof(m_project));
+	}
+
+	//
+	// Editing
+	//
+
+	MockHost::Buffer &MockHost::buffer(ScintillaObject *sci) const
+	{
+		return *static_cast<Buffer*>(sci->pscin);
+	}
+
+	const std::string &MockHost::text(GeanyDocument *doc) const
+	{
+		return buffer(doc->editor->sci).text;
+	}
+
+	void MockHost::insert_text(GeanyDocument *doc, size_t pos, const std::string &text)
+	{
+		g_return_if_fail(DOC_VALID(doc));
+		send_message(doc->editor->sci, SCI_INSERTTEXT, pos,
+			reinterpret_cast<intptr_t>(text.c_str()));
+	}
+
+	void MockHost::delete_text(GeanyDocument *doc, size_t pos, size_t length)
+	{
+		g_return_if_fail(DOC_VALID(doc));
+		send_message(doc->editor->sci, SCI_DELETERANGE, pos, length);
+	}
+
+	// what Scintilla notifies after a change, with the save point
+	// notification first if this is the first change since a save
+	void MockHost::modified(Buffer &buf, int mod_type, size_t pos,
+		const char *text, size_t length, int lines_added)
+	{
+		GeanyDocument *doc = buf.editor->document;
+		if (m_quiet)
+		{
+			buf.modified = true;
+			return;
+		}
+		if (!buf.modified)
+		{
+			buf.modified = true;
+			notify(doc, SCN_SAVEPOINTLEFT);
+		}
+		SCNotification nt;
+		std::memset(&nt, 0, sizeof(nt));
+		nt.nmhdr.code = SCN_MODIFIED;
+		nt.position = pos;
+		nt.modificationType = mod_type | SC_PERFORMED_USER;
+		nt.text = text;
+		nt.length = length;
+		nt.linesAdded = lines_added;
+		nt.line = buf.line_from_position(pos);
+		notify(doc, nt);
+	}
+
+	intptr_t MockHost::send_message(ScintillaObject *sci, unsigned int msg,
+		uintptr_t wparam, intptr_t lparam)
+	{
+		Buffer &buf = buffer(sci);
+		std::string &text = buf.text;
+
+		switch (msg)
+		{
+			case SCI_GETLENGTH:
+			case SCI_GETTEXTLENGTH:
+				return text.size();
+
+			case SCI_GETCHARAT:
+				return wparam < text.size() ? static_cast<signed char>(text[wparam]) : 0;
+
+			case SCI_GETTEXT:
+			{
+				if (!lparam)
+					return text.size();
+				size_t n = std::min(text.size(), wparam > 0 ? size_t(wparam - 1) : size_t(0));
+				auto out = reinterpret_cast<char*>(lparam);
+				std::memcpy(out, text.data(), n);
+				out[n] = '\0';
+				return n;
+			}
+
+			case SCI_GETTEXTRANGE:
+			{
+				auto tr = reinterpret_cast<Sci_TextRange*>(lparam);
+				size_t start = buf.clamp(tr->chrg.cpMin);
+				size_t end = tr->chrg.cpMax < 0 ? text.size() : buf.clamp(tr->chrg.cpMax);
+				end = std::max(start, end);
+				std::memcpy(tr->lpstrText, text.data() + start, end - start);
+				tr->lpstrText[end - start] = '\0';
+				return end - start;
+			}
+
+			case SCI_SETTEXT:
+				send_message(sci, SCI_CLEARALL, 0, 0);
+				send_message(sci, SCI_INSERTTEXT, 0, lparam);
+				return 0;
+
+			case SCI_CLEARALL:
+				if (!text.empty())
+					send_message(sci, SCI_DELETERANGE, 0, text.size());
+				buf.caret = buf.anchor = 0;
+				return 0;
+
+			case SCI_ADDTEXT:
+			{
+				std::string str(reinterpret_cast<const char*>(lparam), wparam);
+				size_t pos = buf.caret;
+				send_message(sci, SCI_INSERTTEXT, pos, reinterpret_cast<intptr_t>(str.c_str()));
+				buf.caret = buf.anchor = pos + str.size();
+				return 0;
+			}
+
+			case SCI_APPENDTEXT:
+			{
+				std::string str(reinterpret_cast<const char*>(lparam), wparam);
+				send_message(sci, SCI_INSERTTEXT, text.size(), reinterpret_cast<intptr_t>(str.c_str()));
+				return 0;
+			}
+
+			case SCI_INSERTTEXT:
+			{
+				if (buf.readonly && !m_quiet)
+				{
+					notify(buf.editor->document, SCN_MODIFYATTEMPTRO);
+					return 0;
+				}
+				auto str = reinterpret_cast<const char*>(lparam);
+				size_t len = std::strlen(str);
+				size_t pos = static_cast<intptr_t>(wparam) < 0 ? buf.caret : buf.clamp(wparam);
+				size_t line = buf.line_from_position(pos);
+				text.insert(pos, str, len);
+				buf.styles.insert(pos, len, '\0');
+				buf.styles_changed(pos);
+				buf.insert_line_states(line, count_lines(str, len));
+				buf.lines_valid = false;
+				if (buf.caret >= pos)
+					buf.caret += len;
+				if (buf.anchor >= pos)
+					buf.anchor += len;
+				modified(buf, SC_MOD_INSERTTEXT, pos, text.data() + pos, len,
+					count_lines(str, len));
+				return 0;
+			}
+
+			case SCI_DELETERANGE:
+			{
+				if (buf.readonly && !m_quiet)
+				{
+					notify(buf.editor->document, SCN_MODIFYATTEMPTRO);
+					return 0;
+				}
+				size_t pos = buf.clamp(wparam);
+				size_t len = std::min(static_cast<size_t>(lparam), text.size() - pos);
+				if (len == 0)
+					return 0;
+				std::string removed = text.substr(pos, len);
+				buf.remove_line_states(buf.line_from_position(pos),
+					count_lines(removed.data(), len));
+				text.erase(pos, len);
+				buf.styles.erase(pos, len);
+				buf.styles_changed(pos);
+				buf.lines_valid = false;
+				if (buf.caret > pos)
+					buf.caret = buf.caret >= pos + len ? buf.caret - len : pos;
+				if (buf.anchor > pos)
+					buf.anchor = buf.anchor >= pos + len ? buf.anchor - len : pos;
+				modified(buf, SC_MOD_DELETETEXT, pos, removed.c_str(), len,
+					-count_lines(removed.data(), len));
+				return 0;
+			}
+
+			case SCI_GETCURRENTPOS:
+				return buf.caret;
+			case SCI_GETANCHOR:
+				return buf.anchor;
+			case SCI_GETSELECTIONSTART:
+				return std::min(buf.caret, buf.anchor);
+			case SCI_GETSELECTIONEND:
+				return std::max(buf.caret, buf.anchor);
+			case SCI_SETCURRENTPOS:
+				buf.caret = buf.clamp(wparam);
+				return 0;
+			case SCI_SETANCHOR:
+				buf.anchor = buf.clamp(wparam);
+				return 0;
+			case SCI_SETSEL:
+				buf.anchor = buf.clamp(wparam);
+				buf.caret = lparam < 0 ? text.size() : buf.clamp(lparam);
+				return 0;
+			case SCI_GOTOPOS:
+			case SCI_SETEMPTYSELECTION:
+				buf.caret = buf.anchor = buf.clamp(wparam);
+				return 0;
+
+			case SCI_GETLINECOUNT:
+				return buf.lines().size();
+			case SCI_LINEFROMPOSITION:
+				return buf.line_from_position(buf.clamp(wparam));
+			case SCI_POSITIONFROMLINE:
+				return buf.line_start(wparam);
+			case SCI_GETLINEENDPOSITION:
+				return buf.line_end(wparam);
+			case SCI_LINELENGTH:
+			{
+				size_t start = buf.line_start(wparam);
+				size_t next = buf.line_start(wparam + 1);
+				return (wparam + 1 < buf.lines().size() ? next : text.size()) - start;
+			}
+			case SCI_GETCOLUMN:
+			{
+				size_t pos = buf.clamp(wparam);
+				return pos - buf.line_start(buf.line_from_position(pos));
+			}
+
+			case SCI_GETMODIFY:
+				return buf.modified;
+			case SCI_SETSAVEPOINT:
+				if (buf.modified)
+				{
+					buf.modified = false;
+					if (!m_quiet)
+						notify(buf.editor->document, SCN_SAVEPOINTREACHED);
+				}
+				return 0;
+			case SCI_GETREADONLY:
+				return buf.readonly;
+			case SCI_SETREADONLY:
+				buf.readonly = wparam != 0;
+				return 0;
+
+			case SCI_GETLEXER:
+				return buf.lexer;
+			case SCI_SETLEXER:
+				buf.lexer = wparam;
+				return 0;
+			case SCI_GETENDSTYLED:
+				return buf.end_styled;
+			case SCI_GETSTYLEAT:
+				return wparam < buf.styles.size() ?
+					static_cast<unsigned char>(buf.styles[wparam]) : 0;
+			case SCI_STARTSTYLING:
+				buf.styling_pos = buf.end_styled = buf.clamp(wparam);
+				return 0;
+			case SCI_SETSTYLING:
+			case SCI_SETSTYLINGEX:
+			{
+				size_t len = std::min(static_cast<size_t>(wparam), text.size() - buf.styling_pos);
+				if (msg == SCI_SETSTYLING)
+					std::fill_n(&buf.styles[buf.styling_pos], len, static_cast<char>(lparam));
+				else
+					std::memcpy(&buf.styles[buf.styling_pos], reinterpret_cast<const char*>(lparam), len);
+				buf.styling_pos += len;
+				buf.end_styled = buf.styling_pos;
+				return 0;
+			}
+			case SCI_SETLINESTATE:
+				if (wparam >= buf.lines().size())
+					return 0;
+				if (buf.line_states.size() < buf.lines().size())
+					buf.line_states.resize(buf.lines().size(), 0);
+				buf.line_states[wparam] = lparam;
+				return 0;
+			case SCI_GETLINESTATE:
+				return wparam < buf.line_states.size() ? buf.line_states[wparam] : 0;
+			case SCI_GETMAXLINESTATE:
+				return buf.line_states.size();
+
+			default:
+				// anything about the view, styles, markers etc. is ignored
+				return 0;
+		}
+	}
+
+}
+
+
+//
+// The parts of Geany's plugin API libgeany++ uses
+//
+
+using Bench::g_host;
+
+extern "C"
+{
+
+GType scintilla_get_type(void)
+{
+	static GType type = 0;
+	if (!type)
+	{
+		// a plain GObject with room for ScintillaObject's fields, enough
+		// for IS_SCINTILLA() and the wrappers' weak pointers
+		type = g_type_register_static_simple(G_TYPE_OBJECT, "MockScintilla",
+			sizeof(GObjectClass), nullptr, sizeof(ScintillaObject), nullptr,
+			static_cast<GTypeFlags>(0));
+	}
+	return type;
+}
+
+GType scintilla_object_get_type(void)
+{
+	return scintilla_get_type();
+}
+
+sptr_t scintilla_send_message(ScintillaObject *sci, unsigned int iMessage,
+	uptr_t wParam, sptr_t lParam)
+{
+	return g_host->send_message(sci, iMessage, wParam, lParam);
+}
+
+gint sci_get_current_line(ScintillaObject *sci)
+{
+	return g_host->send_message(sci, SCI_LINEFROMPOSITION,
+		g_host->send_message(sci, SCI_GETCURRENTPOS, 0, 0), 0);
+}
+
+gboolean geany_plugin_register(GeanyPlugin *plugin, gint, gint, gint)
+{
+	g_host->register_plugin(plugin, nullptr, nullptr);
+	return TRUE;
+}
+
+gboolean geany_plugin_register_full(GeanyPlugin *plugin, gint, gint, gint,
+	gpointer pdata, GDestroyNotify free_func)
+{
+	g_host->register_plugin(plugin, pdata, free_func);
+	return TRUE;
+}
+
+gboolean geany_plugin_register_proxy(GeanyPlugin*, const gchar**)
+{
+	return TRUE;
+}
+
+void geany_plugin_set_data(GeanyPlugin *plugin, gpointer pdata, GDestroyNotify free_func)
+{
+	g_host->register_plugin(plugin, pdata, free_func);
+}
+
+void plugin_signal_connect(GeanyPlugin*, GObject*, const gchar *signal_name,
+	gboolean, GCallback callback, gpointer user_data)
+{
+	g_host->connect(signal_name, callback, user_data);
+}
+
+GeanyDocument *document_get_current(void)
+{
+	return g_host->current();
+}
+
+GeanyDocument *document_new_file(const gchar *utf8_filename, GeanyFiletype *ft,
+	const gchar *text)
+{
+	return g_host->new_document(utf8_filename ? utf8_filename : "", text ? text : "", ft);
+}
+
+GeanyDocument *document_open_file(const gchar *locale_filename, gboolean readonly,
+	GeanyFiletype *ft, const gchar*)
+{
+	gchar *contents = nullptr;
+	if (!g_file_get_contents(locale_filename, &contents, nullptr, nullptr))
+		return nullptr;
+	auto doc = g_host->open_document(locale_filename, contents, ft);
+	g_free(contents);
+	doc->readonly = readonly;
+	return doc;
+}
+
+gboolean document_close(GeanyDocument *doc)
+{
+	g_host->close_document(doc);
+	return TRUE;
+}
+
+gboolean document_save_file(GeanyDocument *doc, gboolean)
+{
+	g_host->save_document(doc);
+	return TRUE;
+}
+
+gboolean document_save_file_as(GeanyDocument *doc, const gchar *utf8_fname)
+{
+	if (utf8_fname)
+	{
+		g_free(doc->file_name);
+		doc->file_name = g_strdup(utf8_fname);
+	}
+	g_host->save_document(doc);
+	return TRUE;
+}
+
+gboolean document_reload_force(GeanyDocument *doc, const gchar*)
+{
+	g_host->reload_document(doc);
+	return TRUE;
+}
+
+void document_set_text_changed(GeanyDocument *doc, gboolean changed)
+{
+	doc->changed = changed;
+}
+
+void document_set_filetype(GeanyDocument *doc, GeanyFiletype *ft)
+{
+	g_host->set_filetype(doc, ft);
+}
+
+void document_set_encoding(GeanyDocument *doc, const gchar *new_encoding)
+{
+	g_free(doc->encoding);
+	doc->encoding = g_strdup(new_encoding);
+}
+
+gchar *document_get_basename_for_display(GeanyDocument *doc, gint)
+{
+	return doc->file_name ? g_path_get_basename(doc->file_name) : g_strdup("untitled");
+}
+
+const gchar *editor_get_eol_char(GeanyEditor*)
+{
+	return "\n";
+}
+
+const GeanyIndentPrefs *editor_get_indent_prefs(GeanyEditor*)
+{
+	static GeanyIndentPrefs prefs;
+	prefs.width = 4;
+	return &prefs;
+}
+
+void editor_set_indent_type(GeanyEditor*, GeanyIndentType) {}
+void editor_set_indent_width(GeanyEditor*, gint) {}
+void editor_indicator_clear(GeanyEditor*, gint) {}
+void editor_indicator_set_on_line(GeanyEditor*, gint, gint) {}
+void editor_indicator_set_on_range(GeanyEditor*, gint, gint, gint) {}
+
+gchar *editor_get_word_at_pos(GeanyEditor *editor, gint pos, const gchar *wordchars)
+{
+	const std::string &text = g_host->text(editor->document);
+	size_t p = pos < 0 ? g_host->send_message(editor->sci, SCI_GETCURRENTPOS, 0, 0) : pos;
+	if (!wordchars)
+		wordchars = GEANY_WORDCHARS;
+	size_t start = std::min(p, text.size()), end = start;
+	while (start > 0 && std::strchr(wordchars, text[start - 1]))
+		start--;
+	while (end < text.size() && std::strchr(wordchars, text[end]))
+		end++;
+	if (start == end)
+		return nullptr;
+	return g_strndup(text.data() + start, end - start);
+}
+
+gboolean editor_goto_pos(GeanyEditor *editor, gint pos, gboolean)
+{
+	g_host->send_message(editor->sci, SCI_GOTOPOS, pos, 0);
+	return TRUE;
+}
+
+GeanyFiletype *filetypes_index(gint idx)
+{
+	GPtrArray *fts = Geany::data->filetypes_array;
+	if (idx < 0 || guint(idx) >= fts->len)
+		return nullptr;
+	return static_cast<GeanyFiletype*>(fts->pdata[idx]);
+}
+
+GeanyFiletype *filetypes_lookup_by_name(const gchar *name)
+{
+	return name ? g_host->filetype(name) : nullptr;
+}
+
+GeanyFiletype *filetypes_detect_from_file(const gchar *utf8_filename)
+{
+	GPtrArray *fts = Geany::data->filetypes_array;
+	if (utf8_filename)
+	{
+		gchar *base = g_path_get_basename(utf8_filename);
+		for (guint i = 1; i < fts->len; i++)
+		{
+			auto ft = static_cast<GeanyFiletype*>(fts->pdata[i]);
+			if (g_pattern_match_simple(ft->pattern[0], base))
+			{
+				g_free(base);
+				return ft;
+			}
+		}
+		g_free(base);
+	}
+	return static_cast<GeanyFiletype*>(fts->pdata[0]);
+}
+
+const gchar *filetypes_get_display_name(GeanyFiletype *ft)
+{
+	return ft->title;
+}
+
+gboolean project_open_file(const gchar*)
+{
+	return FALSE;
+}
+
+void project_write_config(void) {}
+
+guint build_get_group_count(GeanyBuildGroup)
+{
+	return 0;
+}
+
+const gchar *build_get_current_menu_item(GeanyBuildGroup, guint, guint)
+{
+	return nullptr;
+}
+
+void build_set_menu_item(GeanyBuildSource, GeanyBuildGroup, guint,
+	GeanyBuildCmdEntries, const gchar*) {}
+void build_activate_menu_item(GeanyBuildGroup, guint) {}
+
+void ui_set_statusbar(gboolean, const gchar*, ...) {}
+void msgwin_status_add(const gchar*, ...) {}
+void utils_open_browser(const gchar*) {}
+
+gchar *utils_get_locale_from_utf8(const gchar *utf8_text)
+{
+	return g_strdup(utf8_text);
+}
+
+gchar *tm_get_real_path(const gchar *file_name)
+{
+	return g_strdup(file_name);
+}
+
+TMSourceFile *tm_source_file_new(const char*, const char*)
+{
+	return nullptr;
+}
+
+void tm_source_file_free(TMSourceFile*) {}
+
+}
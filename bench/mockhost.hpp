@@ -0,0 +1,191 @@
+#pragma once
+
+#include <geany++/geany_p.hpp>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace Bench
+{
+
+	/**
+	 * A stand-in for Geany which runs the proxy plugin without a GUI.
+	 *
+	 * The host provides the parts of Geany's plugin API libgeany++ uses:
+	 * a GeanyData with a few filetypes, documents and editors backed by
+	 * an in-memory text buffer, and scintilla_send_message() answering
+	 * the common messages from that buffer. Signal handlers connected
+	 * with plugin_signal_connect() are kept and the host emits them
+	 * itself, so everything from proxy_init() down to the plugins'
+	 * handlers runs exactly as in Geany, only without widgets.
+	 *
+	 * There can only be one host at a time since Geany's API is a set of
+	 * global functions.
+	 */
+	class MockHost
+	{
+	public:
+
+		/**
+		 * Set up the fake GeanyData and load the proxy, using a new
+		 * temporary directory as the config directory.
+		 */
+		MockHost();
+
+		/**
+		 * Unload all plugins and the proxy, removing the temporary
+		 * directory.
+		 */
+		~MockHost();
+
+		static MockHost *instance();
+
+		/**
+		 * Load @a count instances of the plugin module @a module,
+		 * each through its own `.plugin` file so the proxy sees them
+		 * as separate plugins.
+		 *
+		 * @return The number of plugins that loaded and initialized.
+		 */
+		size_t load_plugins(const std::string &module, size_t count);
+		void unload_plugins();
+
+		const std::vector<Geany::PluginData*> &plugins() const
+		{
+			return m_plugin_data;
+		}
+
+		Geany::ProxyPlugin &proxy() const
+		{
+			return *Geany::g_proxy;
+		}
+
+		const std::string &config_dir() const
+		{
+			return m_config_dir;
+		}
+
+		// documents
+
+		// the filetype is detected from the filename unless @a ft is given
+		GeanyDocument *new_document(const std::string &filename = std::string(),
+			const std::string &text = std::string(), GeanyFiletype *ft = nullptr);
+		GeanyDocument *open_document(const std::string &filename,
+			const std::string &text, GeanyFiletype *ft = nullptr);
+		void close_document(GeanyDocument *doc);
+		void close_all();
+		void activate_document(GeanyDocument *doc);
+		void save_document(GeanyDocument *doc);
+		void reload_document(GeanyDocument *doc);
+		void set_filetype(GeanyDocument *doc, GeanyFiletype *ft);
+
+		/**
+		 * Emit a document signal like "document-save" by itself,
+		 * without what the host would do before emitting it.
+		 */
+		void emit_document(const char *signal_name, GeanyDocument *doc);
+
+		GeanyDocument *current() const
+		{
+			return m_current;
+		}
+
+		GeanyFiletype *filetype(const std::string &name) const;
+
+		// projects
+
+		void open_project(const std::string &name, const std::string &base_path);
+		void close_project();
+
+		// editing, modifications are notified like Scintilla does
+
+		void insert_text(GeanyDocument *doc, size_t pos, const std::string &text);
+		void delete_text(GeanyDocument *doc, size_t pos, size_t length);
+		const std::string &text(GeanyDocument *doc) const;
+
+		/**
+		 * When quiet, changes to the text and the save point aren't
+		 * notified, for replaying recorded notifications after
+		 * applying the change they describe.
+		 */
+		void set_quiet(bool quiet)
+		{
+			m_quiet = quiet;
+		}
+
+		/**
+		 * Send a notification with only @a code set, like
+		 * SCN_UPDATEUI or SCN_PAINTED.
+		 */
+		bool notify(GeanyDocument *doc, unsigned int code);
+
+		/**
+		 * Send a notification through "editor-notify", filling in its
+		 * header.
+		 */
+		bool notify(GeanyDocument *doc, SCNotification &nt);
+
+		/**
+		 * Run idle handlers and timeouts which are due, without
+		 * blocking.
+		 */
+		void run_pending();
+
+		// called by the fake Geany API
+
+		void connect(const char *signal_name, GCallback callback, gpointer user_data);
+		intptr_t send_message(ScintillaObject *sci, unsigned int msg,
+			uintptr_t wparam, intptr_t lparam);
+		void register_plugin(GeanyPlugin *plugin, gpointer pdata, GDestroyNotify free_func);
+
+	private:
+		struct Handler
+		{
+			std::string signal_name;
+			GCallback callback;
+			gpointer user_data;
+		};
+
+		struct Buffer;
+
+		struct LoadedPlugin
+		{
+			GeanyPlugin *plugin;
+			gpointer load_data;
+			bool initialized;
+		};
+
+		GeanyPlugin *m_proxy_plugin;
+		gpointer m_proxy_data;
+		GeanyData m_data;
+		GeanyApp m_app;
+		GeanyMainWidgets m_widgets;
+		GeanyProject m_project;
+		std::string m_config_dir;
+		std::vector<Handler> m_handlers;
+		std::vector<LoadedPlugin> m_loaded;
+		std::vector<Geany::PluginData*> m_plugin_data;
+		std::vector<std::string> m_spec_files;
+		GeanyDocument *m_current;
+		unsigned int m_next_doc_id;
+		gpointer m_registered_data;
+		bool m_quiet;
+
+		MockHost(const MockHost&);
+		MockHost &operator=(const MockHost&);
+
+		GeanyPlugin *new_plugin();
+		void free_plugin(GeanyPlugin *plugin);
+		GeanyDocument *create_document(const std::string &filename,
+			const std::string &text, GeanyFiletype *ft);
+		void destroy_document(GeanyDocument *doc);
+		Buffer &buffer(ScintillaObject *sci) const;
+		void modified(Buffer &buf, int mod_type, size_t pos,
+			const char *text, size_t length, int lines_added);
+
+		template< class... Args >
+		void emit(const char *signal_name, Args... args);
+		bool emit_notify(GeanyEditor *editor, SCNotification *nt);
+	};
+
+}
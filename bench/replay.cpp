@@ -0,0 +1,322 @@
+#include "mockhost.hpp"
+#include <geany++/session_p.hpp>
+
+#ifdef HAVE_CONFIG_H
+#include <geany++/config.h>
+#endif
+
+#include <sys/resource.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <stdexcept>
+#include <unordered_map>
+
+// default number of times the recording is replayed
+#define DEFAULT_RUNS 3
+
+using Bench::MockHost;
+using namespace Geany;
+
+
+//
+// Allocation counting, covers C++ allocations from the framework and
+// the plugins since they resolve operator new to the program's
+//
+
+static std::atomic<uint64_t> alloc_count(0);
+static std::atomic<uint64_t> alloc_bytes(0);
+
+void *operator new(size_t size)
+{
+	alloc_count.fetch_add(1, std::memory_order_relaxed);
+	alloc_bytes.fetch_add(size, std::memory_order_relaxed);
+	if (void *ptr = std::malloc(size ? size : 1))
+		return ptr;
+	throw std::bad_alloc();
+}
+
+void *operator new[](size_t size)
+{
+	return operator new(size);
+}
+
+void operator delete(void *ptr) noexcept
+{
+	std::free(ptr);
+}
+
+void operator delete[](void *ptr) noexcept
+{
+	std::free(ptr);
+}
+
+void operator delete(void *ptr, size_t) noexcept
+{
+	std::free(ptr);
+}
+
+void operator delete[](void *ptr, size_t) noexcept
+{
+	std::free(ptr);
+}
+
+
+namespace
+{
+
+	struct Usage
+	{
+		double wall;
+		double user;
+		double sys;
+		uint64_t allocs;
+		uint64_t bytes;
+
+		static Usage now()
+		{
+			struct rusage ru;
+			getrusage(RUSAGE_SELF, &ru);
+			auto wall = std::chrono::steady_clock::now().time_since_epoch();
+			return Usage{
+				std::chrono::duration<double>(wall).count(),
+				ru.ru_utime.tv_sec + ru.ru_utime.tv_usec / 1e6,
+				ru.ru_stime.tv_sec + ru.ru_stime.tv_usec / 1e6,
+				alloc_count.load(),
+				alloc_bytes.load()
+			};
+		}
+
+		Usage operator-(const Usage &other) const
+		{
+			return Usage{ wall - other.wall, user - other.user, sys - other.sys,
+				allocs - other.allocs, bytes - other.bytes };
+		}
+	};
+
+	class Replayer
+	{
+	public:
+		Replayer(MockHost &host, const std::vector<Session::Record> &records)
+			: m_host(host), m_records(records)
+		{
+		}
+
+		void run()
+		{
+			for (auto &rec : m_records)
+			{
+				replay(rec);
+				// idle handlers like document replay and delayed saves
+				m_host.run_pending();
+			}
+			m_host.close_project();
+			m_host.close_all();
+			m_host.run_pending();
+			m_docs.clear();
+		}
+
+	private:
+		MockHost &m_host;
+		const std::vector<Session::Record> &m_records;
+		std::unordered_map<unsigned int, GeanyDocument*> m_docs;
+
+		GeanyDocument *lookup(unsigned int id)
+		{
+			auto found = m_docs.find(id);
+			return found != m_docs.end() ? found->second : nullptr;
+		}
+
+		GeanyFiletype *filetype(const std::string &name)
+		{
+			if (auto ft = m_host.filetype(name))
+				return ft;
+			return m_host.filetype("None");
+		}
+
+		void replay(const Session::Record &rec)
+		{
+			GeanyDocument *doc = lookup(rec.doc_id);
+			switch (rec.event)
+			{
+				case Session::DOCUMENT_NEW:
+				case Session::DOCUMENT_OPEN:
+					if (doc)
+						m_host.close_document(doc);
+					if (rec.event == Session::DOCUMENT_NEW)
+						doc = m_host.new_document(rec.name, rec.text, filetype(rec.filetype));
+					else
+						doc = m_host.open_document(rec.name, rec.text, filetype(rec.filetype));
+					m_docs[rec.doc_id] = doc;
+					return;
+				default:
+					break;
+			}
+
+			// events for documents opened before recording started, or
+			// filetype-set before new/open, which the host already sent
+			if (!doc && rec.doc_id != 0)
+				return;
+
+			switch (rec.event)
+			{
+				case Session::DOCUMENT_CLOSE:
+					m_host.close_document(doc);
+					m_docs.erase(rec.doc_id);
+					break;
+				case Session::DOCUMENT_ACTIVATE:
+					m_host.activate_document(doc);
+					break;
+				case Session::DOCUMENT_BEFORE_SAVE:
+					m_host.emit_document("document-before-save", doc);
+					break;
+				case Session::DOCUMENT_SAVE:
+					m_host.set_quiet(true);
+					scintilla_send_message(doc->editor->sci, SCI_SETSAVEPOINT, 0, 0);
+					m_host.set_quiet(false);
+					m_host.emit_document("document-save", doc);
+					break;
+				case Session::DOCUMENT_RELOAD:
+					m_host.set_quiet(true);
+					scintilla_send_message(doc->editor->sci, SCI_SETTEXT, 0,
+						reinterpret_cast<sptr_t>(rec.text.c_str()));
+					m_host.set_quiet(false);
+					m_host.reload_document(doc);
+					break;
+				case Session::DOCUMENT_FILETYPE_SET:
+					m_host.set_filetype(doc, filetype(rec.filetype));
+					break;
+				case Session::EDITOR_NOTIFY:
+					notify(doc, rec);
+					break;
+				case Session::PROJECT_OPEN:
+					m_host.open_project(rec.name, rec.filetype);
+					break;
+				case Session::PROJECT_CLOSE:
+					m_host.close_project();
+					break;
+				default:
+					break;
+			}
+		}
+
+		// applies the change a notification describes first so handlers
+		// see the text as they would have, then sends the notification
+		void notify(GeanyDocument *doc, const Session::Record &rec)
+		{
+			const Session::Notification &n = rec.nt;
+			ScintillaObject *sci = doc->editor->sci;
+
+			m_host.set_quiet(true);
+			if (n.code == SCN_MODIFIED && (n.modification_type & SC_MOD_INSERTTEXT))
+				m_host.insert_text(doc, n.position, rec.text);
+			else if (n.code == SCN_MODIFIED && (n.modification_type & SC_MOD_DELETETEXT))
+				m_host.delete_text(doc, n.position, n.length);
+			scintilla_send_message(sci, SCI_GOTOPOS, n.caret, 0);
+			m_host.set_quiet(false);
+
+			SCNotification nt;
+			std::memset(&nt, 0, sizeof(nt));
+			nt.nmhdr.code = n.code;
+			nt.position = n.position;
+			nt.ch = n.ch;
+			nt.modifiers = n.modifiers;
+			nt.modificationType = n.modification_type;
+			nt.length = n.length;
+			nt.linesAdded = n.lines_added;
+			nt.line = n.line;
+			nt.margin = n.margin;
+			nt.listType = n.list_type;
+			nt.x = n.x;
+			nt.y = n.y;
+			nt.updated = n.updated;
+			if (!rec.text.empty())
+				nt.text = rec.text.c_str();
+			m_host.notify(doc, nt);
+		}
+	};
+
+	void usage(const char *prog)
+	{
+		std::fprintf(stderr,
+			"usage: %s [-p PLUGINS] [-r RUNS] RECORDING PLUGIN_MODULE\n"
+			"\n"
+			"Replays a session recorded with GEANYCPP_RECORD=<file> against\n"
+			"PLUGINS copies of the plugin, printing the CPU time and C++\n"
+			"allocations for each run.\n", prog);
+		std::exit(EXIT_FAILURE);
+	}
+
+}
+
+int main(int argc, char **argv)
+{
+	size_t n_plugins = 1;
+	size_t runs = DEFAULT_RUNS;
+	const char *recording = nullptr;
+	const char *module = nullptr;
+
+	for (int i = 1; i < argc; i++)
+	{
+		if (std::strcmp(argv[i], "-p") == 0 && i + 1 < argc)
+			n_plugins = std::strtoul(argv[++i], nullptr, 10);
+		else if (std::strcmp(argv[i], "-r") == 0 && i + 1 < argc)
+			runs = std::strtoul(argv[++i], nullptr, 10);
+		else if (argv[i][0] != '-' && !recording)
+			recording = argv[i];
+		else if (argv[i][0] != '-' && !module)
+			module = argv[i];
+		else
+			usage(argv[0]);
+	}
+	if (!recording || !module || runs == 0)
+		usage(argv[0]);
+
+	std::vector<Session::Record> records;
+	try
+	{
+		records = Session::load(recording);
+	}
+	catch (std::runtime_error &exc)
+	{
+		std::fprintf(stderr, "%s\n", exc.what());
+		return EXIT_FAILURE;
+	}
+
+	MockHost host;
+	size_t loaded = host.load_plugins(module, n_plugins);
+	if (loaded != n_plugins)
+	{
+		std::fprintf(stderr, "only %zu of %zu plugins loaded\n", loaded, n_plugins);
+		return EXIT_FAILURE;
+	}
+
+	double recorded = records.empty() ? 0 : records.back().time / 1e6;
+	std::printf("%zu events over %.1fs recorded, %zu plugins\n\n",
+		records.size(), recorded, loaded);
+	std::printf("%-6s %10s %10s %10s %12s %14s\n",
+		"run", "wall (s)", "user (s)", "sys (s)", "allocs", "alloc bytes");
+
+	std::vector<double> cpu_times;
+	Replayer replayer(host, records);
+	for (size_t run = 1; run <= runs; run++)
+	{
+		Usage start = Usage::now();
+		replayer.run();
+		Usage used = Usage::now() - start;
+		cpu_times.push_back(used.user + used.sys);
+		std::printf("%-6zu %10.3f %10.3f %10.3f %12llu %14llu\n", run,
+			used.wall, used.user, used.sys,
+			static_cast<unsigned long long>(used.allocs),
+			static_cast<unsigned long long>(used.bytes));
+	}
+
+	std::sort(cpu_times.begin(), cpu_times.end());
+	std::printf("\nmedian CPU time: %.3fs\n", cpu_times[cpu_times.size() / 2]);
+
+	return EXIT_SUCCESS;
+}
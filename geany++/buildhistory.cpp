@@ -0,0 +1,242 @@
+#include <geany++/buildhistory.hpp>
+#include <geany++/geany.hpp>
+
+#ifdef HAVE_CONFIG_H
+#include <geany++/config.h>
+#endif
+
+#include <glib/gstdio.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+
+// identifies history files, the last byte is the format version
+#define HISTORY_MAGIC "GXXBHST\x01"
+#define HISTORY_MAGIC_LEN 8
+// previous successful runs needed before a run can be a regression
+#define MIN_BASELINE_RUNS 5
+// runs in the baseline
+#define BASELINE_RUNS 20
+// and it must be this much slower, so sub-second noise doesn't warn
+#define MIN_REGRESSION_MSEC 500
+#define DEFAULT_REGRESSION_FACTOR 1.25
+
+namespace Geany
+{
+
+	namespace Build
+	{
+
+		// FNV-1a, the keys end up on disk so they must not depend on
+		// the standard library's hash
+		static uint64_t fnv1a(uint64_t hash, const std::string &str)
+		{
+			for (unsigned char c : str)
+			{
+				hash ^= c;
+				hash *= 0x100000001B3ULL;
+			}
+			return hash;
+		}
+
+		uint64_t History::make_key(const std::string &command_line,
+			const std::string &working_dir)
+		{
+			uint64_t hash = fnv1a(0xCBF29CE484222325ULL, command_line);
+			hash = fnv1a(hash ^ '\n', working_dir);
+			return hash;
+		}
+
+		History::History(const std::string &filename)
+			: m_filename(filename),
+			  m_regression_factor(DEFAULT_REGRESSION_FACTOR)
+		{
+			load();
+		}
+
+		History::~History()
+		{
+			for (auto &conn : m_conns)
+				conn.disconnect();
+		}
+
+		std::string History::default_filename()
+		{
+			std::string name = "default";
+			GeanyProject *project = Geany::data->app->project;
+			if (project && project->file_name)
+			{
+				char buf[17];
+				std::snprintf(buf, sizeof(buf), "%016llx", static_cast<unsigned long long>(
+					fnv1a(0xCBF29CE484222325ULL, project->file_name)));
+				name = buf;
+			}
+			return Glib::build_filename(Geany::data->app->configdir,
+				"plugins", "geany++", "build-history", name + ".bin");
+		}
+
+		void History::load()
+		{
+			std::string contents;
+			try
+			{
+				contents = Glib::file_get_contents(m_filename);
+			}
+			catch (Glib::FileError&)
+			{
+				return;
+			}
+
+			if (contents.size() < HISTORY_MAGIC_LEN ||
+				std::memcmp(contents.data(), HISTORY_MAGIC, HISTORY_MAGIC_LEN) != 0)
+			{
+				if (!contents.empty())
+					g_warning("ignoring unknown build history file '%s'", m_filename.c_str());
+				return;
+			}
+
+			// a partial record at the end is from an interrupted write
+			size_t n = (contents.size() - HISTORY_MAGIC_LEN) / sizeof(Record);
+			m_records.resize(n);
+			std::memcpy(m_records.data(), contents.data() + HISTORY_MAGIC_LEN, n * sizeof(Record));
+			for (size_t i = 0; i < n; i++)
+				m_by_key[m_records[i].key].push_back(i);
+		}
+
+		void History::append(const Record &rec)
+		{
+			m_by_key[rec.key].push_back(m_records.size());
+			m_records.push_back(rec);
+
+			std::string dir = Glib::path_get_dirname(m_filename);
+			if (::g_mkdir_with_parents(dir.c_str(), 0755) != 0)
+			{
+				g_warning("unable to create '%s': %s", dir.c_str(), g_strerror(errno));
+				return;
+			}
+
+			FILE *fp = ::g_fopen(m_filename.c_str(), "ab");
+			if (!fp)
+			{
+				g_warning("unable to open '%s': %s", m_filename.c_str(), g_strerror(errno));
+				return;
+			}
+			bool ok = true;
+			if (std::ftell(fp) == 0)
+				ok = (std::fwrite(HISTORY_MAGIC, HISTORY_MAGIC_LEN, 1, fp) == 1);
+			ok = ok && std::fwrite(&rec, sizeof(rec), 1, fp) == 1;
+			if (std::fclose(fp) != 0 || !ok)
+				g_warning("unable to write '%s': %s", m_filename.c_str(), g_strerror(errno));
+		}
+
+		void History::track(Runner &runner)
+		{
+			m_conns.push_back(runner.signal_finished().connect(
+				sigc::mem_fun(*this, &History::record)));
+		}
+
+		void History::record(const Job &job)
+		{
+			// a run with a lost status would count as a success
+			// using no memory
+			if (job.state() != Job::State::FINISHED || !job.exit_status_known())
+				return;
+
+			Record rec;
+			std::memset(&rec, 0, sizeof(rec));
+			rec.key = make_key(job.command_line(), job.working_dir());
+			rec.time = std::time(nullptr);
+			rec.wall_ms = static_cast<uint32_t>(job.elapsed_ms());
+			rec.exit_code = job.exit_code();
+			rec.peak_rss_kb = static_cast<uint32_t>(job.peak_rss_kb());
+
+			if (job.succeeded())
+			{
+				Trend baseline = compute_trend(rec.key, BASELINE_RUNS);
+				if (baseline.runs >= MIN_BASELINE_RUNS &&
+					rec.wall_ms > baseline.median_ms * m_regression_factor &&
+					rec.wall_ms - baseline.median_ms >= MIN_REGRESSION_MSEC)
+				{
+					::msgwin_status_add(_("%s took %.1fs, %.0f%% longer than its recent median of %.1fs"),
+						job.label().c_str(), rec.wall_ms / 1000.0,
+						(rec.wall_ms / baseline.median_ms - 1.0) * 100.0,
+						baseline.median_ms / 1000.0);
+					signal_regression_.emit(job, baseline.median_ms);
+				}
+			}
+
+			append(rec);
+		}
+
+		std::vector<HistoryEntry> History::last(const std::string &command_line,
+			const std::string &working_dir, size_t n) const
+		{
+			std::vector<HistoryEntry> entries;
+			auto it = m_by_key.find(make_key(command_line, working_dir));
+			if (it == m_by_key.end())
+				return entries;
+			auto &indices = it->second;
+			size_t first = indices.size() > n ? indices.size() - n : 0;
+			entries.reserve(indices.size() - first);
+			for (size_t i = first; i < indices.size(); i++)
+			{
+				const Record &rec = m_records[indices[i]];
+				HistoryEntry entry;
+				entry.time = rec.time;
+				entry.wall_ms = rec.wall_ms;
+				entry.exit_code = rec.exit_code;
+				entry.peak_rss_kb = rec.peak_rss_kb;
+				entries.push_back(entry);
+			}
+			return entries;
+		}
+
+		Trend History::trend(const std::string &command_line,
+			const std::string &working_dir, size_t n) const
+		{
+			return compute_trend(make_key(command_line, working_dir), n);
+		}
+
+		Trend History::compute_trend(uint64_t key, size_t n) const
+		{
+			Trend trend;
+			std::memset(&trend, 0, sizeof(trend));
+			auto it = m_by_key.find(key);
+			if (it == m_by_key.end())
+				return trend;
+
+			std::vector<uint32_t> times, rss;
+			auto &indices = it->second;
+			for (auto i = indices.rbegin(); i != indices.rend() && times.size() < n; ++i)
+			{
+				const Record &rec = m_records[*i];
+				if (rec.exit_code != 0)
+					continue;
+				if (times.empty())
+					trend.last_ms = rec.wall_ms;
+				times.push_back(rec.wall_ms);
+				rss.push_back(rec.peak_rss_kb);
+			}
+			if (times.empty())
+				return trend;
+
+			trend.runs = times.size();
+			std::sort(times.begin(), times.end());
+			std::sort(rss.begin(), rss.end());
+			size_t mid = times.size() / 2;
+			if (times.size() % 2)
+				trend.median_ms = times[mid];
+			else
+				trend.median_ms = (times[mid - 1] + double(times[mid])) / 2.0;
+			// nearest rank
+			size_t rank = (times.size() * 95 + 99) / 100;
+			trend.p95_ms = times[rank - 1];
+			trend.median_rss_kb = rss[mid];
+			return trend;
+		}
+
+	}
+
+}
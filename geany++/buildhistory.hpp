@@ -0,0 +1,148 @@
+#pragma once
+
+#include <geany++/buildrunner.hpp>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace Geany
+{
+
+	namespace Build
+	{
+
+		/**
+		 * One recorded run of a build command.
+		 */
+		struct HistoryEntry
+		{
+			int64_t time;               //!< When it finished, seconds since the epoch.
+			uint32_t wall_ms;           //!< Wall time in milliseconds.
+			int32_t exit_code;          //!< See Job::exit_code().
+			uint32_t peak_rss_kb;       //!< See Job::peak_rss_kb().
+		};
+
+		/**
+		 * Summary of a command's recent successful runs.
+		 */
+		struct Trend
+		{
+			size_t runs;                //!< Number of runs the figures are based on.
+			double last_ms;
+			double median_ms;
+			double p95_ms;
+			uint32_t median_rss_kb;
+		};
+
+		/**
+		 * Timing history of build commands.
+		 *
+		 * Runs are appended to a compact binary file with fixed size
+		 * records, one file per project. Commands are told apart by
+		 * their command line and working directory, so the same
+		 * compile command for different files has a history each.
+		 *
+		 * After recording a successful run, its wall time is compared
+		 * to the median of the previous runs and signal_regression()
+		 * is emitted if it's noticeably slower.
+		 */
+		class History
+		{
+		public:
+
+			/**
+			 * Open (or start) the history stored in @a filename.
+			 */
+			History(const std::string &filename);
+			~History();
+
+			/**
+			 * The history file for the open project, or for builds
+			 * outside of any project.
+			 */
+			static std::string default_filename();
+
+			const std::string &filename() const
+			{
+				return m_filename;
+			}
+
+			/**
+			 * Record every job run by @a runner once it finishes.
+			 */
+			void track(Runner &runner);
+
+			/**
+			 * Record a finished job, others are ignored.
+			 */
+			void record(const Job &job);
+
+			/**
+			 * The last @a n runs of a command, oldest first.
+			 */
+			std::vector<HistoryEntry> last(const std::string &command_line,
+				const std::string &working_dir, size_t n) const;
+
+			/**
+			 * Median and 95th percentile over the last @a n
+			 * successful runs of a command.
+			 */
+			Trend trend(const std::string &command_line,
+				const std::string &working_dir, size_t n = 20) const;
+
+			/**
+			 * How much slower than the median a run must be to count
+			 * as a regression, 1.25 means 25% slower.
+			 */
+			double regression_factor() const
+			{
+				return m_regression_factor;
+			}
+
+			void regression_factor(double factor)
+			{
+				m_regression_factor = factor;
+			}
+
+			/**
+			 * Signal emitted when a job took noticeably longer than
+			 * its baseline, with the baseline median in milliseconds.
+			 */
+			sigc::signal<void, const Job&, double> &signal_regression()
+			{
+				return signal_regression_;
+			}
+
+		private:
+			// the on-disk record, all integers in host byte order
+			struct Record
+			{
+				uint64_t key;
+				int64_t time;
+				uint32_t wall_ms;
+				int32_t exit_code;
+				uint32_t peak_rss_kb;
+				uint32_t reserved;
+			};
+
+			std::string m_filename;
+			std::vector<Record> m_records;
+			std::unordered_map<uint64_t, std::vector<size_t>> m_by_key;
+			double m_regression_factor;
+			std::vector<sigc::connection> m_conns;
+			sigc::signal<void, const Job&, double> signal_regression_;
+
+			History(const History&);
+			History &operator=(const History&);
+
+			void load();
+			void append(const Record &rec);
+			Trend compute_trend(uint64_t key, size_t n) const;
+			static uint64_t make_key(const std::string &command_line,
+				const std::string &working_dir);
+		};
+
+	}
+
+}
@@ -0,0 +1,610 @@
+#include <geany++/buildrunner.hpp>
+#include <geany++/document.hpp>
+#include <geany++/tracer_p.hpp>
+
+#ifdef HAVE_CONFIG_H
+#include <geany++/config.h>
+#endif
+
+#include <glib-unix.h>
+#include <cerrno>
+#include <csignal>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/resource.h>
+#include <sys/time.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+// bytes read from a job's pipe in one go, and the most read in one
+// callback before giving the main loop a chance to redraw
+#define READ_CHUNK_SIZE 65536
+#define READ_CHUNKS_PER_CALLBACK 4
+// how often running jobs are checked for having exited, a GLib child
+// watch would reap them itself and lose their resource usage
+#define REAP_INTERVAL_MSEC 50
+
+namespace Geany
+{
+
+	namespace Build
+	{
+
+		Job::Job(Runner &runner, size_t id, const Glib::ustring &label,
+			const std::string &command_line, const std::string &working_dir)
+			: m_runner(runner),
+			  m_id(id),
+			  m_label(label),
+			  m_command_line(command_line),
+			  m_working_dir(working_dir),
+			  m_state(State::QUEUED),
+			  m_exit_code(-1),
+			  m_parser(m_diagnostics, working_dir),
+			  m_pid(0),
+			  m_has_token(false),
+			  m_exited(false),
+			  m_status_known(false),
+			  m_cancelled(false),
+			  m_peak_rss_kb(0),
+			  m_open_pipes(0),
+			  m_start_time(0),
+			  m_end_time(0),
+			  m_out_fd(-1),
+			  m_err_fd(-1)
+		{
+			m_parser.signal_finished().connect(sigc::mem_fun(*this, &Job::on_parsed));
+		}
+
+		Job::~Job()
+		{
+			close_pipe(m_out_fd, m_out_conn);
+			close_pipe(m_err_fd, m_err_conn);
+			if (m_pid && !m_exited)
+			{
+				// don't leave a zombie behind, reap it whenever it exits
+				::kill(-m_pid, SIGTERM);
+				Glib::signal_child_watch().connect([](GPid pid, int) {
+					::g_spawn_close_pid(pid);
+				}, m_pid);
+			}
+		}
+
+		double Job::elapsed_ms() const
+		{
+			if (m_start_time == 0)
+				return 0.0;
+			gint64 end = m_end_time ? m_end_time : g_get_monotonic_time();
+			return (end - m_start_time) / 1000.0;
+		}
+
+		void Job::close_pipe(int &fd, sigc::connection &conn)
+		{
+			conn.disconnect();
+			if (fd >= 0)
+			{
+				::close(fd);
+				fd = -1;
+				m_open_pipes--;
+			}
+		}
+
+		bool Job::on_output(Glib::IOCondition cond, int fd)
+		{
+			Tracer::Span span("Build::Job::on_output", "io");
+			bool is_stderr = (fd == m_err_fd);
+			char buf[READ_CHUNK_SIZE];
+
+			for (int i = 0; i < READ_CHUNKS_PER_CALLBACK; i++)
+			{
+				ssize_t n = ::read(fd, buf, sizeof(buf));
+				if (n > 0)
+				{
+					std::string chunk(buf, n);
+					m_output += chunk;
+					m_parser.feed(chunk);
+					m_runner.signal_output_.emit(*this, chunk, is_stderr);
+					continue;
+				}
+				if (n < 0 && errno == EINTR)
+					continue;
+				if (n < 0 && errno == EAGAIN)
+					return true;
+
+				// end of file or an error
+				if (is_stderr)
+					close_pipe(m_err_fd, m_err_conn);
+				else
+					close_pipe(m_out_fd, m_out_conn);
+				maybe_finish();
+				return false;
+			}
+
+			return true;
+		}
+
+		void Job::on_exit(int status, const struct rusage &usage)
+		{
+			m_exited = true;
+			m_status_known = true;
+			// kilobytes on Linux and the BSDs, bytes on macOS
+#ifdef __APPLE__
+			m_peak_rss_kb = usage.ru_maxrss / 1024;
+#else
+			m_peak_rss_kb = usage.ru_maxrss;
+#endif
+			if (WIFEXITED(status))
+				m_exit_code = WEXITSTATUS(status);
+			else if (WIFSIGNALED(status))
+				m_exit_code = 128 + WTERMSIG(status);
+			maybe_finish();
+		}
+
+		// reaped by someone else, exit_code() stays -1
+		void Job::on_status_lost()
+		{
+			m_exited = true;
+			maybe_finish();
+		}
+
+		// a job's slot is free once the process exited and all its
+		// output was read, whichever happens last; it's done once the
+		// output left over was parsed in idle time too
+		void Job::maybe_finish()
+		{
+			if (!m_exited || m_open_pipes > 0 || m_end_time || is_done())
+				return;
+			m_end_time = g_get_monotonic_time();
+			m_runner.job_exited(*this);
+			m_parser.finish();
+		}
+
+		void Job::on_parsed()
+		{
+			if (!is_done())
+				m_runner.job_done(*this, m_cancelled ? State::CANCELLED : State::FINISHED);
+		}
+
+		// in the forked child before exec, only async-signal-safe calls
+		static void child_setup(gpointer data)
+		{
+			// a process group of its own so cancelling kills the
+			// whole tree, including anything make started
+			::setpgid(0, 0);
+			auto fds = static_cast<const int*>(data);
+			for (int i = 0; i < 2; i++)
+			{
+				if (fds[i] >= 0)
+					::fcntl(fds[i], F_SETFD, 0);
+			}
+		}
+
+		Runner::Runner(unsigned int max_jobs)
+			: m_max_jobs(max_jobs ? max_jobs : ::g_get_num_processors()),
+			  m_next_id(1),
+			  m_running(0),
+			  m_parsing(0),
+			  m_implicit_used(false),
+			  m_token_fd(-1)
+		{
+			m_jobserver[0] = m_jobserver[1] = -1;
+			if (m_max_jobs < 1)
+				m_max_jobs = 1;
+
+			GError *error = nullptr;
+			if (!::g_unix_open_pipe(m_jobserver, FD_CLOEXEC, &error))
+			{
+				g_warning("unable to create jobserver pipe: %s", error->message);
+				g_error_free(error);
+				m_jobserver[0] = m_jobserver[1] = -1;
+				return;
+			}
+
+			// one token for every slot but the implicit one each make
+			// client owns
+			std::string tokens(m_max_jobs - 1, '+');
+			if (!tokens.empty() && ::write(m_jobserver[1], tokens.data(), tokens.size()) < 0)
+				g_warning("unable to fill jobserver pipe: %s", g_strerror(errno));
+
+			// Children expect a blocking read end, so take tokens for
+			// ourselves through a separate non-blocking open of the same
+			// pipe. Without one the slots are only shared between the
+			// makes we start.
+			char path[64];
+			std::snprintf(path, sizeof(path), "/proc/self/fd/%d", m_jobserver[0]);
+			m_token_fd = ::open(path, O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+
+			char flags[128];
+			std::snprintf(flags, sizeof(flags), "-j%u --jobserver-fds=%d,%d --jobserver-auth=%d,%d",
+				m_max_jobs, m_jobserver[0], m_jobserver[1], m_jobserver[0], m_jobserver[1]);
+			m_makeflags = flags;
+		}
+
+		Runner::~Runner()
+		{
+			m_token_conn.disconnect();
+			m_reap_conn.disconnect();
+			m_jobs.clear();
+			if (m_token_fd >= 0)
+				::close(m_token_fd);
+			for (int i = 0; i < 2; i++)
+			{
+				if (m_jobserver[i] >= 0)
+					::close(m_jobserver[i]);
+			}
+		}
+
+		std::string Runner::substitute(const std::string &str, Document *doc)
+		{
+			if (str.find('%') == std::string::npos)
+				return str;
+
+			std::string filename, dirname, basename, project_dir, line;
+			if (doc && doc->is_valid() && doc->get()->file_name)
+			{
+				std::string path = Glib::filename_from_utf8(doc->filename());
+				filename = Glib::path_get_basename(path);
+				dirname = Glib::path_get_dirname(path);
+				basename = filename.substr(0, filename.rfind('.'));
+				line = std::to_string(::sci_get_current_line(doc->get()->editor->sci) + 1);
+			}
+			GeanyProject *project = Geany::data->app->project;
+			if (project && project->base_path)
+			{
+				project_dir = Glib::filename_from_utf8(project->base_path);
+				if (!Glib::path_is_absolute(project_dir))
+				{
+					std::string project_file = Glib::filename_from_utf8(project->file_name);
+					project_dir = Glib::build_filename(
+						Glib::path_get_dirname(project_file), project_dir);
+				}
+			}
+
+			std::string result;
+			result.reserve(str.size() + 64);
+			for (size_t i = 0; i < str.size(); i++)
+			{
+				if (str[i] != '%' || i + 1 == str.size())
+				{
+					result += str[i];
+					continue;
+				}
+				switch (str[i + 1])
+				{
+					case 'f': result += filename; break;
+					case 'd': result += dirname; break;
+					case 'e': result += basename; break;
+					case 'p': result += project_dir; break;
+					case 'l': result += line; break;
+					default: result += str[i]; continue;
+				}
+				i++;
+			}
+			return result;
+		}
+
+		size_t Runner::add(const Command &cmd, Document *doc)
+		{
+			if (!doc)
+				doc = Document::current();
+
+			// menu labels have mnemonics
+			Glib::ustring label;
+			for (auto c : cmd.label())
+			{
+				if (c != '_')
+					label += c;
+			}
+
+			std::string command_line = substitute(Glib::locale_from_utf8(cmd.command()), doc);
+			std::string working_dir = substitute(Glib::locale_from_utf8(cmd.working_dir()), doc);
+			if (working_dir.empty() && doc && doc->is_valid() && doc->get()->file_name)
+				working_dir = Glib::path_get_dirname(Glib::filename_from_utf8(doc->filename()));
+
+			return queue(new Job(*this, m_next_id++, label, command_line, working_dir));
+		}
+
+		size_t Runner::add(const Glib::ustring &label, const std::string &command_line,
+			const std::string &working_dir)
+		{
+			return queue(new Job(*this, m_next_id++, label, command_line, working_dir));
+		}
+
+		size_t Runner::queue(Job *job)
+		{
+			m_jobs.emplace_back(job);
+			start_queued();
+			return job->id();
+		}
+
+		size_t Runner::num_queued() const
+		{
+			size_t n = 0;
+			for (auto &job : m_jobs)
+			{
+				if (job->m_state == Job::State::QUEUED)
+					n++;
+			}
+			return n;
+		}
+
+		Job *Runner::find(size_t id)
+		{
+			for (auto &job : m_jobs)
+			{
+				if (job->id() == id)
+					return job.get();
+			}
+			return nullptr;
+		}
+
+		std::vector<Job*> Runner::list()
+		{
+			std::vector<Job*> jobs;
+			jobs.reserve(m_jobs.size());
+			for (auto &job : m_jobs)
+				jobs.push_back(job.get());
+			return jobs;
+		}
+
+		// takes a job slot, the first running job uses the implicit
+		// one, the others need a token from the jobserver
+		bool Runner::acquire_slot(Job &job)
+		{
+			if (m_running >= m_max_jobs)
+				return false;
+			if (!m_implicit_used)
+			{
+				m_implicit_used = true;
+				job.m_has_token = false;
+				return true;
+			}
+			if (m_token_fd < 0)
+			{
+				job.m_has_token = false;
+				return true;
+			}
+			char token;
+			ssize_t n;
+			do
+				n = ::read(m_token_fd, &token, 1);
+			while (n < 0 && errno == EINTR);
+			if (n != 1)
+				return false;
+			job.m_has_token = true;
+			return true;
+		}
+
+		void Runner::release_slot(Job &job)
+		{
+			if (job.m_has_token)
+			{
+				ssize_t n;
+				do
+					n = ::write(m_jobserver[1], "+", 1);
+				while (n < 0 && errno == EINTR);
+				job.m_has_token = false;
+			}
+			else if (m_token_fd >= 0 || m_running == 0)
+				m_implicit_used = false;
+		}
+
+		void Runner::start_queued()
+		{
+			// by index, signal handlers may add jobs
+			for (size_t i = 0; i < m_jobs.size(); i++)
+			{
+				Job &job = *m_jobs[i];
+				if (job.m_state != Job::State::QUEUED)
+					continue;
+				if (!acquire_slot(job))
+				{
+					// a make we started holds the tokens, wait for one
+					// to come back
+					if (m_token_fd >= 0 && m_running < m_max_jobs && !m_token_conn.connected())
+					{
+						m_token_conn = Glib::signal_io().connect(
+							sigc::mem_fun(*this, &Runner::on_token_available),
+							m_token_fd, Glib::IO_IN);
+					}
+					return;
+				}
+				if (!start(job))
+				{
+					release_slot(job);
+					job.m_state = Job::State::FAILED;
+					signal_finished_.emit(job);
+				}
+				else
+					signal_started_.emit(job);
+			}
+			m_token_conn.disconnect();
+		}
+
+		bool Runner::on_token_available(Glib::IOCondition)
+		{
+			m_token_conn.disconnect();
+			start_queued();
+			return false;
+		}
+
+		bool Runner::reap_children()
+		{
+			Tracer::Span span("Build::Runner::reap_children", "idle");
+			struct Exited
+			{
+				size_t id;
+				bool known;
+				int status;
+				struct rusage usage;
+			};
+			std::vector<Exited> exited;
+
+			for (auto &job : m_jobs)
+			{
+				if (job->m_state != Job::State::RUNNING || job->m_exited)
+					continue;
+				Exited e;
+				pid_t pid;
+				do
+					pid = ::wait4(job->m_pid, &e.status, WNOHANG, &e.usage);
+				while (pid < 0 && errno == EINTR);
+				if (pid == job->m_pid)
+				{
+					e.id = job->id();
+					e.known = true;
+					exited.push_back(e);
+				}
+				else if (pid < 0)
+				{
+					// reaped by someone else, the status is lost
+					e.id = job->id();
+					e.known = false;
+					exited.push_back(e);
+				}
+			}
+
+			// finishing a job runs signal handlers which may change the
+			// job list, so look each one up again
+			for (auto &e : exited)
+			{
+				Job *job = find(e.id);
+				if (job && e.known)
+					job->on_exit(e.status, e.usage);
+				else if (job)
+					job->on_status_lost();
+			}
+
+			return m_running > 0;
+		}
+
+		bool Runner::start(Job &job)
+		{
+			std::vector<char*> argv;
+			argv.push_back(const_cast<char*>("/bin/sh"));
+			argv.push_back(const_cast<char*>("-c"));
+			argv.push_back(const_cast<char*>(job.m_command_line.c_str()));
+			argv.push_back(nullptr);
+
+			gchar **envp = ::g_get_environ();
+			if (!m_makeflags.empty())
+				envp = ::g_environ_setenv(envp, "MAKEFLAGS", m_makeflags.c_str(), TRUE);
+
+			int in_fd = -1;
+			GError *error = nullptr;
+			gboolean ok = ::g_spawn_async_with_pipes(
+				job.m_working_dir.empty() ? nullptr : job.m_working_dir.c_str(),
+				argv.data(), envp, G_SPAWN_DO_NOT_REAP_CHILD, child_setup, m_jobserver,
+				&job.m_pid, &in_fd, &job.m_out_fd, &job.m_err_fd, &error);
+			::g_strfreev(envp);
+
+			if (!ok)
+			{
+				job.m_error = error->message;
+				g_error_free(error);
+				return false;
+			}
+
+			// nothing is ever written to the job, it sees end of file
+			::close(in_fd);
+
+			m_running++;
+			job.m_state = Job::State::RUNNING;
+			job.m_start_time = g_get_monotonic_time();
+			job.m_open_pipes = 2;
+
+			Job *pjob = &job;
+			for (int fd : { job.m_out_fd, job.m_err_fd })
+			{
+				::g_unix_set_fd_nonblocking(fd, TRUE, nullptr);
+				sigc::connection conn = Glib::signal_io().connect(
+					[pjob, fd](Glib::IOCondition cond) {
+						return pjob->on_output(cond, fd);
+					}, fd, Glib::IO_IN | Glib::IO_HUP | Glib::IO_ERR);
+				if (fd == job.m_out_fd)
+					job.m_out_conn = conn;
+				else
+					job.m_err_conn = conn;
+			}
+			if (!m_reap_conn.connected())
+			{
+				m_reap_conn = Glib::signal_timeout().connect(
+					sigc::mem_fun(*this, &Runner::reap_children), REAP_INTERVAL_MSEC);
+			}
+			return true;
+		}
+
+		// parsing what's left of its output doesn't need the slot
+		void Runner::job_exited(Job &job)
+		{
+			m_running--;
+			m_parsing++;
+			release_slot(job);
+			start_queued();
+		}
+
+		void Runner::job_done(Job &job, Job::State state)
+		{
+			job.m_state = state;
+			m_parsing--;
+
+			signal_finished_.emit(job);
+			if (!is_busy())
+				signal_idle_.emit();
+		}
+
+		void Runner::cancel(size_t id)
+		{
+			Job *job = find(id);
+			if (!job || job->is_done())
+				return;
+			if (job->m_state == Job::State::QUEUED)
+			{
+				job->m_state = Job::State::CANCELLED;
+				signal_finished_.emit(*job);
+				if (!is_busy())
+					signal_idle_.emit();
+				return;
+			}
+			// reported as cancelled once it exits
+			job->m_cancelled = true;
+			// the process group may be gone and its ID re-used
+			if (!job->m_end_time)
+				::kill(-job->m_pid, SIGTERM);
+		}
+
+		void Runner::cancel_all()
+		{
+			std::vector<size_t> ids;
+			for (auto &job : m_jobs)
+			{
+				if (!job->is_done())
+					ids.push_back(job->id());
+			}
+			// queued ones first, so none of them starts in place of a
+			// killed one
+			for (auto id : ids)
+			{
+				Job *job = find(id);
+				if (job && job->m_state == Job::State::QUEUED)
+					cancel(id);
+			}
+			for (auto id : ids)
+				cancel(id);
+		}
+
+		void Runner::clear_done()
+		{
+			for (auto it = m_jobs.begin(); it != m_jobs.end(); )
+			{
+				if ((*it)->is_done())
+					it = m_jobs.erase(it);
+				else
+					++it;
+			}
+		}
+
+	}
+
+}
@@ -0,0 +1,316 @@
+#pragma once
+
+#include <geany++/build.hpp>
+#include <geany++/diagnostics.hpp>
+#include <memory>
+#include <string>
+#include <vector>
+
+struct rusage;
+
+namespace Geany
+{
+
+	class Document;
+
+	namespace Build
+	{
+
+		class Runner;
+
+		/**
+		 * A command queued or running in a Runner.
+		 */
+		class Job
+		{
+		public:
+
+			enum class State
+			{
+				QUEUED,
+				RUNNING,
+				FINISHED,
+				CANCELLED,
+				FAILED
+			};
+
+			size_t id() const
+			{
+				return m_id;
+			}
+
+			const Glib::ustring &label() const
+			{
+				return m_label;
+			}
+
+			/// The command line with placeholders substituted.
+			const std::string &command_line() const
+			{
+				return m_command_line;
+			}
+
+			const std::string &working_dir() const
+			{
+				return m_working_dir;
+			}
+
+			State state() const
+			{
+				return m_state;
+			}
+
+			bool is_done() const
+			{
+				return m_state != State::QUEUED && m_state != State::RUNNING;
+			}
+
+			/**
+			 * The exit code, or 128 plus the signal number if the
+			 * command was killed. Only meaningful once finished, and
+			 * -1 if the exit status was lost.
+			 */
+			int exit_code() const
+			{
+				return m_exit_code;
+			}
+
+			/**
+			 * Whether exit_code() and peak_rss_kb() are known, the
+			 * status is lost if something else reaped the process.
+			 */
+			bool exit_status_known() const
+			{
+				return m_status_known;
+			}
+
+			bool succeeded() const
+			{
+				return m_state == State::FINISHED && m_exit_code == 0;
+			}
+
+			/// Combined stdout and stderr received so far.
+			const std::string &output() const
+			{
+				return m_output;
+			}
+
+			/// Wall time in milliseconds, so far if still running.
+			double elapsed_ms() const;
+
+			/// Diagnostics parsed from the output so far.
+			const DiagnosticStore &diagnostics() const
+			{
+				return m_diagnostics;
+			}
+
+			/**
+			 * Peak resident set size in kilobytes of the command and
+			 * the processes it waited for, 0 until it exited.
+			 */
+			unsigned long peak_rss_kb() const
+			{
+				return m_peak_rss_kb;
+			}
+
+			/// Message describing why the job couldn't be started.
+			const Glib::ustring &error() const
+			{
+				return m_error;
+			}
+
+		private:
+			Runner &m_runner;
+			size_t m_id;
+			Glib::ustring m_label;
+			std::string m_command_line;
+			std::string m_working_dir;
+			State m_state;
+			int m_exit_code;
+			std::string m_output;
+			Glib::ustring m_error;
+			DiagnosticStore m_diagnostics;
+			DiagnosticParser m_parser;
+			GPid m_pid;
+			bool m_has_token;
+			bool m_exited;
+			bool m_status_known;
+			bool m_cancelled;
+			unsigned long m_peak_rss_kb;
+			int m_open_pipes;
+			gint64 m_start_time;
+			gint64 m_end_time;
+			sigc::connection m_out_conn;
+			sigc::connection m_err_conn;
+			int m_out_fd;
+			int m_err_fd;
+
+			Job(Runner &runner, size_t id, const Glib::ustring &label,
+				const std::string &command_line, const std::string &working_dir);
+			~Job();
+			Job(const Job&);
+			Job &operator=(const Job&);
+
+			bool on_output(Glib::IOCondition cond, int fd);
+			void on_exit(int status, const struct rusage &usage);
+			void on_status_lost();
+			void close_pipe(int &fd, sigc::connection &conn);
+			void maybe_finish();
+			void on_parsed();
+
+			friend class Runner;
+			friend struct std::default_delete<Job>;
+		};
+
+		/**
+		 * Runs build commands as background processes, several at once.
+		 *
+		 * Commands are started in the order they were added, at most
+		 * max_jobs() at a time. The runner acts as a GNU make jobserver
+		 * for the commands it runs: a `make` started by one of them
+		 * shares the same job slots rather than each starting its own
+		 * `-j` worth of processes, so the total load stays bounded.
+		 *
+		 * Output is read without blocking as it arrives and is passed
+		 * through signal_output() and a DiagnosticParser per job.
+		 *
+		 * @note Only available on Unix-like systems.
+		 */
+		class Runner
+		{
+		public:
+
+			/**
+			 * @param max_jobs Number of job slots, 0 for the number
+			 * of processors.
+			 */
+			Runner(unsigned int max_jobs = 0);
+
+			/**
+			 * Kills any jobs still running.
+			 */
+			~Runner();
+
+			unsigned int max_jobs() const
+			{
+				return m_max_jobs;
+			}
+
+			/**
+			 * Queue a build command.
+			 *
+			 * Geany's placeholders (`%f`, `%d`, `%e`, `%p` and `%l`) in
+			 * the command and working directory are substituted using
+			 * @a doc, or the current document if it's `nullptr`.
+			 *
+			 * @return The job's ID.
+			 */
+			size_t add(const Command &cmd, Document *doc = nullptr);
+
+			/**
+			 * Queue a shell command line, run in @a working_dir or
+			 * the current directory if it's empty.
+			 */
+			size_t add(const Glib::ustring &label, const std::string &command_line,
+				const std::string &working_dir = std::string());
+
+			/**
+			 * Stop a job, killing its whole process group if it's
+			 * running.
+			 */
+			void cancel(size_t id);
+			void cancel_all();
+
+			/**
+			 * Forget about finished jobs.
+			 */
+			void clear_done();
+
+			Job *find(size_t id);
+			std::vector<Job*> list();
+
+			size_t num_running() const
+			{
+				return m_running;
+			}
+
+			size_t num_queued() const;
+
+			bool is_busy() const
+			{
+				return m_running > 0 || m_parsing > 0 || num_queued() > 0;
+			}
+
+			sigc::signal<void, Job&> &signal_started()
+			{
+				return signal_started_;
+			}
+
+			/**
+			 * Signal emitted for each chunk of output, the last
+			 * argument is whether it came from stderr.
+			 */
+			sigc::signal<void, Job&, const std::string&, bool> &signal_output()
+			{
+				return signal_output_;
+			}
+
+			/**
+			 * Signal emitted when a job is done, whether it finished,
+			 * failed to start or was cancelled.
+			 */
+			sigc::signal<void, Job&> &signal_finished()
+			{
+				return signal_finished_;
+			}
+
+			/**
+			 * Signal emitted when the last queued job is done.
+			 */
+			sigc::signal<void> &signal_idle()
+			{
+				return signal_idle_;
+			}
+
+			/**
+			 * Substitute Geany's build placeholders in @a str.
+			 */
+			static std::string substitute(const std::string &str, Document *doc);
+
+		private:
+			unsigned int m_max_jobs;
+			std::vector<std::unique_ptr<Job>> m_jobs;
+			size_t m_next_id;
+			size_t m_running;
+			// exited, but their output is still being parsed
+			size_t m_parsing;
+			bool m_implicit_used;
+			int m_jobserver[2];
+			int m_token_fd;
+			std::string m_makeflags;
+			sigc::connection m_token_conn;
+			sigc::connection m_reap_conn;
+			sigc::signal<void, Job&> signal_started_;
+			sigc::signal<void, Job&, const std::string&, bool> signal_output_;
+			sigc::signal<void, Job&> signal_finished_;
+			sigc::signal<void> signal_idle_;
+
+			Runner(const Runner&);
+			Runner &operator=(const Runner&);
+
+			size_t queue(Job *job);
+			void start_queued();
+			bool on_token_available(Glib::IOCondition cond);
+			bool acquire_slot(Job &job);
+			void release_slot(Job &job);
+			bool start(Job &job);
+			bool reap_children();
+			void job_exited(Job &job);
+			void job_done(Job &job, Job::State state);
+
+			friend class Job;
+		};
+
+	}
+
+}
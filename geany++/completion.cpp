@@ -0,0 +1,380 @@
+#include <geany++/completion_p.hpp>
+#include <geany++/editor.hpp>
+#include <geany++/geany_p.hpp>
+#include <geany++/providers_p.hpp>
+
+#ifdef HAVE_CONFIG_H
+#include <geany++/config.h>
+#endif
+
+#include <algorithm>
+#include <iterator>
+#include <unordered_map>
+
+// words shorter than this only ask for completions after a provider's
+// trigger character
+#define MIN_PREFIX_CHARS 3
+// most items shown in the list
+#define MAX_SHOWN_ITEMS  500
+// SCI_USERLISTSHOW's list type for our lists, Geany's own are small
+// numbers
+#define USER_LIST_TYPE   0x4350
+
+namespace Geany
+{
+
+	CompletionProvider::CompletionProvider(IPlugin &plugin)
+		: m_owner(&plugin.priv)
+	{
+		Completion::add_provider(this, m_owner);
+	}
+
+	CompletionProvider::~CompletionProvider()
+	{
+		remove();
+	}
+
+	void CompletionProvider::remove()
+	{
+		Completion::remove_provider(this);
+	}
+
+	namespace Completion
+	{
+
+		namespace
+		{
+			struct Request : Providers::Request<CompletionContext, std::vector<CompletionItem>>
+			{
+				// all providers' items, merged
+				std::vector<CompletionItem> items;
+			};
+
+			typedef Providers::Service<CompletionProvider, Request> Service;
+
+			// the last results, narrowed down as the word grows
+			struct Cache
+			{
+				DocumentHandle document;
+				unsigned long revision;
+				int word_start;
+				std::string prefix;
+				std::vector<CompletionItem> items;
+				bool user_list;
+			};
+
+			void call(CompletionProvider &provider, const CompletionContext &ctx,
+				std::vector<CompletionItem> &items);
+			void gather(Request &request);
+			void finish(const std::shared_ptr<Request> &request);
+
+			Service service("CompletionProvider::complete", call, gather, finish);
+			Cache cache;
+			// set while showing a list, replacing one fires
+			// SCN_AUTOCCANCELLED which isn't the user's doing
+			bool showing = false;
+
+			bool starts_with(const std::string &str, const std::string &prefix,
+				bool ignore_case)
+			{
+				if (str.size() < prefix.size())
+					return false;
+				if (ignore_case)
+					return g_ascii_strncasecmp(str.c_str(), prefix.c_str(), prefix.size()) == 0;
+				return str.compare(0, prefix.size(), prefix) == 0;
+			}
+
+			// dedups by label and ranks, exact-case prefix matches first,
+			// then by score, shorter labels first
+			void merge(std::vector<CompletionItem> &items, const std::string &prefix)
+			{
+				std::unordered_map<std::string, size_t> seen;
+				size_t out = 0;
+				for (size_t i = 0; i < items.size(); i++)
+				{
+					if (items[i].label.empty())
+						continue;
+					auto found = seen.find(items[i].label);
+					if (found == seen.end())
+					{
+						seen.emplace(items[i].label, out);
+						if (out != i)
+							items[out] = std::move(items[i]);
+						out++;
+					}
+					else if (items[i].score > items[found->second].score)
+						items[found->second] = std::move(items[i]);
+				}
+				items.resize(out);
+
+				std::sort(items.begin(), items.end(),
+					[&prefix](const CompletionItem &a, const CompletionItem &b) {
+						bool a_exact = starts_with(a.label, prefix, false);
+						bool b_exact = starts_with(b.label, prefix, false);
+						if (a_exact != b_exact)
+							return a_exact;
+						if (a.score != b.score)
+							return a.score > b.score;
+						if (a.label.size() != b.label.size())
+							return a.label.size() < b.label.size();
+						return a.label < b.label;
+					});
+			}
+
+			std::string text_range(Scintilla &sci, int start, int end)
+			{
+				std::string text(end - start + 1, '\0');
+				Sci_TextRange tr;
+				tr.chrg.cpMin = start;
+				tr.chrg.cpMax = end;
+				tr.lpstrText = &text[0];
+				sci.get_text_range(tr);
+				text.resize(end - start);
+				return text;
+			}
+
+			void forget()
+			{
+				service.cancel();
+				cache = Cache();
+			}
+
+			// shows the cached items matching @a prefix
+			void show(Scintilla &sci, const std::string &prefix)
+			{
+				std::vector<const CompletionItem*> shown;
+				for (auto &item : cache.items)
+				{
+					if (starts_with(item.label, prefix, true))
+						shown.push_back(&item);
+				}
+				if (shown.empty())
+				{
+					if (sci.auto_c_active())
+					{
+						showing = true;
+						sci.auto_c_cancel();
+						showing = false;
+					}
+					return;
+				}
+				// the cache was ranked for a shorter prefix
+				std::stable_partition(shown.begin(), shown.end(),
+					[&prefix](const CompletionItem *item) {
+						return starts_with(item->label, prefix, false);
+					});
+				if (shown.size() > MAX_SHOWN_ITEMS)
+					shown.resize(MAX_SHOWN_ITEMS);
+
+				char separator = static_cast<char>(sci.auto_c_get_separator());
+				char type_separator = static_cast<char>(sci.auto_c_get_type_separator());
+				std::string list;
+				for (auto item : shown)
+				{
+					const std::string &label = item->label;
+					if (label.find(separator) != std::string::npos ||
+						label.find(type_separator) != std::string::npos)
+					{
+						continue;
+					}
+					if (!list.empty())
+						list += separator;
+					list += label;
+					if (item->image >= 0)
+					{
+						list += type_separator;
+						list += std::to_string(item->image);
+					}
+				}
+				if (list.empty())
+					return;
+
+				// Scintilla takes the order when the list is set, put back
+				// what Geany's own lists expect afterwards
+				int order = sci.auto_c_get_order();
+				sci.auto_c_set_order(SC_ORDER_CUSTOM);
+				showing = true;
+				if (cache.user_list)
+					sci.user_list_show(USER_LIST_TYPE, list);
+				else
+					sci.auto_c_show(prefix.size(), list);
+				showing = false;
+				sci.auto_c_set_order(order);
+			}
+
+			void call(CompletionProvider &provider, const CompletionContext &ctx,
+				std::vector<CompletionItem> &items)
+			{
+				provider.complete(ctx, items);
+			}
+
+			void gather(Request &request)
+			{
+				for (auto &items : request.results)
+				{
+					request.items.insert(request.items.end(),
+						std::make_move_iterator(items.begin()),
+						std::make_move_iterator(items.end()));
+				}
+				request.results.clear();
+				merge(request.items, request.context.prefix);
+			}
+
+			void finish(const std::shared_ptr<Request> &request)
+			{
+				if (request != service.current())
+					return;
+				service.clear_current();
+
+				const CompletionContext &ctx = request->context;
+				Document *doc = ctx.document.get();
+				if (!doc || doc != Document::current() || doc->revision() != ctx.revision)
+					return;
+				Scintilla &sci = *doc->editor();
+				if (sci.get_current_pos() != ctx.position)
+					return;
+
+				cache.document = ctx.document;
+				cache.revision = ctx.revision;
+				cache.word_start = ctx.word_start;
+				cache.prefix = ctx.prefix;
+				cache.items = std::move(request->items);
+				cache.user_list = std::any_of(cache.items.begin(), cache.items.end(),
+					[](const CompletionItem &item) {
+						return !item.insert.empty() && item.insert != item.label;
+					});
+				show(sci, ctx.prefix);
+			}
+
+			void query(Document &doc, Scintilla &sci, const std::vector<Service::EntryPtr> &asked,
+				int ch, int position, int word_start, const std::string &prefix)
+			{
+				std::shared_ptr<Request> request(new Request);
+				CompletionContext &ctx = request->context;
+				Providers::init_context(ctx, doc, sci, position);
+				request->doc_id = doc.id();
+				ctx.word_start = word_start;
+				ctx.prefix = prefix;
+				ctx.trigger = ch;
+				service.submit(request, asked);
+			}
+
+			// after the word before the caret changed by one character,
+			// @a ch if it was typed
+			void update(Document &doc, Scintilla &sci, int ch)
+			{
+				// whatever was asked for the previous keystroke is stale
+				service.cancel();
+
+				int position = sci.get_current_pos();
+				int word_start = sci.word_start_position(position, true);
+				std::string prefix = text_range(sci, word_start, position);
+
+				// narrow down the last results if nothing but this word
+				// changed since
+				if (cache.document == doc.handle() && cache.word_start == word_start &&
+					cache.revision + 1 == doc.revision() &&
+					starts_with(prefix, cache.prefix, false))
+				{
+					cache.revision = doc.revision();
+					show(sci, prefix);
+					return;
+				}
+				// a list of ours still showing is stale now
+				bool ours = cache.document == doc.handle() && !cache.items.empty();
+				cache = Cache();
+				if (ours && sci.auto_c_active())
+					sci.auto_c_cancel();
+
+				auto asked = service.handling(doc);
+				bool triggered = false;
+				for (auto &entry : asked)
+				{
+					if (ch && entry->provider->is_trigger(ch))
+						triggered = true;
+				}
+				if (asked.empty() || (prefix.size() < MIN_PREFIX_CHARS && !triggered))
+					return;
+				query(doc, sci, asked, ch, position, word_start, prefix);
+			}
+
+			void insert_selection(Document &doc, Scintilla &sci, const char *label)
+			{
+				if (!label || cache.document != doc.handle())
+					return;
+				int position = sci.get_current_pos();
+				if (position < cache.word_start)
+					return;
+				for (auto &item : cache.items)
+				{
+					if (item.label == label)
+					{
+						sci.set_sel(cache.word_start, position);
+						sci.replace_sel(item.insert.empty() ? item.label : item.insert);
+						return;
+					}
+				}
+			}
+		}
+
+		bool active()
+		{
+			return service.active();
+		}
+
+		void add_provider(CompletionProvider *provider, PluginData *owner)
+		{
+			// notifications only reach documents with a wrapper
+			if (service.add(provider, owner))
+			{
+				for (auto doc : Document::list())
+					doc->editor();
+			}
+		}
+
+		void remove_provider(CompletionProvider *provider)
+		{
+			service.remove(provider);
+		}
+
+		void remove_providers(PluginData *owner)
+		{
+			service.remove_owner(owner);
+			if (!service.active())
+				forget();
+		}
+
+		void document_open(Document &doc)
+		{
+			if (active())
+				doc.editor();
+		}
+
+		void notify(Document &doc, Scintilla &sci, const SCNotification &nt)
+		{
+			switch (nt.nmhdr.code)
+			{
+				case SCN_CHARADDED:
+					update(doc, sci, nt.ch);
+					break;
+				case SCN_AUTOCCHARDELETED:
+					update(doc, sci, 0);
+					break;
+				case SCN_USERLISTSELECTION:
+					if (nt.listType == USER_LIST_TYPE)
+						insert_selection(doc, sci, nt.text);
+					forget();
+					break;
+				case SCN_AUTOCCANCELLED:
+					if (!showing)
+						forget();
+					break;
+				case SCN_AUTOCSELECTION:
+					forget();
+					break;
+			}
+		}
+
+	}
+
+}
@@ -0,0 +1,142 @@
+#pragma once
+
+#include <geany++/common.hpp>
+#include <geany++/document.hpp>
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace Geany
+{
+
+	/**
+	 * What a completion request is about.
+	 *
+	 * Everything is copied on the main thread when the request is made,
+	 * so providers can use it from a background thread.
+	 */
+	struct CompletionContext
+	{
+		DocumentHandle document;   //!< Only resolve it on the main thread.
+		unsigned long revision;    //!< The document's revision when the text was copied.
+		std::string filetype;      //!< The document's filetype name.
+		std::shared_ptr<const std::string> text;  //!< The whole document.
+		int position;              //!< The caret position.
+		int word_start;            //!< Where the word before the caret starts.
+		std::string prefix;        //!< The word before the caret, may be empty.
+		int trigger;               //!< The character which was typed.
+
+		/**
+		 * Whether the request was superseded, e.g. by the next
+		 * keystroke. Providers doing a lot of work should check it
+		 * now and then and return early.
+		 */
+		bool is_cancelled() const
+		{
+			return cancelled && cancelled->load(std::memory_order_relaxed);
+		}
+
+		//! Set by the framework, see is_cancelled().
+		std::shared_ptr<std::atomic<bool>> cancelled;
+	};
+
+	/**
+	 * One completion candidate.
+	 */
+	struct CompletionItem
+	{
+		std::string label;   //!< Shown in the list and inserted unless @a insert is set.
+		std::string insert;  //!< Text inserted instead of the label, replacing the prefix.
+		int score;           //!< Higher ranks first among items matching equally well.
+		int image;           //!< An image registered with SCI_REGISTERIMAGE, -1 for none.
+
+		CompletionItem(const std::string &label = std::string(), int score = 0,
+			int image = -1)
+			: label(label), score(score), image(image)
+		{
+		}
+	};
+
+	/**
+	 * Base class for plugins' sources of autocompletion candidates.
+	 *
+	 * As the user types, the framework asks each provider for the word
+	 * before the caret on a background thread, merges and ranks the
+	 * results and shows them with SCI_AUTOCSHOW, or with SCI_USERLISTSHOW
+	 * if any item inserts something other than its label. The next
+	 * keystroke cancels a request which hasn't finished yet.
+	 *
+	 * Results are kept while the word grows and narrowed down without
+	 * asking again, so providers must return every item starting with
+	 * the prefix they were given, not just the best few.
+	 *
+	 * Providers are registered when they're created. They're removed
+	 * when destroyed, or when their plugin is unloaded, before the
+	 * plugin is destroyed. A provider destroyed while its plugin stays
+	 * loaded must call remove() first, since complete() may be running
+	 * on another thread.
+	 *
+	 * For example:
+	 *
+	 * @code
+	 *   struct Words : public Geany::CompletionProvider
+	 *   {
+	 *     Words(Geany::IPlugin &plugin) : CompletionProvider(plugin) {}
+	 *     void complete(const Geany::CompletionContext &ctx,
+	 *       std::vector<Geany::CompletionItem> &items) override
+	 *     {
+	 *       ...scan *ctx.text for words starting with ctx.prefix...
+	 *     }
+	 *   };
+	 * @endcode
+	 */
+	class CompletionProvider
+	{
+	public:
+
+		virtual ~CompletionProvider();
+
+		/**
+		 * Stop asking this provider for completions, waiting for a
+		 * call to complete() running on another thread to return.
+		 */
+		void remove();
+
+		/**
+		 * Whether the provider has completions for @a doc at all, e.g.
+		 * by its filetype. Called on the main thread.
+		 */
+		virtual bool handles(G_GNUC_UNUSED Document &doc)
+		{
+			return true;
+		}
+
+		/**
+		 * Whether typing @a ch asks for completions even before
+		 * the word is long enough, like `.` or `->` in C.
+		 */
+		virtual bool is_trigger(G_GNUC_UNUSED int ch)
+		{
+			return false;
+		}
+
+		/**
+		 * Add the candidates for @a ctx to @a items.
+		 *
+		 * Called on a background thread, so it must not touch GTK,
+		 * Scintilla, Geany or the document, only the context.
+		 */
+		virtual void complete(const CompletionContext &ctx,
+			std::vector<CompletionItem> &items) = 0;
+
+	protected:
+		CompletionProvider(IPlugin &plugin);
+
+	private:
+		PluginData *m_owner;
+		CompletionProvider(const CompletionProvider&);
+		CompletionProvider &operator=(const CompletionProvider&);
+	};
+
+}
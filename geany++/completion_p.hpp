@@ -0,0 +1,37 @@
+#pragma once
+
+#include <geany++/completion.hpp>
+#include <geany++/scintilla.hpp>
+
+namespace Geany
+{
+
+	// The engine behind CompletionProvider. The proxy feeds it the
+	// editor notifications it needs, providers run on Worker threads
+	// and the results are shown back on the main thread if the caret
+	// and the text are still where they were when they were asked.
+	namespace Completion
+	{
+
+		// whether any provider is registered, nothing else is worth
+		// calling otherwise
+		bool active();
+
+		void add_provider(CompletionProvider *provider, PluginData *owner);
+		void remove_provider(CompletionProvider *provider);
+
+		// removes all of @a owner's providers, before the plugin is
+		// destroyed
+		void remove_providers(PluginData *owner);
+
+		// wraps @a doc's editor while there are providers, so its
+		// notifications get this far
+		void document_open(Document &doc);
+
+		// handles SCN_CHARADDED, SCN_AUTOCCHARDELETED, SCN_AUTOCSELECTION,
+		// SCN_AUTOCCANCELLED and SCN_USERLISTSELECTION
+		void notify(Document &doc, Scintilla &sci, const SCNotification &nt);
+
+	}
+
+}
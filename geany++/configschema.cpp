@@ -0,0 +1,52 @@
+#include <geany++/configschema.hpp>
+
+#ifdef HAVE_CONFIG_H
+#include <geany++/config.h>
+#endif
+
+#include <algorithm>
+
+namespace Geany
+{
+
+	ConfigValueBase::ConfigValueBase(ConfigSchema &schema, const char *group, const char *name)
+		: m_schema(schema), m_group(group), m_name(name)
+	{
+		schema.m_values.push_back(this);
+	}
+
+	ConfigSchema::ConfigSchema(PluginConfig &config)
+		: m_config(config)
+	{
+		m_loaded_conn = config.signal_loaded().connect(
+			sigc::mem_fun(*this, &ConfigSchema::refresh));
+		m_changed_conn = config.signal_changed().connect(
+			sigc::mem_fun(*this, &ConfigSchema::on_key_changed));
+	}
+
+	ConfigSchema::~ConfigSchema()
+	{
+		m_loaded_conn.disconnect();
+		m_changed_conn.disconnect();
+	}
+
+	void ConfigSchema::refresh()
+	{
+		const Glib::KeyFile &kf = m_config.keyfile();
+		for (auto value : m_values)
+			value->refresh(kf);
+	}
+
+	// PluginConfig::set() reports one key, only the value bound to it
+	// needs parsing again
+	void ConfigSchema::on_key_changed(const std::string &group, const std::string &key)
+	{
+		auto it = std::find_if(m_values.begin(), m_values.end(),
+			[&group, &key](const ConfigValueBase *value) {
+				return group == value->group() && key == value->name();
+			});
+		if (it != m_values.end())
+			(*it)->refresh(m_config.keyfile());
+	}
+
+}
@@ -0,0 +1,321 @@
+#pragma once
+
+#include <geany++/common.hpp>
+#include <geany++/pluginconfig.hpp>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace Geany
+{
+
+	/**
+	 * How values of type @a T are read from and written to a keyfile.
+	 *
+	 * Specialized for `bool`, `int`, `int64_t`, `uint64_t`, `double`
+	 * and `std::string`.
+	 */
+	template< class T >
+	struct ConfigTraits;
+
+	template<>
+	struct ConfigTraits<bool>
+	{
+		typedef bool default_type;
+		static bool read(const Glib::KeyFile &kf, const char *group, const char *key)
+		{
+			return kf.get_boolean(group, key);
+		}
+		static void write(Glib::KeyFile &kf, const char *group, const char *key, bool value)
+		{
+			kf.set_boolean(group, key, value);
+		}
+	};
+
+	template<>
+	struct ConfigTraits<int>
+	{
+		typedef int default_type;
+		static int read(const Glib::KeyFile &kf, const char *group, const char *key)
+		{
+			return kf.get_integer(group, key);
+		}
+		static void write(Glib::KeyFile &kf, const char *group, const char *key, int value)
+		{
+			kf.set_integer(group, key, value);
+		}
+	};
+
+	template<>
+	struct ConfigTraits<int64_t>
+	{
+		typedef int64_t default_type;
+		static int64_t read(const Glib::KeyFile &kf, const char *group, const char *key)
+		{
+			return kf.get_int64(group, key);
+		}
+		static void write(Glib::KeyFile &kf, const char *group, const char *key, int64_t value)
+		{
+			kf.set_int64(group, key, value);
+		}
+	};
+
+	template<>
+	struct ConfigTraits<uint64_t>
+	{
+		typedef uint64_t default_type;
+		static uint64_t read(const Glib::KeyFile &kf, const char *group, const char *key)
+		{
+			return kf.get_uint64(group, key);
+		}
+		static void write(Glib::KeyFile &kf, const char *group, const char *key, uint64_t value)
+		{
+			kf.set_uint64(group, key, value);
+		}
+	};
+
+	template<>
+	struct ConfigTraits<double>
+	{
+		typedef double default_type;
+		static double read(const Glib::KeyFile &kf, const char *group, const char *key)
+		{
+			return kf.get_double(group, key);
+		}
+		static void write(Glib::KeyFile &kf, const char *group, const char *key, double value)
+		{
+			kf.set_double(group, key, value);
+		}
+	};
+
+	template<>
+	struct ConfigTraits<std::string>
+	{
+		typedef const char *default_type;
+		static std::string read(const Glib::KeyFile &kf, const char *group, const char *key)
+		{
+			return kf.get_string(group, key);
+		}
+		static void write(Glib::KeyFile &kf, const char *group, const char *key, const std::string &value)
+		{
+			kf.set_string(group, key, value);
+		}
+	};
+
+	/**
+	 * Compile-time description of a config key.
+	 *
+	 * Descriptors are literal types so they can be declared `constexpr`,
+	 * for example:
+	 *
+	 * @code
+	 *   constexpr Geany::ConfigKey<int> TAB_WIDTH{ "settings", "tab_width", 4 };
+	 *   constexpr Geany::ConfigKey<std::string> THEME{ "ui", "theme", "dark" };
+	 * @endcode
+	 *
+	 * @note The group is the full keyfile group name, it isn't relative
+	 * to PluginConfig::current_group().
+	 */
+	template< class T >
+	struct ConfigKey
+	{
+		typedef T value_type;
+		const char *group;
+		const char *name;
+		typename ConfigTraits<T>::default_type default_value;
+	};
+
+	class ConfigSchema;
+
+	/**
+	 * Non-template part of ConfigValue.
+	 */
+	class ConfigValueBase
+	{
+	public:
+		virtual ~ConfigValueBase() {}
+		const char *group() const { return m_group; }
+		const char *name() const { return m_name; }
+
+	protected:
+		ConfigSchema &m_schema;
+		const char *m_group;
+		const char *m_name;
+		ConfigValueBase(ConfigSchema &schema, const char *group, const char *name);
+
+	private:
+		virtual void refresh(const Glib::KeyFile &kf) = 0;
+		ConfigValueBase(const ConfigValueBase&);
+		ConfigValueBase &operator=(const ConfigValueBase&);
+		friend class ConfigSchema;
+	};
+
+	/**
+	 * A config setting cached in its parsed form.
+	 *
+	 * Reading the value is a plain member load, the keyfile is only
+	 * consulted when the config file is loaded or the key is set.
+	 * Missing or unparsable keys read as the descriptor's default.
+	 *
+	 * @see ConfigSchema
+	 */
+	template< class T >
+	class ConfigValue : public ConfigValueBase
+	{
+	public:
+
+		ConfigValue(ConfigSchema &schema, const ConfigKey<T> &key);
+
+		const T &get() const
+		{
+			return m_value;
+		}
+
+		const T &operator()() const
+		{
+			return m_value;
+		}
+
+		operator const T&() const
+		{
+			return m_value;
+		}
+
+		/**
+		 * Change the value, writing it through to the PluginConfig
+		 * and scheduling a save.
+		 */
+		void set(const T &value);
+
+		/**
+		 * Reset the value to the descriptor's default.
+		 */
+		void reset()
+		{
+			set(T(m_default));
+		}
+
+		/**
+		 * Signal emitted when the cached value changes, either by
+		 * set() or because a different value was loaded.
+		 */
+		sigc::signal<void, const T&> &signal_changed()
+		{
+			return signal_changed_;
+		}
+
+	private:
+		T m_value;
+		typename ConfigTraits<T>::default_type m_default;
+		sigc::signal<void, const T&> signal_changed_;
+
+		void refresh(const Glib::KeyFile &kf) override;
+	};
+
+	/**
+	 * Base class for a plugin's typed settings.
+	 *
+	 * Derive from it and add ConfigValue members constructed from
+	 * ConfigKey descriptors, for example:
+	 *
+	 * @code
+	 *   struct Settings : public Geany::ConfigSchema
+	 *   {
+	 *     Geany::ConfigValue<int> tab_width;
+	 *     Geany::ConfigValue<std::string> theme;
+	 *
+	 *     Settings(Geany::PluginConfig &cfg)
+	 *       : ConfigSchema(cfg), tab_width(*this, TAB_WIDTH), theme(*this, THEME) {}
+	 *   };
+	 * @endcode
+	 *
+	 * All values are re-parsed whenever the PluginConfig is loaded,
+	 * and a single value when its key is changed through
+	 * PluginConfig::set().
+	 */
+	class ConfigSchema
+	{
+	public:
+
+		ConfigSchema(PluginConfig &config);
+		virtual ~ConfigSchema();
+
+		PluginConfig &config()
+		{
+			return m_config;
+		}
+
+		/**
+		 * Re-read every value from the keyfile.
+		 */
+		void refresh();
+
+		/**
+		 * Signal emitted after any value in the schema changed.
+		 */
+		sigc::signal<void> &signal_changed()
+		{
+			return signal_changed_;
+		}
+
+	private:
+		PluginConfig &m_config;
+		std::vector<ConfigValueBase*> m_values;
+		sigc::connection m_loaded_conn;
+		sigc::connection m_changed_conn;
+		sigc::signal<void> signal_changed_;
+
+		void on_key_changed(const std::string &group, const std::string &key);
+		ConfigSchema(const ConfigSchema&);
+		ConfigSchema &operator=(const ConfigSchema&);
+
+		friend class ConfigValueBase;
+		template< class T > friend class ConfigValue;
+	};
+
+	template< class T >
+	ConfigValue<T>::ConfigValue(ConfigSchema &schema, const ConfigKey<T> &key)
+		: ConfigValueBase(schema, key.group, key.name),
+		  m_value(key.default_value),
+		  m_default(key.default_value)
+	{
+		refresh(schema.config().keyfile());
+	}
+
+	template< class T >
+	void ConfigValue<T>::set(const T &value)
+	{
+		PluginConfig &config = m_schema.config();
+		ConfigTraits<T>::write(config.keyfile(), m_group, m_name, value);
+		config.mark_dirty();
+		config.save_later();
+		if (!(value == m_value))
+		{
+			m_value = value;
+			signal_changed_.emit(m_value);
+			m_schema.signal_changed_.emit();
+		}
+	}
+
+	template< class T >
+	void ConfigValue<T>::refresh(const Glib::KeyFile &kf)
+	{
+		T value(m_default);
+		try
+		{
+			if (kf.has_group(m_group) && kf.has_key(m_group, m_name))
+				value = ConfigTraits<T>::read(kf, m_group, m_name);
+		}
+		catch (Glib::KeyFileError&)
+		{
+			value = T(m_default);
+		}
+		if (!(value == m_value))
+		{
+			m_value = value;
+			signal_changed_.emit(m_value);
+			m_schema.signal_changed_.emit();
+		}
+	}
+
+}
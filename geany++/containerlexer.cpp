@@ -0,0 +1,253 @@
+#include <geany++/containerlexer.hpp>
+#include <geany++/scintilla.hpp>
+#include <geany++/tracer_p.hpp>
+
+#ifdef HAVE_CONFIG_H
+#include <geany++/config.h>
+#endif
+
+#include <algorithm>
+
+// lines fetched from Scintilla at a time
+#define LEX_BLOCK_LINES   256
+
+// styles are sent once this many bytes are buffered
+#define STYLE_FLUSH_BYTES (64 * 1024)
+
+// SCI_STARTSTYLING's mask, all bits since Scintilla 3.4 keeps
+// indicators separately
+#define STYLING_MASK      0xff
+
+// how long each idle slice lexing ahead may take, so typing and
+// redraws aren't held up
+#define LOOK_AHEAD_SLICE_USEC 5000
+// lines lexed ahead between clock checks
+#define LOOK_AHEAD_BATCH_LINES 1024
+
+namespace Geany
+{
+
+	ContainerLexer::ContainerLexer()
+		: m_sci(nullptr),
+		  m_look_ahead(false),
+		  m_lexed_end(0),
+		  m_dirty_end(-1),
+		  m_stats()
+	{
+	}
+
+	ContainerLexer::~ContainerLexer()
+	{
+		detach();
+	}
+
+	void ContainerLexer::attach(Scintilla &sci)
+	{
+		detach();
+		m_sci = &sci;
+		m_style_conn = sci.signal_style_needed().connect(
+			sigc::mem_fun(*this, &ContainerLexer::on_style_needed));
+		m_modified_conn = sci.signal_modified().connect(
+			sigc::mem_fun(*this, &ContainerLexer::on_modified));
+		sci.set_lexer(static_cast<int>(Lexer::CONTAINER));
+		invalidate(0);
+	}
+
+	void ContainerLexer::detach()
+	{
+		m_style_conn.disconnect();
+		m_modified_conn.disconnect();
+		m_idle_conn.disconnect();
+		m_sci = nullptr;
+		m_lexed_end = 0;
+		m_dirty_end = -1;
+	}
+
+	void ContainerLexer::invalidate(int line)
+	{
+		if (!m_sci)
+			return;
+		line = std::max(0, std::min(line, m_sci->get_line_count() - 1));
+		m_lexed_end = std::min(m_lexed_end, line);
+
+		// restyles what's on screen, the rest as it's scrolled to
+		int last_visible = m_sci->doc_line_from_visible(
+			m_sci->get_first_visible_line() + m_sci->lines_on_screen());
+		int end = last_visible + 1 < m_sci->get_line_count() ?
+			m_sci->position_from_line(last_visible + 1) : -1;
+		m_sci->start_styling(m_sci->position_from_line(line), STYLING_MASK);
+		m_sci->colourise(m_sci->position_from_line(line), end);
+		schedule_look_ahead();
+	}
+
+	void ContainerLexer::set_look_ahead(bool enable)
+	{
+		m_look_ahead = enable;
+		if (enable)
+			schedule_look_ahead();
+		else
+			m_idle_conn.disconnect();
+	}
+
+	void ContainerLexer::schedule_look_ahead()
+	{
+		if (m_look_ahead && m_sci && !m_idle_conn.connected())
+		{
+			m_idle_conn = Glib::signal_idle().connect(
+				sigc::mem_fun(*this, &ContainerLexer::on_idle), Glib::PRIORITY_LOW);
+		}
+	}
+
+	bool ContainerLexer::style_ahead(int max_lines)
+	{
+		if (!m_sci)
+			return false;
+		int length = m_sci->get_length();
+		int end_styled = m_sci->get_end_styled();
+		if (end_styled >= length)
+			return false;
+		int line = m_sci->line_from_position(end_styled) + std::max(max_lines, 1) - 1;
+		style_to(line + 1 < m_sci->get_line_count() ?
+			m_sci->position_from_line(line) : length);
+		return m_sci->get_end_styled() < length;
+	}
+
+	// styles the lines past the screen, the ones before it are styled
+	// already since lexing goes from the top down
+	bool ContainerLexer::on_idle()
+	{
+		Tracer::Span span("ContainerLexer::style_ahead", "idle");
+		gint64 deadline = g_get_monotonic_time() + LOOK_AHEAD_SLICE_USEC;
+		while (style_ahead(LOOK_AHEAD_BATCH_LINES))
+		{
+			if (g_get_monotonic_time() >= deadline)
+				return true;
+		}
+		return false;
+	}
+
+	void ContainerLexer::flush_styles()
+	{
+		if (m_styles.empty())
+			return;
+		m_sci->send(SCI_SETSTYLINGEX, m_styles.size(),
+			reinterpret_cast<intptr_t>(m_styles.data()));
+		m_styles.clear();
+		m_stats.style_runs++;
+	}
+
+	void ContainerLexer::style_to(int end_pos)
+	{
+		if (!m_sci)
+			return;
+
+		const int line_count = m_sci->get_line_count();
+		const int length = m_sci->get_length();
+		int line = m_sci->line_from_position(m_sci->get_end_styled());
+		// an edit may have split a CR LF, leaving the new line with a
+		// copied state, the line before it is still intact
+		if (line > 0 && line <= m_dirty_end)
+			line--;
+		// style whole lines, through the one @a end_pos is on
+		int end_line = m_sci->line_from_position(std::min(end_pos, length));
+		if (line > end_line)
+			return;
+
+		int state = line == 0 ? initial_state() : m_sci->get_line_state(line);
+		int pos = m_sci->position_from_line(line);
+		m_sci->start_styling(pos, STYLING_MASK);
+		m_styles.clear();
+
+		while (line <= end_line && line < line_count)
+		{
+			int block_end_line = std::min(line + LEX_BLOCK_LINES, line_count);
+			int block_end = block_end_line < line_count ?
+				m_sci->position_from_line(block_end_line) : length;
+			m_text.resize(block_end - pos + 1);
+			Sci_TextRange tr;
+			tr.chrg.cpMin = pos;
+			tr.chrg.cpMax = block_end;
+			tr.lpstrText = &m_text[0];
+			m_sci->get_text_range(tr);
+
+			const char *p = m_text.data();
+			const char *text_end = p + (block_end - pos);
+			while (line < block_end_line && line <= end_line)
+			{
+				// the block ends on a line start so every line but the
+				// document's last has its line end in it
+				const char *eol = p;
+				while (eol < text_end && *eol != '\n' && *eol != '\r')
+					eol++;
+				if (eol < text_end)
+					eol += (eol[0] == '\r' && eol + 1 < text_end && eol[1] == '\n') ? 2 : 1;
+				size_t len = eol - p;
+
+				size_t line_start = m_styles.size();
+				StyleWriter writer(m_styles, len);
+				int next = lex_line(p, len, state, writer);
+				m_styles.resize(line_start + len, '\0');
+				m_stats.lines_lexed++;
+
+				if (line >= m_dirty_end)
+					m_dirty_end = -1;
+				p = eol;
+				pos += len;
+				line++;
+				state = next;
+				if (line >= line_count)
+					break;
+
+				if (line < m_lexed_end && m_dirty_end < 0 &&
+					m_sci->get_line_state(line) == next)
+				{
+					// the old styles are right from here to m_lexed_end
+					flush_styles();
+					m_stats.convergences++;
+					line = m_lexed_end;
+					pos = line < line_count ? m_sci->position_from_line(line) : length;
+					m_sci->start_styling(pos, STYLING_MASK);
+					if (line < line_count)
+						state = m_sci->get_line_state(line);
+					break;
+				}
+				m_sci->set_line_state(line, next);
+
+				if (m_styles.size() >= STYLE_FLUSH_BYTES)
+					flush_styles();
+			}
+		}
+		flush_styles();
+
+		// stopping short of m_lexed_end without converging leaves lines
+		// after this styled from different states than the new ones
+		m_lexed_end = line;
+	}
+
+	bool ContainerLexer::on_style_needed(const SCNotification &nt)
+	{
+		Tracer::Span span("ContainerLexer::style_to", "lexer");
+		style_to(nt.position);
+		schedule_look_ahead();
+		return false;
+	}
+
+	// keeps the line numbers in step with the text, Scintilla itself
+	// moves the line states and lowers the styled end
+	bool ContainerLexer::on_modified(const SCNotification &nt)
+	{
+		if (!(nt.modificationType & (SC_MOD_INSERTTEXT | SC_MOD_DELETETEXT)))
+			return false;
+		int line = m_sci->line_from_position(nt.position);
+		int added = nt.linesAdded;
+		if (m_lexed_end > line)
+			m_lexed_end = std::max(line, m_lexed_end + added);
+		if (m_dirty_end > line)
+			m_dirty_end = std::max(line, m_dirty_end + added);
+		m_dirty_end = std::max(m_dirty_end, line + std::max(added, 0));
+		// the edit lowered the styled end, lex ahead again from there
+		schedule_look_ahead();
+		return false;
+	}
+
+}
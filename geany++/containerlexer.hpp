@@ -0,0 +1,212 @@
+#pragma once
+
+#include <geany++/common.hpp>
+#include <geany++/fwd.hpp>
+#include <algorithm>
+#include <string>
+
+namespace Geany
+{
+
+	/**
+	 * Collects the styles of one line for ContainerLexer::lex_line().
+	 *
+	 * Offsets are bytes from the start of the line. Bytes left
+	 * unstyled when lex_line() returns get style 0, styles past the end
+	 * of the line are dropped.
+	 */
+	class StyleWriter
+	{
+	public:
+
+		/**
+		 * Style the next @a length bytes.
+		 */
+		void style(size_t length, int style)
+		{
+			m_buf.append(std::min(length, m_length - position()), static_cast<char>(style));
+		}
+
+		/**
+		 * Style up to, but not including, offset @a end.
+		 */
+		void style_to(size_t end, int style)
+		{
+			if (end > position())
+				this->style(end - position(), style);
+		}
+
+		/**
+		 * Style the rest of the line, including its line end.
+		 */
+		void style_rest(int style)
+		{
+			style_to(m_length, style);
+		}
+
+		/**
+		 * The offset of the first byte not styled yet.
+		 */
+		size_t position() const
+		{
+			return m_buf.size() - m_line_start;
+		}
+
+	private:
+		std::string &m_buf;
+		size_t m_line_start;
+		size_t m_length;
+
+		StyleWriter(std::string &buf, size_t length)
+			: m_buf(buf), m_line_start(buf.size()), m_length(length)
+		{
+		}
+
+		friend class ContainerLexer;
+	};
+
+	/**
+	 * Base class for lexers of languages Scintilla doesn't know,
+	 * styling an editor in response to SCN_STYLENEEDED.
+	 *
+	 * Subclasses style one line at a time in lex_line(), which gets the
+	 * lexer state at the start of the line and returns the state at the
+	 * start of the next, like "inside a block comment". The states are
+	 * kept with SCI_SETLINESTATE, which moves them along as lines are
+	 * added and removed, so after an edit lexing restarts at the edited
+	 * line instead of the top of the file. It stops as soon as a line
+	 * past the edit starts in the same state it had before, since from
+	 * there on the earlier styles are still right; typing inside a
+	 * line usually restyles just that line.
+	 *
+	 * Styles are collected in a buffer and applied with
+	 * SCI_SETSTYLINGEX in large runs rather than one message per token.
+	 *
+	 * With set_look_ahead() the rest of the document is also lexed in
+	 * short slices of idle time, so jumping to the end of a large file
+	 * or paging down finds the lines already styled.
+	 *
+	 * A lexer styles one editor at a time and owns its line states.
+	 * Detach it, or destroy it, before the editor is destroyed, e.g. from
+	 * Document::signal_close().
+	 */
+	class ContainerLexer : public sigc::trackable
+	{
+	public:
+
+		/**
+		 * Counters to see how much work lexing takes.
+		 */
+		struct Stats
+		{
+			size_t lines_lexed;   //!< Lines passed to lex_line().
+			size_t style_runs;    //!< SCI_SETSTYLINGEX messages sent.
+			size_t convergences;  //!< Times lexing stopped early on a matching state.
+		};
+
+		ContainerLexer();
+		virtual ~ContainerLexer();
+
+		/**
+		 * Start styling @a sci, switching it to the container lexer
+		 * and discarding its current styles.
+		 */
+		void attach(Scintilla &sci);
+		void detach();
+
+		Scintilla *scintilla() const
+		{
+			return m_sci;
+		}
+
+		/**
+		 * Style at least up to @a end_pos right away, as
+		 * SCN_STYLENEEDED does.
+		 */
+		void style_to(int end_pos);
+
+		/**
+		 * Discard the styles from @a line on, e.g. after the lexer's
+		 * settings changed. The lines are restyled as they're shown.
+		 */
+		void invalidate(int line = 0);
+
+		/**
+		 * Lex the document past what's been shown while idle, off by
+		 * default.
+		 */
+		void set_look_ahead(bool enable);
+
+		bool look_ahead() const
+		{
+			return m_look_ahead;
+		}
+
+		/**
+		 * Style up to @a max_lines lines past the styled end, what each
+		 * idle slice does.
+		 *
+		 * @return Whether there's more left to style.
+		 */
+		bool style_ahead(int max_lines);
+
+		const Stats &stats() const
+		{
+			return m_stats;
+		}
+
+		void reset_stats()
+		{
+			m_stats = Stats();
+		}
+
+	protected:
+
+		/**
+		 * The state at the start of the first line.
+		 */
+		virtual int initial_state() const
+		{
+			return 0;
+		}
+
+		/**
+		 * Style one line.
+		 *
+		 * @param text The line's text including its line end, not
+		 * nul-terminated.
+		 * @param length The length of @a text in bytes.
+		 * @param state The state at the start of the line.
+		 * @param styles Receives the line's styles.
+		 * @return The state at the start of the next line.
+		 */
+		virtual int lex_line(const char *text, size_t length, int state,
+			StyleWriter &styles) = 0;
+
+	private:
+		Scintilla *m_sci;
+		sigc::connection m_style_conn;
+		sigc::connection m_modified_conn;
+		sigc::connection m_idle_conn;
+		bool m_look_ahead;
+		// the lines before this were lexed one after the other, so a
+		// line's state and styles match those of the lines before it,
+		// which is what allows stopping once the states converge
+		int m_lexed_end;
+		// the last line touched by edits not lexed yet, -1 if none
+		int m_dirty_end;
+		std::string m_text;
+		std::string m_styles;
+		Stats m_stats;
+
+		ContainerLexer(const ContainerLexer&);
+		ContainerLexer &operator=(const ContainerLexer&);
+
+		bool on_style_needed(const SCNotification &nt);
+		bool on_modified(const SCNotification &nt);
+		void flush_styles();
+		void schedule_look_ahead();
+		bool on_idle();
+	};
+
+}
@@ -0,0 +1,555 @@
+#include <geany++/diagnostics.hpp>
+#include <geany++/tracer_p.hpp>
+
+#ifdef HAVE_CONFIG_H
+#include <geany++/config.h>
+#endif
+
+#include <algorithm>
+#include <cstring>
+
+// how long each idle slice parsing queued output may take, so long
+// outputs are parsed in between redraws
+#define PARSE_SLICE_USEC 5000
+// lines parsed between clock checks
+#define PARSE_BATCH_LINES 256
+// consumed output is only dropped from the buffer once there's this much
+#define COMPACT_THRESHOLD (64 * 1024)
+
+namespace Geany
+{
+
+	namespace Build
+	{
+
+		size_t DiagnosticStore::intern_file(const std::string &filename)
+		{
+			auto it = m_file_index.find(filename);
+			if (it != m_file_index.end())
+				return it->second;
+			size_t file = m_files.size();
+			m_files.push_back(FileEntry());
+			m_files.back().name = filename;
+			m_file_index.emplace(filename, file);
+			return file;
+		}
+
+		size_t DiagnosticStore::find_file(const std::string &filename) const
+		{
+			auto it = m_file_index.find(filename);
+			if (it != m_file_index.end())
+				return it->second;
+			return size_t(-1);
+		}
+
+		size_t DiagnosticStore::add(Diagnostic diag)
+		{
+			size_t n = m_diags.size();
+			auto &by_line = m_files[diag.file].by_line;
+			unsigned int line = diag.line;
+			m_counts[static_cast<int>(diag.severity)]++;
+			m_diags.push_back(std::move(diag));
+
+			// compilers mostly report in line order, so this is
+			// normally an append
+			if (by_line.empty() || m_diags[by_line.back()].line <= line)
+				by_line.push_back(n);
+			else
+			{
+				auto pos = std::upper_bound(by_line.begin(), by_line.end(), line,
+					[this](unsigned int l, size_t idx) {
+						return l < m_diags[idx].line;
+					});
+				by_line.insert(pos, n);
+			}
+			return n;
+		}
+
+		size_t DiagnosticStore::count(Severity min_severity) const
+		{
+			size_t total = 0;
+			for (int i = static_cast<int>(min_severity); i <= static_cast<int>(Severity::FATAL); i++)
+				total += m_counts[i];
+			return total;
+		}
+
+		std::vector<const Diagnostic*> DiagnosticStore::for_file(const std::string &filename) const
+		{
+			std::vector<const Diagnostic*> diags;
+			size_t file = find_file(filename);
+			if (file == size_t(-1))
+				return diags;
+			auto &by_line = m_files[file].by_line;
+			diags.reserve(by_line.size());
+			for (auto idx : by_line)
+				diags.push_back(&m_diags[idx]);
+			return diags;
+		}
+
+		std::vector<const Diagnostic*> DiagnosticStore::for_line(const std::string &filename,
+			unsigned int line) const
+		{
+			std::vector<const Diagnostic*> diags;
+			size_t file = find_file(filename);
+			if (file == size_t(-1))
+				return diags;
+			auto &by_line = m_files[file].by_line;
+			auto first = std::lower_bound(by_line.begin(), by_line.end(), line,
+				[this](size_t idx, unsigned int l) {
+					return m_diags[idx].line < l;
+				});
+			for (auto it = first; it != by_line.end() && m_diags[*it].line == line; ++it)
+				diags.push_back(&m_diags[*it]);
+			return diags;
+		}
+
+		void DiagnosticStore::clear()
+		{
+			m_diags.clear();
+			m_files.clear();
+			m_file_index.clear();
+			std::fill(m_counts, m_counts + 4, 0);
+		}
+
+		// The matchers below look at each character of a line at most a
+		// couple of times, there's no backtracking however long the line
+		// (template errors easily produce lines of many kilobytes).
+
+		struct LineMatch
+		{
+			const char *file_begin;
+			const char *file_end;
+			unsigned int line;
+			unsigned int column;
+			const char *rest;
+		};
+
+		static inline bool is_digit(char c)
+		{
+			return c >= '0' && c <= '9';
+		}
+
+		static inline bool is_alpha(char c)
+		{
+			return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z');
+		}
+
+		// parses a decimal number, returns nullptr if there is none
+		static const char *read_number(const char *p, const char *end, unsigned int &n)
+		{
+			if (p >= end || !is_digit(*p))
+				return nullptr;
+			n = 0;
+			while (p < end && is_digit(*p))
+				n = n * 10 + (*p++ - '0');
+			return p;
+		}
+
+		static inline bool is_terminator(const char *p, const char *end, bool loose)
+		{
+			if (p < end && *p == ':')
+				return true;
+			// include chains end the location with a comma or nothing
+			return loose && (p == end || *p == ',');
+		}
+
+		// `:line[:col]:` after the file name
+		static bool match_colon_location(const char *p, const char *end,
+			bool loose, LineMatch &m)
+		{
+			const char *q = read_number(p + 1, end, m.line);
+			if (!q || !is_terminator(q, end, loose))
+				return false;
+			if (q == end)
+			{
+				m.column = 0;
+				m.rest = end;
+				m.file_end = p;
+				return true;
+			}
+			const char *r = read_number(q + 1, end, m.column);
+			if (r && is_terminator(r, end, loose))
+				m.rest = (r < end) ? r + 1 : end;
+			else
+			{
+				m.column = 0;
+				m.rest = q + 1;
+			}
+			m.file_end = p;
+			return true;
+		}
+
+		// `(line[,col])` followed by `:`, possibly after a space
+		static bool match_paren_location(const char *p, const char *end, LineMatch &m)
+		{
+			const char *q = read_number(p + 1, end, m.line);
+			if (!q || q >= end)
+				return false;
+			m.column = 0;
+			if (*q == ',')
+			{
+				q = read_number(q + 1, end, m.column);
+				if (!q)
+					return false;
+				// ranges like (12,5-9) or (12,5,14,2)
+				while (q < end && (is_digit(*q) || *q == ',' || *q == '-'))
+					q++;
+			}
+			if (q >= end || *q != ')')
+				return false;
+			q++;
+			while (q < end && *q == ' ')
+				q++;
+			if (q >= end || *q != ':')
+				return false;
+			m.file_end = p;
+			m.rest = q + 1;
+			return true;
+		}
+
+		static bool match_location(const char *begin, const char *end,
+			bool loose, LineMatch &m)
+		{
+			m.file_begin = begin;
+			const char *p = begin;
+			// Windows drive letter
+			if (end - begin >= 3 && is_alpha(begin[0]) && begin[1] == ':' &&
+				(begin[2] == '\\' || begin[2] == '/'))
+			{
+				p += 2;
+			}
+			for (; p < end; p++)
+			{
+				if (*p == ':')
+				{
+					if (p > begin && match_colon_location(p, end, loose, m))
+						return true;
+					// a file name never contains ": ", so this is prose
+					// like `make: *** [Makefile:12: all] Error 1`
+					if (p + 1 < end && p[1] == ' ')
+						return false;
+				}
+				else if (*p == '(')
+				{
+					if (p > begin && match_paren_location(p, end, m))
+						return true;
+				}
+			}
+			return false;
+		}
+
+		static bool match_keyword(const char *&p, const char *end, const char *keyword)
+		{
+			size_t len = std::strlen(keyword);
+			if (size_t(end - p) < len || ::g_ascii_strncasecmp(p, keyword, len) != 0)
+				return false;
+			// a whole word only
+			if (p + len < end && is_alpha(p[len]))
+				return false;
+			p += len;
+			return true;
+		}
+
+		// `severity[ CODE]:` at the start of the message, moves p past it
+		static bool match_severity(const char *&p, const char *end,
+			Severity &severity, std::string &code)
+		{
+			const char *q = p;
+			while (q < end && *q == ' ')
+				q++;
+
+			if (match_keyword(q, end, "fatal error"))
+				severity = Severity::FATAL;
+			else if (match_keyword(q, end, "error"))
+				severity = Severity::ERROR;
+			else if (match_keyword(q, end, "warning"))
+				severity = Severity::WARNING;
+			else if (match_keyword(q, end, "note") || match_keyword(q, end, "remark") ||
+				match_keyword(q, end, "info"))
+			{
+				severity = Severity::NOTE;
+			}
+			else
+				return false;
+
+			// MSVC's `error C2065:`
+			if (q < end && *q == ' ')
+			{
+				const char *c = q + 1;
+				while (c < end && is_alpha(*c))
+					c++;
+				const char *digits = c;
+				while (c < end && is_digit(*c))
+					c++;
+				if (c > digits && c < end && *c == ':')
+				{
+					code.assign(q + 1, c);
+					q = c;
+				}
+			}
+			if (q >= end || *q != ':')
+				return false;
+			q++;
+			while (q < end && *q == ' ')
+				q++;
+			p = q;
+			return true;
+		}
+
+		static bool starts_with(const char *begin, const char *end, const char *prefix)
+		{
+			size_t len = std::strlen(prefix);
+			return size_t(end - begin) >= len && std::memcmp(begin, prefix, len) == 0;
+		}
+
+		DiagnosticParser::DiagnosticParser(DiagnosticStore &store, const std::string &directory)
+			: m_store(store),
+			  m_pos(0),
+			  m_finished(false),
+			  m_last_file(size_t(-1))
+		{
+			set_directory(directory);
+		}
+
+		DiagnosticParser::~DiagnosticParser()
+		{
+			m_idle_conn.disconnect();
+		}
+
+		void DiagnosticParser::set_directory(const std::string &directory)
+		{
+			m_dirs.assign(1, directory);
+			m_last_raw.clear();
+			m_last_file = size_t(-1);
+		}
+
+		void DiagnosticParser::feed(const char *data, size_t len)
+		{
+			if (len == 0)
+				return;
+			m_buffer.append(data, len);
+			if (!m_idle_conn.connected())
+			{
+				m_idle_conn = Glib::signal_idle().connect(
+					sigc::mem_fun(*this, &DiagnosticParser::on_idle), Glib::PRIORITY_LOW);
+			}
+		}
+
+		void DiagnosticParser::finish()
+		{
+			m_finished = true;
+			if (!m_idle_conn.connected())
+			{
+				m_idle_conn = Glib::signal_idle().connect(
+					sigc::mem_fun(*this, &DiagnosticParser::on_idle), Glib::PRIORITY_LOW);
+			}
+		}
+
+		bool DiagnosticParser::is_pending() const
+		{
+			size_t len = m_buffer.size() - m_pos;
+			if (len == 0)
+				return false;
+			return m_finished || std::memchr(m_buffer.data() + m_pos, '\n', len) != nullptr;
+		}
+
+		void DiagnosticParser::reset()
+		{
+			m_idle_conn.disconnect();
+			m_buffer.clear();
+			m_pos = 0;
+			m_finished = false;
+			m_dirs.resize(1);
+			m_last_raw.clear();
+			m_last_file = size_t(-1);
+		}
+
+		bool DiagnosticParser::parse_some(size_t max_lines)
+		{
+			size_t first = m_store.size();
+			const char *buf = m_buffer.data();
+			size_t size = m_buffer.size();
+
+			for (size_t n = 0; n < max_lines && m_pos < size; n++)
+			{
+				auto nl = static_cast<const char*>(std::memchr(buf + m_pos, '\n', size - m_pos));
+				if (!nl)
+				{
+					if (m_finished)
+					{
+						parse_line(buf + m_pos, buf + size);
+						m_pos = size;
+					}
+					break;
+				}
+				parse_line(buf + m_pos, nl);
+				m_pos = nl - buf + 1;
+			}
+
+			if (m_pos == size)
+			{
+				m_buffer.clear();
+				m_pos = 0;
+			}
+			else if (m_pos >= COMPACT_THRESHOLD && m_pos >= size / 2)
+			{
+				m_buffer.erase(0, m_pos);
+				m_pos = 0;
+			}
+
+			bool pending = is_pending();
+			if (m_store.size() > first)
+				signal_parsed_.emit(first, m_store.size() - first);
+			if (!pending && m_finished)
+			{
+				m_finished = false;
+				signal_finished_.emit();
+			}
+			return pending;
+		}
+
+		bool DiagnosticParser::on_idle()
+		{
+			Tracer::Span span("DiagnosticParser::on_idle", "idle");
+			gint64 deadline = g_get_monotonic_time() + PARSE_SLICE_USEC;
+			while (parse_some(PARSE_BATCH_LINES))
+			{
+				if (g_get_monotonic_time() >= deadline)
+					return true;
+			}
+			return false;
+		}
+
+		bool DiagnosticParser::parse_make_directory(const char *begin, const char *end)
+		{
+			static const char ENTERING[] = ": Entering directory ";
+			static const char LEAVING[] = ": Leaving directory ";
+
+			// `make[2]: Entering directory '/path'`, the command name
+			// varies (gmake, mingw32-make), so only look near the start
+			const char *limit = std::min(end, begin + 32);
+			if (std::search(begin, limit, "make", "make" + 4) == limit)
+				return false;
+
+			const char *p = std::search(begin, end, ENTERING, ENTERING + sizeof(ENTERING) - 1);
+			bool entering = (p != end);
+			if (entering)
+				p += sizeof(ENTERING) - 1;
+			else
+			{
+				p = std::search(begin, end, LEAVING, LEAVING + sizeof(LEAVING) - 1);
+				if (p == end)
+					return false;
+				p += sizeof(LEAVING) - 1;
+			}
+
+			if (entering)
+			{
+				// quoted with '...', `...' or "..."
+				if (p < end && (*p == '\'' || *p == '`' || *p == '"'))
+					p++;
+				const char *q = end;
+				if (q > p && (q[-1] == '\'' || q[-1] == '"'))
+					q--;
+				m_dirs.push_back(std::string(p, q));
+			}
+			else if (m_dirs.size() > 1)
+				m_dirs.pop_back();
+
+			m_last_raw.clear();
+			m_last_file = size_t(-1);
+			return true;
+		}
+
+		size_t DiagnosticParser::resolve_file(const char *begin, const char *end)
+		{
+			if (m_last_file != size_t(-1) && m_last_raw.size() == size_t(end - begin) &&
+				std::memcmp(m_last_raw.data(), begin, end - begin) == 0)
+			{
+				return m_last_file;
+			}
+
+			m_last_raw.assign(begin, end);
+			const std::string &dir = m_dirs.back();
+			if (dir.empty() || Glib::path_is_absolute(m_last_raw))
+				m_last_file = m_store.intern_file(m_last_raw);
+			else
+				m_last_file = m_store.intern_file(Glib::build_filename(dir, m_last_raw));
+			return m_last_file;
+		}
+
+		void DiagnosticParser::parse_line(const char *begin, const char *end)
+		{
+			if (end > begin && end[-1] == '\r')
+				end--;
+			if (begin == end)
+				return;
+
+			// MSBuild prefixes lines with the project number, `12>`
+			const char *p = begin;
+			while (p < end && is_digit(*p))
+				p++;
+			if (p > begin && p < end && *p == '>')
+				begin = p + 1;
+			// nothing but the prefix
+			if (begin == end)
+				return;
+
+			bool included = false;
+			if (*begin == ' ' || *begin == '\t')
+			{
+				// GCC's `                 from b.h:3,` continuing an
+				// include chain, other indented lines are source
+				// snippets and the like
+				p = begin;
+				while (p < end && (*p == ' ' || *p == '\t'))
+					p++;
+				if (!starts_with(p, end, "from "))
+					return;
+				begin = p + 5;
+				included = true;
+			}
+			else if (starts_with(begin, end, "In file included from "))
+			{
+				begin += 22;
+				included = true;
+			}
+			else if (*begin == 'm' || *begin == 'g')
+			{
+				if (parse_make_directory(begin, end))
+					return;
+			}
+
+			LineMatch m;
+			if (!match_location(begin, end, included, m) || m.line == 0)
+				return;
+
+			Diagnostic diag;
+			diag.line = m.line;
+			diag.column = m.column;
+			p = m.rest;
+			if (included)
+			{
+				diag.severity = Severity::NOTE;
+				diag.message = "included from here";
+			}
+			else
+			{
+				if (!match_severity(p, end, diag.severity, diag.code))
+				{
+					// generic `file:line: message`, indented ones are
+					// GCC's `   required from here` context
+					diag.severity = (p < end && *p == ' ' && p + 1 < end && p[1] == ' ') ?
+						Severity::NOTE : Severity::ERROR;
+					while (p < end && *p == ' ')
+						p++;
+				}
+				diag.message.assign(p, end);
+			}
+			diag.file = resolve_file(m.file_begin, m.file_end);
+			m_store.add(std::move(diag));
+		}
+
+	}
+
+}
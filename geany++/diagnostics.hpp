@@ -0,0 +1,250 @@
+#pragma once
+
+#include <geany++/common.hpp>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace Geany
+{
+
+	namespace Build
+	{
+
+		enum class Severity
+		{
+			NOTE,
+			WARNING,
+			ERROR,
+			FATAL
+		};
+
+		/**
+		 * A single message from a compiler, linker or other tool
+		 * pointing at a location in a file.
+		 */
+		struct Diagnostic
+		{
+			/// Index of the file in the DiagnosticStore.
+			size_t file;
+			/// 1-based line number.
+			unsigned int line;
+			/// 1-based column number, 0 if the tool didn't give one.
+			unsigned int column;
+			Severity severity;
+			/// Tool specific code such as MSVC's `C2065`, may be empty.
+			std::string code;
+			std::string message;
+		};
+
+		/**
+		 * Collection of diagnostics indexed by file and line.
+		 *
+		 * File names are interned, each diagnostic refers to its file
+		 * by index so repeated locations in the same file (as in long
+		 * template instantiation traces) don't each store the path.
+		 */
+		class DiagnosticStore
+		{
+		public:
+
+			/**
+			 * Get the index for a file name, adding it if needed.
+			 */
+			size_t intern_file(const std::string &filename);
+
+			/**
+			 * Look up a file name's index without adding it.
+			 *
+			 * @return The index or `size_t(-1)` if the file has no
+			 * diagnostics.
+			 */
+			size_t find_file(const std::string &filename) const;
+
+			const std::string &file_name(size_t file) const
+			{
+				return m_files[file].name;
+			}
+
+			size_t num_files() const
+			{
+				return m_files.size();
+			}
+
+			/**
+			 * Add a diagnostic, `diag.file` must come from intern_file().
+			 *
+			 * @return The index of the new diagnostic.
+			 */
+			size_t add(Diagnostic diag);
+
+			const Diagnostic &operator[](size_t n) const
+			{
+				return m_diags[n];
+			}
+
+			const std::vector<Diagnostic> &list() const
+			{
+				return m_diags;
+			}
+
+			size_t size() const
+			{
+				return m_diags.size();
+			}
+
+			bool empty() const
+			{
+				return m_diags.empty();
+			}
+
+			/**
+			 * Number of diagnostics at or above a severity.
+			 */
+			size_t count(Severity min_severity) const;
+
+			/**
+			 * Diagnostics for a file ordered by line, then by the order
+			 * they were added.
+			 */
+			std::vector<const Diagnostic*> for_file(const std::string &filename) const;
+
+			/**
+			 * Diagnostics on one line of a file.
+			 */
+			std::vector<const Diagnostic*> for_line(const std::string &filename,
+				unsigned int line) const;
+
+			void clear();
+
+		private:
+			struct FileEntry
+			{
+				std::string name;
+				// indices into m_diags sorted by line
+				std::vector<size_t> by_line;
+			};
+
+			std::vector<Diagnostic> m_diags;
+			std::vector<FileEntry> m_files;
+			std::unordered_map<std::string, size_t> m_file_index;
+			size_t m_counts[4] = { 0, 0, 0, 0 };
+		};
+
+		/**
+		 * Incremental parser turning build output into diagnostics.
+		 *
+		 * Output is fed in arbitrary chunks as it arrives, complete
+		 * lines are parsed from the main loop's idle time in short
+		 * slices, so huge outputs never block the UI. Recognized
+		 * formats are:
+		 *
+		 *  - GCC/Clang: `file:line[:col]: severity: message`
+		 *  - MSVC: `file(line[,col]): severity CODE: message`
+		 *  - generic: `file:line[:col]: message`
+		 *
+		 * Make's `Entering directory`/`Leaving directory` lines are
+		 * followed so relative file names resolve correctly in
+		 * recursive builds.
+		 */
+		class DiagnosticParser
+		{
+		public:
+
+			DiagnosticParser(DiagnosticStore &store,
+				const std::string &directory = std::string());
+			~DiagnosticParser();
+
+			DiagnosticStore &store()
+			{
+				return m_store;
+			}
+
+			/**
+			 * Directory relative file names are resolved against.
+			 */
+			void set_directory(const std::string &directory);
+
+			/**
+			 * Queue a chunk of output, it doesn't need to end on a
+			 * line boundary.
+			 */
+			void feed(const char *data, size_t len);
+
+			void feed(const std::string &data)
+			{
+				feed(data.data(), data.size());
+			}
+
+			/**
+			 * Mark the end of the output, a trailing line without a
+			 * newline is parsed as well.
+			 */
+			void finish();
+
+			/**
+			 * Parse up to @a max_lines queued lines right away.
+			 *
+			 * @return Whether there are still lines left to parse.
+			 */
+			bool parse_some(size_t max_lines);
+
+			/**
+			 * Parse all queued lines right away.
+			 */
+			void parse_all()
+			{
+				while (parse_some(size_t(-1)));
+			}
+
+			bool is_pending() const;
+
+			/**
+			 * Discard queued output and reset the directory stack,
+			 * the store isn't touched.
+			 */
+			void reset();
+
+			/**
+			 * Signal emitted after each batch of parsing with the
+			 * index and number of diagnostics added to the store.
+			 */
+			sigc::signal<void, size_t, size_t> &signal_parsed()
+			{
+				return signal_parsed_;
+			}
+
+			/**
+			 * Signal emitted once all output is parsed after finish().
+			 */
+			sigc::signal<void> &signal_finished()
+			{
+				return signal_finished_;
+			}
+
+		private:
+			DiagnosticStore &m_store;
+			std::string m_buffer;
+			size_t m_pos;
+			bool m_finished;
+			std::vector<std::string> m_dirs;
+			// the last resolved file, consecutive diagnostics mostly
+			// share it
+			std::string m_last_raw;
+			size_t m_last_file;
+			sigc::connection m_idle_conn;
+			sigc::signal<void, size_t, size_t> signal_parsed_;
+			sigc::signal<void> signal_finished_;
+
+			DiagnosticParser(const DiagnosticParser&);
+			DiagnosticParser &operator=(const DiagnosticParser&);
+
+			bool on_idle();
+			void parse_line(const char *begin, const char *end);
+			bool parse_make_directory(const char *begin, const char *end);
+			size_t resolve_file(const char *begin, const char *end);
+		};
+
+	}
+
+}
@@ -1,17 +1,61 @@
 #include <geany++/document.hpp>
+#include <geany++/editor.hpp>
 #include <geany++/geany_p.hpp>
+#include <geany++/worker_p.hpp>
 
 #ifdef HAVE_CONFIG_H
 #include <geany++/config.h>
 #endif
 
+#include <glib/gstdio.h>
+#include <sys/stat.h>
+#include <cerrno>
+#include <cstring>
+#include <memory>
+#include <fcntl.h>
+#include <unistd.h>
+
 namespace Geany
 {
 
 	Document::Document(GeanyDocument *doc)
 		: m_doc(doc),
-		  m_ed(DOC_VALID(doc) ? new Editor(doc->editor) : nullptr)
+		  m_revision(0),
+		  m_saving(false),
+		  m_save_again(false),
+		  m_typing()
+	{
+	}
+
+	// out of line for m_ed, the header only forward declares Editor
+	Document::~Document()
+	{
+	}
+
+	Editor *Document::editor() const
+	{
+		if (!m_ed && DOC_VALID(m_doc))
+			m_ed.reset(new Editor(m_doc->editor));
+		return m_ed.get();
+	}
+
+	DocumentSlotBase::DocumentSlotBase(IPlugin &plugin)
+		: m_owner(&plugin.priv)
+	{
+		m_id = m_owner->proxy.documents.alloc_slot(m_owner);
+	}
+
+	DocumentSlotBase::~DocumentSlotBase()
 	{
+		if (g_proxy)
+			g_proxy->documents.free_slot(m_id, m_owner);
+	}
+
+	Document *DocumentHandle::get() const
+	{
+		if (g_proxy)
+			return g_proxy->documents.lookup(*this);
+		return nullptr;
 	}
 
 	Document *Document::current()
@@ -42,6 +86,18 @@ namespace Geany
 	Document *Document::open(const std::string &filename, bool ro,
 		Filetype *filetype, const std::string &encoding)
 	{
+		size_t threshold = large_file_options().threshold;
+		if (ro && encoding.empty() && threshold > 0)
+		{
+			struct stat st;
+			if (stat(filename.c_str(), &st) == 0 && S_ISREG(st.st_mode) &&
+				static_cast<size_t>(st.st_size) >= threshold)
+			{
+				if (auto doc = open_large(filename, filetype))
+					return doc;
+			}
+		}
+
 		GeanyDocument *doc = ::document_open_file(
 			filename.c_str(), ro,
 			filetype ? filetype->get() : nullptr,
@@ -49,4 +105,180 @@ namespace Geany
 		return g_proxy->documents.add(doc);
 	}
 
+	//
+	// Asynchronous saving
+	//
+
+	struct AsyncSave
+	{
+		DocumentHandle handle;
+		unsigned long revision;
+		std::string filename;
+		std::string text;
+		std::string encoding;
+		mode_t new_file_mode;
+		bool ok;
+		Glib::ustring error;
+	};
+
+	static bool is_utf8_charset(const std::string &enc)
+	{
+		return enc.empty() || enc == "UTF-8" || enc == "None";
+	}
+
+	static bool write_all(int fd, const char *data, size_t len)
+	{
+		while (len > 0)
+		{
+			ssize_t n = ::write(fd, data, len);
+			if (n < 0)
+			{
+				if (errno == EINTR)
+					continue;
+				return false;
+			}
+			data += n;
+			len -= n;
+		}
+		return true;
+	}
+
+	// runs on a worker thread
+	static void write_async_save(AsyncSave &job)
+	{
+		if (!is_utf8_charset(job.encoding))
+		{
+			try
+			{
+				job.text = Glib::convert(job.text, job.encoding, "UTF-8");
+			}
+			catch (Glib::ConvertError &err)
+			{
+				job.error = err.what();
+				return;
+			}
+		}
+
+		// the temporary file must be on the same filesystem for
+		// the rename to be atomic, so put it next to the real one
+		std::string tmp_filename = job.filename + ".XXXXXX";
+		int fd = g_mkstemp(&tmp_filename[0]);
+		if (fd < 0)
+		{
+			job.error = g_strerror(errno);
+			return;
+		}
+
+		struct stat st;
+		if (stat(job.filename.c_str(), &st) == 0)
+			fchmod(fd, st.st_mode & 07777);
+		else
+			fchmod(fd, job.new_file_mode);
+
+		bool ok = write_all(fd, job.text.data(), job.text.size());
+		if (ok)
+			ok = (fsync(fd) == 0);
+		int saved_errno = errno;
+		if (close(fd) != 0 && ok)
+		{
+			ok = false;
+			saved_errno = errno;
+		}
+		if (ok && g_rename(tmp_filename.c_str(), job.filename.c_str()) != 0)
+		{
+			ok = false;
+			saved_errno = errno;
+		}
+
+		if (!ok)
+		{
+			g_unlink(tmp_filename.c_str());
+			job.error = g_strerror(saved_errno);
+			return;
+		}
+		job.ok = true;
+	}
+
+	bool Document::save_async()
+	{
+		if (!DOC_VALID(m_doc) || m_doc->readonly || !m_doc->file_name)
+			return false;
+
+		if (m_saving)
+		{
+			m_save_again = true;
+			return true;
+		}
+
+		signal_before_save_.emit();
+
+		std::shared_ptr<AsyncSave> job(new AsyncSave);
+		job->handle = handle();
+		job->revision = m_revision;
+		job->ok = false;
+
+		// follow symlinks rather than replacing them with a file
+		if (m_doc->real_path)
+			job->filename = m_doc->real_path;
+		else
+		{
+			gchar *locale_fn = ::utils_get_locale_from_utf8(m_doc->file_name);
+			job->filename = locale_fn;
+			g_free(locale_fn);
+		}
+
+		job->encoding = m_doc->encoding ? m_doc->encoding : "";
+		if (m_doc->has_bom && !job->encoding.empty())
+			job->text = "\xEF\xBB\xBF"; // U+FEFF, encoded along with the text
+
+		job->new_file_mode = g_proxy->new_file_mode;
+
+		Scintilla *sci = editor();
+		size_t bom_len = job->text.size();
+		size_t len = sci->send(SCI_GETLENGTH);
+		job->text.resize(bom_len + len + 1);
+		sci->send(SCI_GETTEXT, len + 1,
+			reinterpret_cast<intptr_t>(&job->text[bom_len]));
+		job->text.resize(bom_len + len);
+
+		m_saving = true;
+		Worker::submit([job]() {
+			write_async_save(*job);
+			Worker::invoke_in_main([job]() {
+				if (auto doc = job->handle.get())
+					doc->finish_save_async(job->ok, job->revision, job->error);
+			});
+		});
+
+		return true;
+	}
+
+	void Document::finish_save_async(bool ok, unsigned long revision,
+		const Glib::ustring &error)
+	{
+		m_saving = false;
+
+		if (ok)
+		{
+			// if it was edited meanwhile, the file is already out of date
+			if (revision == m_revision)
+			{
+				editor()->set_save_point();
+				::document_set_text_changed(m_doc, FALSE);
+			}
+			signal_save_.emit();
+		}
+		else
+		{
+			::ui_set_statusbar(TRUE, _("Error saving file (%s)."), error.c_str());
+			signal_save_failed_.emit(error);
+		}
+
+		if (m_save_again)
+		{
+			m_save_again = false;
+			save_async();
+		}
+	}
+
 }
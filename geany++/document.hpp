@@ -1,8 +1,9 @@
 #pragma once
 
 #include <geany++/common.hpp>
-#include <geany++/editor.hpp>
 #include <geany++/filetype.hpp>
+#include <geany++/fwd.hpp>
+#include <geany++/latency.hpp>
 #include <memory>
 #include <string>
 #include <vector>
@@ -10,10 +11,158 @@
 namespace Geany
 {
 
+	/**
+	 * A weak reference to a Document which can outlive it.
+	 *
+	 * Handles are cheap to copy and store, resolving one is a single
+	 * indexed load in the document registry. Once the document is
+	 * closed the handle goes stale and get() returns `nullptr`, even
+	 * if Geany re-uses the document's slot for another file.
+	 */
+	class DocumentHandle
+	{
+	public:
+
+		DocumentHandle()
+			: m_index(0), m_id(0), m_set(false)
+		{
+		}
+
+		/**
+		 * Resolve the handle.
+		 *
+		 * @return The referenced document or `nullptr` if the handle
+		 * is empty or the document was closed.
+		 */
+		Document *get() const;
+
+		bool is_valid() const
+		{
+			return (get() != nullptr);
+		}
+
+		explicit operator bool() const
+		{
+			return is_valid();
+		}
+
+		bool operator==(const DocumentHandle &other) const
+		{
+			return (m_set == other.m_set && m_index == other.m_index &&
+				m_id == other.m_id);
+		}
+
+		bool operator!=(const DocumentHandle &other) const
+		{
+			return !(*this == other);
+		}
+
+	private:
+		unsigned int m_index;
+		unsigned int m_id;
+		bool m_set;
+
+		DocumentHandle(unsigned int index, unsigned int id)
+			: m_index(index), m_id(id), m_set(true)
+		{
+		}
+
+		friend class Document;
+		friend class DocumentManager;
+	};
+
+	/**
+	 * Non-template part of DocumentSlot.
+	 *
+	 * @see DocumentSlot
+	 */
+	class DocumentSlotBase
+	{
+	public:
+
+		size_t id() const
+		{
+			return m_id;
+		}
+
+	protected:
+		DocumentSlotBase(IPlugin &plugin);
+		~DocumentSlotBase();
+
+	private:
+		size_t m_id;
+		PluginData *m_owner;
+		DocumentSlotBase(const DocumentSlotBase&);
+		DocumentSlotBase &operator=(const DocumentSlotBase&);
+	};
+
+	/**
+	 * Key for per-document plugin state of type @a T.
+	 *
+	 * Each slot gets a small integer ID when it's created, values are
+	 * stored in an array inside every Document so getting at them is
+	 * an indexed load rather than a hash table lookup. Values are
+	 * default-constructed on first access and destroyed when their
+	 * document closes, or for all documents at once when the slot is
+	 * destroyed or the plugin owning it is unloaded.
+	 *
+	 * For example:
+	 *
+	 * @code
+	 *   struct MyPlugin : public Geany::IPlugin
+	 *   {
+	 *     Geany::DocumentSlot<MyState> state;
+	 *     MyPlugin(Geany::PluginData &init_data)
+	 *       : IPlugin(init_data), state(*this) {}
+	 *   };
+	 *   ...
+	 *   MyState &st = doc.slot(plugin.state);
+	 * @endcode
+	 */
+	template< class T >
+	class DocumentSlot : public DocumentSlotBase
+	{
+	public:
+		DocumentSlot(IPlugin &plugin) : DocumentSlotBase(plugin) {}
+		T &get(Document &doc) const;
+		T *find(const Document &doc) const;
+	};
+
+	/**
+	 * Settings for opening big files read-only.
+	 *
+	 * @see Document::open_large()
+	 */
+	struct LargeFileOptions
+	{
+		size_t threshold;     //!< Read-only opens of files at least this big use large-file mode, 0 disables it.
+		size_t chunk_size;    //!< Approximate number of bytes added to the buffer per main loop iteration.
+		size_t lexing_limit;  //!< Files bigger than this are opened without syntax highlighting, 0 means no limit.
+
+		LargeFileOptions()
+			: threshold(64 * 1024 * 1024),
+			  chunk_size(4 * 1024 * 1024),
+			  lexing_limit(256 * 1024 * 1024)
+		{
+		}
+	};
+
+	/**
+	 * Timing for a file opened in large-file mode.
+	 */
+	struct LargeFileStats
+	{
+		size_t bytes;           //!< Size of the file.
+		double first_paint_ms;  //!< Time from the open call until the editor first painted.
+		double load_ms;         //!< Time from the open call until all text was loaded.
+	};
+
 	class Document
 	{
 	public:
 
+		~Document();
+
 		GeanyDocument *get() const
 		{
 			return m_doc;
@@ -29,6 +178,11 @@ namespace Geany
 			return m_doc->id;
 		}
 
+		DocumentHandle handle() const
+		{
+			return DocumentHandle(m_doc->index, m_doc->id);
+		}
+
 		Glib::ustring filename() const
 		{
 			return m_doc->file_name;
@@ -52,10 +206,13 @@ namespace Geany
 				::document_set_filetype(m_doc, ft->get());
 		}
 
-		Editor *editor() const
-		{
-			return m_ed.get();
-		}
+		/**
+		 * Get the document's editor.
+		 *
+		 * The Editor wrapper is created the first time it's asked for,
+		 * documents which no plugin touches never get one.
+		 */
+		Editor *editor() const;
 
 		Glib::ustring encoding() const
 		{
@@ -92,6 +249,18 @@ namespace Geany
 			return m_doc->has_tags;
 		}
 
+		/**
+		 * Get the document's revision.
+		 *
+		 * This is a counter which is bumped every time text is
+		 * inserted into or deleted from the document, it can be used
+		 * to tell whether a snapshot of the text is still current.
+		 */
+		unsigned long revision() const
+		{
+			return m_revision;
+		}
+
 		bool close()
 		{
 			return ::document_close(m_doc);
@@ -102,6 +271,47 @@ namespace Geany
 			return ::document_save_file(m_doc, force);
 		}
 
+		/**
+		 * Save the document without blocking the UI.
+		 *
+		 * The text is copied on the main thread, then encoded and
+		 * written to a temporary file next to the original on a
+		 * background thread, flushed to disk and atomically renamed
+		 * over the original. Back on the main thread the savepoint is
+		 * set and signal_save() is emitted. signal_before_save() is
+		 * emitted before the text is copied.
+		 *
+		 * If the document is edited while the file is being written,
+		 * it's left marked as changed since the file on disk no longer
+		 * matches the buffer. Calling this while a save is already in
+		 * progress queues one more save after it.
+		 *
+		 * @note This doesn't go through Geany's own saving code, so
+		 * Geany's document-before-save/document-save signals aren't
+		 * emitted, save-time actions like stripping trailing spaces
+		 * aren't applied and Geany may later notice the file changed
+		 * on disk.
+		 *
+		 * @return `false` if the document has no filename yet or is
+		 * read-only, otherwise `true`. Failures while writing are
+		 * reported through signal_save_failed().
+		 */
+		bool save_async();
+
+		bool is_saving() const
+		{
+			return m_saving;
+		}
+
+		/**
+		 * Get the keystroke-to-paint latency of typing in this
+		 * document.
+		 */
+		TypingStats &typing_stats()
+		{
+			return m_typing;
+		}
+
 		bool save_as(const Glib::ustring &new_filename)
 		{
 			return ::document_save_file_as(m_doc, new_filename.c_str());
@@ -113,12 +323,52 @@ namespace Geany
 				encoding.empty() ? nullptr : encoding.c_str());
 		}
 
+		/**
+		 * Get this document's value for a plugin's DocumentSlot,
+		 * default-constructing it if it doesn't exist yet.
+		 */
+		template< class T >
+		T &slot(const DocumentSlot<T> &key)
+		{
+			size_t id = key.id();
+			if (id >= m_slots.size())
+				m_slots.resize(id + 1);
+			if (!m_slots[id])
+				m_slots[id].reset(new SlotValue<T>());
+			return static_cast<SlotValue<T>*>(m_slots[id].get())->value;
+		}
+
+		/**
+		 * Get this document's value for a plugin's DocumentSlot.
+		 *
+		 * @return The value or `nullptr` if it was never created.
+		 */
+		template< class T >
+		T *find_slot(const DocumentSlot<T> &key) const
+		{
+			size_t id = key.id();
+			if (id < m_slots.size() && m_slots[id])
+				return &static_cast<SlotValue<T>*>(m_slots[id].get())->value;
+			return nullptr;
+		}
+
+		/**
+		 * Destroy this document's value for a plugin's DocumentSlot.
+		 */
+		void reset_slot(const DocumentSlotBase &key)
+		{
+			if (key.id() < m_slots.size())
+				m_slots[key.id()].reset();
+		}
+
 		sigc::signal<void> &signal_activate() { return signal_activate_; }
 		sigc::signal<void> &signal_before_save() { return signal_before_save_; }
 		sigc::signal<void> &signal_save() { return signal_save_; }
+		sigc::signal<void, const Glib::ustring&> &signal_save_failed() { return signal_save_failed_; }
 		sigc::signal<void> &signal_reload() { return signal_reload_; }
 		sigc::signal<void> &signal_close() { return signal_close_; }
 		sigc::signal<void, Filetype*> &signal_filetype_set() { return signal_filetype_set_; }
+		sigc::signal<void, const LargeFileStats&> &signal_large_file_loaded() { return signal_large_file_loaded_; }
 
 		static Document *current();
 		static const std::vector<Document*> &list();
@@ -126,22 +376,89 @@ namespace Geany
 		static Document *new_file(const std::string &filename=std::string(),
 			Filetype *filetype=nullptr, const std::string &init_text=std::string());
 
+		/**
+		 * Open a file.
+		 *
+		 * If @a ro is `true`, no @a encoding is given and the file is
+		 * at least LargeFileOptions::threshold bytes, the file is opened
+		 * in large-file mode, see open_large().
+		 */
 		static Document *open(const std::string &filename, bool ro=false,
 			Filetype *filetype=nullptr, const std::string &encoding=std::string());
 
+		/**
+		 * Open a big file read-only.
+		 *
+		 * The file is memory-mapped and added to the editor in chunks
+		 * from the main loop while the progress is shown in the
+		 * statusbar's progress bar, skipping Geany's encoding detection
+		 * and conversion. Each chunk is checked to be valid UTF-8 as
+		 * it's added; if one isn't, the document is closed and the file
+		 * opened the regular way. The returned document is usable right
+		 * away and fills in as loading goes on,
+		 * signal_large_file_loaded() is emitted when it's complete.
+		 *
+		 * If the file is already open, its document is switched to
+		 * instead.
+		 *
+		 * @return The document or `nullptr` if the file couldn't be
+		 * mapped or its first chunk isn't UTF-8, callers may then fall
+		 * back to the regular open().
+		 */
+		static Document *open_large(const std::string &filename,
+			Filetype *filetype=nullptr);
+
+		static LargeFileOptions &large_file_options();
+
 	private:
+		struct SlotValueBase
+		{
+			virtual ~SlotValueBase() {}
+		};
+
+		template< class T >
+		struct SlotValue : public SlotValueBase
+		{
+			T value;
+			SlotValue() : value() {}
+		};
+
 		GeanyDocument *m_doc;
-		std::unique_ptr<Editor> m_ed;
+		mutable std::unique_ptr<Editor> m_ed;
+		std::vector<std::unique_ptr<SlotValueBase>> m_slots;
+		unsigned long m_revision;
+		bool m_saving;
+		bool m_save_again;
+		TypingStats m_typing;
 		sigc::signal<void> signal_activate_;
 		sigc::signal<void> signal_before_save_;
 		sigc::signal<void> signal_save_;
+		sigc::signal<void, const Glib::ustring&> signal_save_failed_;
 		sigc::signal<void> signal_reload_;
 		sigc::signal<void> signal_close_;
 		sigc::signal<void, Filetype*> signal_filetype_set_;
+		sigc::signal<void, const LargeFileStats&> signal_large_file_loaded_;
 
 		Document(GeanyDocument *doc);
+		void finish_save_async(bool ok, unsigned long revision,
+			const Glib::ustring &error);
 
 		friend class DocumentManager;
+		friend struct LargeFileLoader;
+		friend gboolean on_editor_notify(GObject*, GeanyEditor*,
+			SCNotification*, gpointer) noexcept G_GNUC_INTERNAL;
 	};
 
+	template< class T >
+	inline T &DocumentSlot<T>::get(Document &doc) const
+	{
+		return doc.slot(*this);
+	}
+
+	template< class T >
+	inline T *DocumentSlot<T>::find(const Document &doc) const
+	{
+		return doc.find_slot(*this);
+	}
+
 }
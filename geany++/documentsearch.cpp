@@ -0,0 +1,440 @@
+#include <geany++/documentsearch.hpp>
+#include <geany++/editor.hpp>
+#include <geany++/geany_p.hpp>
+#include <geany++/tracer_p.hpp>
+#include <geany++/ui.hpp>
+#include <geany++/worker_p.hpp>
+
+#ifdef HAVE_CONFIG_H
+#include <geany++/config.h>
+#endif
+
+#include <atomic>
+#include <cstring>
+
+// rows listed in the results page, the rest are only in matches()
+#define MAX_RESULT_ROWS 10000
+// longest line text kept per match, in bytes
+#define MAX_LINE_TEXT   200
+
+namespace Geany
+{
+
+	// shared with the workers, cut loose from its DocumentSearch when
+	// it's cancelled or the search is destroyed
+	struct DocumentSearch::Run
+	{
+		DocumentSearch *owner;
+		std::atomic<bool> cancelled;
+		std::shared_ptr<GRegex> regex;
+		bool replacing;
+		// whether the replacement may refer to groups
+		bool expand;
+		std::string replacement;
+	};
+
+	// one document's matches, filled in on a worker
+	struct DocumentSearch::Result
+	{
+		struct Found
+		{
+			int start;
+			int end;
+			int line;
+			std::string line_text;
+			std::string replacement;
+		};
+
+		DocumentHandle document;
+		unsigned long revision;
+		unsigned int doc_id;
+		Glib::ustring name;
+		std::shared_ptr<const std::string> text;
+		std::vector<Found> found;
+	};
+
+	class DocumentSearch::Page
+	{
+	public:
+		Page(DocumentSearch &search, const Glib::ustring &title)
+			: m_search(search),
+			  m_rows(0)
+		{
+			m_columns.add(m_text);
+			m_columns.add(m_index);
+			m_store = Gtk::ListStore::create(m_columns);
+			m_view.set_model(m_store);
+			m_view.set_headers_visible(false);
+			m_view.append_column("", m_text);
+			m_view.signal_row_activated().connect(
+				sigc::mem_fun(*this, &Page::on_row_activated));
+
+			m_status.set_alignment(0, 0.5);
+			m_scroll.set_policy(Gtk::POLICY_AUTOMATIC, Gtk::POLICY_AUTOMATIC);
+			m_scroll.add(m_view);
+			m_box.pack_start(m_status, Gtk::PACK_SHRINK);
+			m_box.pack_start(m_scroll, Gtk::PACK_EXPAND_WIDGET);
+			m_box.show_all();
+			ui->msgwin_notebook->append_page(m_box, title);
+		}
+
+		~Page()
+		{
+			if (ui)
+				ui->msgwin_notebook->remove_page(m_box);
+		}
+
+		void clear()
+		{
+			m_store->clear();
+			m_rows = 0;
+		}
+
+		void present()
+		{
+			ui->msgwin_notebook->set_current_page(ui->msgwin_notebook->page_num(m_box));
+		}
+
+		void add(const Glib::ustring &name, size_t first, size_t count)
+		{
+			const std::vector<SearchMatch> &matches = m_search.matches();
+			for (size_t i = first; i < first + count && m_rows < MAX_RESULT_ROWS; i++, m_rows++)
+			{
+				const SearchMatch &match = matches[i];
+				auto row = *m_store->append();
+				row[m_text] = Glib::ustring::compose("%1:%2: %3", name,
+					match.line + 1, match.line_text);
+				row[m_index] = static_cast<int>(i);
+			}
+		}
+
+		void set_status(const Glib::ustring &status)
+		{
+			m_status.set_text(status);
+		}
+
+		size_t rows() const
+		{
+			return m_rows;
+		}
+
+	private:
+		DocumentSearch &m_search;
+		Gtk::VBox m_box;
+		Gtk::Label m_status;
+		Gtk::ScrolledWindow m_scroll;
+		Gtk::TreeView m_view;
+		Gtk::TreeModelColumnRecord m_columns;
+		Gtk::TreeModelColumn<Glib::ustring> m_text;
+		Gtk::TreeModelColumn<int> m_index;
+		Glib::RefPtr<Gtk::ListStore> m_store;
+		size_t m_rows;
+
+		void on_row_activated(const Gtk::TreeModel::Path &path, Gtk::TreeViewColumn*)
+		{
+			auto iter = m_store->get_iter(path);
+			if (!iter)
+				return;
+			size_t index = (*iter)[m_index];
+			if (index >= m_search.matches().size())
+				return;
+			const SearchMatch &match = m_search.matches()[index];
+			Document *doc = match.document.get();
+			if (!doc)
+				return;
+			Document *current = Document::current();
+			::navqueue_goto_line(current ? current->get() : nullptr, doc->get(), match.line + 1);
+			if (doc->revision() == match.revision)
+				doc->editor()->set_sel(match.start, match.end);
+		}
+	};
+
+	// finds the matches of @a run's regex in @a result's text, tracking
+	// line numbers as it goes
+	void DocumentSearch::search_text(const Run &run, Result &result)
+	{
+		const std::string &text = *result.text;
+		const char *data = text.data();
+		int length = text.size();
+		int line = 0, line_start = 0, scanned = 0;
+
+		GMatchInfo *info = nullptr;
+		g_regex_match_full(run.regex.get(), data, length, 0,
+			static_cast<GRegexMatchFlags>(0), &info, nullptr);
+		while (g_match_info_matches(info) && !run.cancelled.load(std::memory_order_relaxed))
+		{
+			gint start, end;
+			g_match_info_fetch_pos(info, 0, &start, &end);
+
+			// \r\n, \n and a lone \r all end a line, like in Scintilla
+			for (; scanned < start; scanned++)
+			{
+				char c = data[scanned];
+				if (c == '\n' || (c == '\r' && (scanned + 1 >= length || data[scanned + 1] != '\n')))
+				{
+					line++;
+					line_start = scanned + 1;
+				}
+			}
+
+			Result::Found found;
+			found.start = start;
+			found.end = end;
+			found.line = line;
+			int line_end = line_start;
+			while (line_end < length && line_end - line_start < MAX_LINE_TEXT &&
+				data[line_end] != '\n' && data[line_end] != '\r')
+			{
+				line_end++;
+			}
+			// don't cut a character in half
+			if (line_end < length && line_end - line_start == MAX_LINE_TEXT)
+			{
+				while (line_end > line_start && (data[line_end] & 0xC0) == 0x80)
+					line_end--;
+			}
+			found.line_text.assign(data + line_start, line_end - line_start);
+
+			if (run.replacing)
+			{
+				if (!run.expand || !std::strchr(run.replacement.c_str(), '\\'))
+					found.replacement = run.replacement;
+				else if (gchar *expanded = g_match_info_expand_references(info,
+					run.replacement.c_str(), nullptr))
+				{
+					found.replacement = expanded;
+					g_free(expanded);
+				}
+			}
+			result.found.push_back(std::move(found));
+			g_match_info_next(info, nullptr);
+		}
+		g_match_info_free(info);
+	}
+
+	DocumentSearch::DocumentSearch(const Glib::ustring &title)
+		: m_title(title),
+		  m_pending(0),
+		  m_documents(0),
+		  m_searched(0),
+		  m_replaced(0),
+		  m_skipped(0)
+	{
+	}
+
+	DocumentSearch::~DocumentSearch()
+	{
+		cancel();
+	}
+
+	void DocumentSearch::find(const std::string &pattern, const SearchOptions &options)
+	{
+		start(pattern, nullptr, options);
+	}
+
+	void DocumentSearch::replace(const std::string &pattern,
+		const std::string &replacement, const SearchOptions &options)
+	{
+		start(pattern, &replacement, options);
+	}
+
+	void DocumentSearch::cancel()
+	{
+		if (!m_run)
+			return;
+		m_run->cancelled.store(true);
+		m_run->owner = nullptr;
+		m_run.reset();
+		if (m_pending > 0)
+		{
+			m_pending = 0;
+			update_status();
+		}
+	}
+
+	void DocumentSearch::start(const std::string &pattern,
+		const std::string *replacement, const SearchOptions &options)
+	{
+		g_return_if_fail(!pattern.empty());
+
+		std::string regex_pattern;
+		if (options.regex)
+			regex_pattern = pattern;
+		else
+		{
+			gchar *escaped = g_regex_escape_string(pattern.c_str(), -1);
+			regex_pattern = escaped;
+			g_free(escaped);
+		}
+		if (options.whole_word)
+			regex_pattern = "\\b(?:" + regex_pattern + ")\\b";
+
+		int flags = G_REGEX_MULTILINE | G_REGEX_OPTIMIZE;
+		if (!options.match_case)
+			flags |= G_REGEX_CASELESS;
+		GError *error = nullptr;
+		GRegex *regex = g_regex_new(regex_pattern.c_str(),
+			static_cast<GRegexCompileFlags>(flags), static_cast<GRegexMatchFlags>(0), &error);
+		if (!regex)
+			throw Glib::RegexError(error);
+		std::shared_ptr<GRegex> regex_ptr(regex, g_regex_unref);
+		// plain text replacements are inserted as they are
+		if (replacement && options.regex &&
+			!g_regex_check_replacement(replacement->c_str(), nullptr, &error))
+		{
+			throw Glib::RegexError(error);
+		}
+
+		cancel();
+		std::shared_ptr<Run> run(new Run);
+		run->owner = this;
+		run->cancelled.store(false);
+		run->regex = regex_ptr;
+		run->replacing = (replacement != nullptr);
+		run->expand = options.regex;
+		if (replacement)
+			run->replacement = *replacement;
+		m_run = run;
+
+		m_matches.clear();
+		m_replaced = 0;
+		m_skipped = 0;
+		if (!m_page && !m_title.empty())
+			m_page.reset(new Page(*this, m_title));
+		if (m_page)
+		{
+			m_page->clear();
+			m_page->present();
+		}
+
+		// copying the text of every document up front is a memcpy each,
+		// searching it is what's worth moving off the main thread
+		std::vector<std::shared_ptr<Result>> results;
+		for (auto doc : Document::list())
+		{
+			if (!doc->is_valid())
+				continue;
+			if (run->replacing && doc->is_readonly())
+			{
+				m_skipped++;
+				continue;
+			}
+			std::shared_ptr<Result> result(new Result);
+			result->document = doc->handle();
+			result->revision = doc->revision();
+			result->doc_id = doc->id();
+			result->name = doc->display_name();
+			Scintilla *sci = doc->editor();
+			int length = sci->get_length();
+			std::shared_ptr<std::string> text(new std::string(length + 1, '\0'));
+			sci->send(SCI_GETTEXT, length + 1, reinterpret_cast<intptr_t>(&(*text)[0]));
+			text->resize(length);
+			result->text = text;
+			results.push_back(result);
+		}
+
+		m_documents = results.size();
+		m_searched = 0;
+		m_pending = results.size();
+		update_status();
+		if (results.empty())
+		{
+			m_run.reset();
+			signal_finished_.emit();
+			return;
+		}
+
+		for (auto &result : results)
+		{
+			Worker::submit([run, result]() {
+				if (run->cancelled.load())
+					return;
+				{
+					Tracer::Span span("DocumentSearch::search", "search", result->doc_id);
+					search_text(*run, *result);
+				}
+				// the text isn't needed any more and may be large
+				result->text.reset();
+				Worker::invoke_in_main([run, result]() {
+					if (run->owner)
+						run->owner->deliver(*result);
+				});
+			});
+		}
+	}
+
+	void DocumentSearch::deliver(Result &result)
+	{
+		size_t first = m_matches.size();
+		Document *doc = result.document.get();
+		if (!result.found.empty() && m_run->replacing)
+		{
+			if (!doc || doc->revision() != result.revision || doc->is_readonly())
+				m_skipped++;
+			else
+			{
+				Tracer::Span span("DocumentSearch::replace", "search", result.doc_id);
+				Scintilla &sci = *doc->editor();
+				sci.begin_undo_action();
+				for (auto it = result.found.rbegin(); it != result.found.rend(); ++it)
+				{
+					sci.set_target_range(it->start, it->end);
+					sci.replace_target(it->replacement.size(), it->replacement);
+				}
+				sci.end_undo_action();
+				m_replaced += result.found.size();
+			}
+		}
+
+		m_matches.reserve(m_matches.size() + result.found.size());
+		for (auto &found : result.found)
+		{
+			SearchMatch match;
+			match.document = result.document;
+			match.revision = result.revision;
+			match.line = found.line;
+			match.start = found.start;
+			match.end = found.end;
+			match.line_text = std::move(found.line_text);
+			m_matches.push_back(std::move(match));
+		}
+
+		m_searched++;
+		m_pending--;
+		if (m_pending == 0)
+			m_run.reset();
+		if (m_page)
+		{
+			m_page->add(result.name, first, m_matches.size() - first);
+			update_status();
+		}
+		if (m_matches.size() > first)
+			signal_found_.emit(first, m_matches.size() - first);
+		if (m_pending == 0)
+			signal_finished_.emit();
+	}
+
+	void DocumentSearch::update_status()
+	{
+		if (!m_page)
+			return;
+		Glib::ustring status;
+		if (m_replaced > 0 || m_skipped > 0)
+		{
+			status = Glib::ustring::compose("%1 replacements, %2 documents skipped",
+				m_replaced, m_skipped);
+		}
+		else
+		{
+			status = Glib::ustring::compose("%1 matches", m_matches.size());
+		}
+		if (m_pending > 0)
+			status += Glib::ustring::compose(", searched %1 of %2 documents", m_searched, m_documents);
+		else if (m_searched < m_documents)
+			status += ", cancelled";
+		if (m_page->rows() < m_matches.size())
+			status += Glib::ustring::compose(", the first %1 are listed", m_page->rows());
+		m_page->set_status(status);
+	}
+
+}
@@ -0,0 +1,163 @@
+#pragma once
+
+#include <geany++/common.hpp>
+#include <geany++/document.hpp>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace Geany
+{
+
+	/**
+	 * How DocumentSearch matches its pattern.
+	 */
+	struct SearchOptions
+	{
+		bool match_case;  //!< Tell upper and lower case apart.
+		bool whole_word;  //!< Only match whole words.
+		bool regex;       //!< The pattern is a Perl-compatible regular expression, replacements may refer to its groups like `\1`.
+
+		SearchOptions()
+			: match_case(false), whole_word(false), regex(false)
+		{
+		}
+	};
+
+	/**
+	 * One match found by DocumentSearch.
+	 */
+	struct SearchMatch
+	{
+		DocumentHandle document;
+		unsigned long revision;  //!< The document's revision the positions refer to.
+		int line;                //!< The 0-based line the match starts on.
+		int start;               //!< The match's start position.
+		int end;                 //!< The match's end position.
+		std::string line_text;   //!< The text of the line, shortened if it's long.
+	};
+
+	/**
+	 * Finds, and replaces, text in all open documents at once.
+	 *
+	 * The text of every document is copied on the main thread and the
+	 * copies are searched on background threads. Each document's matches
+	 * are added to matches() and listed in a page of the message window
+	 * as soon as that document is done. Activating a row goes to the
+	 * match.
+	 *
+	 * Replacing searches the same way and applies each document's
+	 * replacements when its search is done. They go in back to front,
+	 * so no position has to be adjusted, within a single undo action.
+	 * A document which was edited while it was being searched is
+	 * skipped rather than replaced at stale positions.
+	 *
+	 * Starting a new search cancels the running one.
+	 */
+	class DocumentSearch : public sigc::trackable
+	{
+	public:
+
+		/**
+		 * @param title The label of the results page in the message
+		 * window, empty for no page.
+		 */
+		DocumentSearch(const Glib::ustring &title = "Search Results");
+		~DocumentSearch();
+
+		/**
+		 * Search all open documents for @a pattern.
+		 *
+		 * @throw Glib::RegexError If @a pattern isn't a valid regular
+		 * expression.
+		 */
+		void find(const std::string &pattern, const SearchOptions &options = SearchOptions());
+
+		/**
+		 * Replace @a pattern with @a replacement in all open documents
+		 * which aren't read-only.
+		 *
+		 * @throw Glib::RegexError If @a pattern isn't a valid regular
+		 * expression or @a replacement refers to groups badly.
+		 */
+		void replace(const std::string &pattern, const std::string &replacement,
+			const SearchOptions &options = SearchOptions());
+
+		/**
+		 * Stop the running search, documents already done keep their
+		 * matches and replacements.
+		 */
+		void cancel();
+
+		bool is_running() const
+		{
+			return m_pending > 0;
+		}
+
+		/**
+		 * Get the matches found so far, grouped by document in the
+		 * order the documents finished.
+		 */
+		const std::vector<SearchMatch> &matches() const
+		{
+			return m_matches;
+		}
+
+		/**
+		 * Get the number of replacements made by the last replace().
+		 */
+		size_t replaced() const
+		{
+			return m_replaced;
+		}
+
+		/**
+		 * Get the number of documents replace() skipped because they
+		 * were edited, closed or are read-only.
+		 */
+		size_t skipped() const
+		{
+			return m_skipped;
+		}
+
+		/**
+		 * Signal emitted when a document's matches were added, with the
+		 * index of the first new one in matches() and how many there
+		 * are.
+		 */
+		sigc::signal<void, size_t, size_t> &signal_found() { return signal_found_; }
+
+		/**
+		 * Signal emitted when all documents were searched, but not when
+		 * the search was cancelled.
+		 */
+		sigc::signal<void> &signal_finished() { return signal_finished_; }
+
+	private:
+		struct Run;
+		struct Result;
+		class Page;
+
+		std::shared_ptr<Run> m_run;
+		std::unique_ptr<Page> m_page;
+		Glib::ustring m_title;
+		std::vector<SearchMatch> m_matches;
+		size_t m_pending;
+		size_t m_documents;
+		size_t m_searched;
+		size_t m_replaced;
+		size_t m_skipped;
+		sigc::signal<void, size_t, size_t> signal_found_;
+		sigc::signal<void> signal_finished_;
+
+		DocumentSearch(const DocumentSearch&);
+		DocumentSearch &operator=(const DocumentSearch&);
+
+		void start(const std::string &pattern, const std::string *replacement,
+			const SearchOptions &options);
+		void deliver(Result &result);
+		static void search_text(const Run &run, Result &result);
+		void update_status();
+	};
+
+}
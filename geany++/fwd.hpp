@@ -0,0 +1,70 @@
+#pragma once
+
+/**
+ * @file fwd.hpp
+ *
+ * Forward declarations of the library's classes.
+ *
+ * Headers and sources that only pass pointers or references around can
+ * include this instead of the full headers, in particular instead of
+ * the large generated Scintilla wrapper.
+ */
+
+namespace Geany
+{
+
+	class CompletionProvider;
+	class ConfigSchema;
+	class ConfigValueBase;
+	template< class T > class ConfigValue;
+	class ContainerLexer;
+	class Document;
+	class DocumentHandle;
+	class DocumentSearch;
+	class DocumentSlotBase;
+	template< class T > class DocumentSlot;
+	class Editor;
+	class Filetype;
+	class HoverProvider;
+	class IndentPrefs;
+	class IPlugin;
+	class LatencyHistogram;
+	class PluginConfig;
+	struct PluginData;
+	class PathTable;
+	class Project;
+	class ProjectIndex;
+	class Scintilla;
+	class StyleWriter;
+	class UI;
+
+	struct CompletionContext;
+	struct CompletionItem;
+	struct HoverContext;
+	struct LargeFileOptions;
+	struct LargeFileStats;
+	struct SearchMatch;
+	struct SearchOptions;
+	class TypingStats;
+	struct TypingLatency;
+
+	namespace Build
+	{
+		class Command;
+		class Group;
+		class History;
+		class Job;
+		class Runner;
+		class DiagnosticParser;
+		class DiagnosticStore;
+		struct Diagnostic;
+	}
+
+	namespace TagManager
+	{
+		class SourceFile;
+		class Tag;
+		class Workspace;
+	}
+
+}
@@ -1,4 +1,6 @@
+#include <geany++/completion_p.hpp>
 #include <geany++/geany_p.hpp>
+#include <geany++/hover_p.hpp>
 #include <geany++/utils.hpp>
 
 #ifdef HAVE_CONFIG_H
@@ -166,7 +168,9 @@ namespace Geany
 		: proxy(proxy),
 		  gplugin(gplugin),
 		  spec(spec_filename),
-		  config(spec_filename)
+		  config(spec_filename),
+		  trace_name(g_intern_string(spec.name.c_str())),
+		  replay_pos(0)
 	{
 	}
 
@@ -183,8 +187,23 @@ namespace Geany
 
 	void PluginData::cleanup()
 	{
+		replay_conn.disconnect();
+		replay_queue.clear();
+		// complete() and hover() may be running on a worker
+		Completion::remove_providers(this);
+		Hover::remove_providers(this);
 		plugin.reset(nullptr);
+		proxy.documents.free_slots(this);
 		module.reset(nullptr);
+		try
+		{
+			config.flush();
+		}
+		catch (Glib::FileError &err)
+		{
+			g_warning("unable to save config file '%s': %s",
+				config.filename().c_str(), err.what().c_str());
+		}
 	}
 
 	PluginData *PluginData::from_data(gpointer pdata)
@@ -1,13 +1,23 @@
 #pragma once
 
 #include <geany++/build.hpp>
+#include <geany++/buildhistory.hpp>
+#include <geany++/buildrunner.hpp>
 #include <geany++/common.hpp>
+#include <geany++/completion.hpp>
+#include <geany++/configschema.hpp>
+#include <geany++/containerlexer.hpp>
+#include <geany++/diagnostics.hpp>
 #include <geany++/document.hpp>
+#include <geany++/documentsearch.hpp>
 #include <geany++/editor.hpp>
 #include <geany++/filetype.hpp>
+#include <geany++/hover.hpp>
 #include <geany++/iplugin.hpp>
+#include <geany++/latency.hpp>
 #include <geany++/pluginconfig.hpp>
 #include <geany++/project.hpp>
+#include <geany++/projectindex.hpp>
 #include <geany++/tagmanager.hpp>
 #include <geany++/templateprefs.hpp>
 #include <geany++/ui.hpp>
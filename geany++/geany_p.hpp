@@ -2,9 +2,11 @@
 
 #include <geany++/geany.hpp>
 #include <geany++/scintilla.hpp>
+#include <geany++/session_p.hpp>
 #include <algorithm>
 #include <unordered_map>
 #include <vector>
+#include <sys/stat.h>
 
 
 #define GROUP_NAME       "cpp-plugin"
@@ -61,6 +63,12 @@ namespace Geany
 		std::unique_ptr<PluginModule> module;
 		std::unique_ptr<IPlugin> plugin;
 		PluginConfig config;
+		// the name interned for Tracer spans, it outlives the plugin
+		// since the trace may only be written after it's unloaded
+		const char *trace_name;
+		std::vector<DocumentHandle> replay_queue;
+		size_t replay_pos;
+		sigc::connection replay_conn;
 
 		PluginData(ProxyPlugin &proxy, GeanyPlugin *gplugin,
 			const std::string &spec_filename);
@@ -71,65 +79,186 @@ namespace Geany
 	};
 
 
+	// Documents live in a slot map indexed by GeanyDocument::index, which
+	// Geany re-uses as tabs are closed and opened, with GeanyDocument::id
+	// acting as the generation since it's never re-used. This makes
+	// add/lookup/remove O(1) without hashing and lets DocumentHandles
+	// detect when the document they refer to is gone. A separate dense
+	// list is kept for iteration in the order documents were added.
+	// Removal only leaves a hole in it, the holes are squeezed out the
+	// next time the list is read, so closing all tabs stays linear.
 	class DocumentManager
 	{
 		typedef std::vector<Document*> DocList;
 	public:
+		DocumentManager()
+			: holes(0)
+		{
+		}
+
 		const DocList &list() const
 		{
+			if (holes > 0)
+				compact();
 			return doclist;
 		}
 
 		Document *lookup(GeanyDocument *doc) const
 		{
-			auto found = docmap.find(doc);
-			if (found != docmap.end())
-				return found->second.get();
-			return nullptr;
+			if (doc == nullptr || doc->index < 0)
+				return nullptr;
+			return lookup(static_cast<size_t>(doc->index), doc->id);
+		}
+
+		Document *lookup(const DocumentHandle &handle) const
+		{
+			if (!handle.m_set)
+				return nullptr;
+			return lookup(handle.m_index, handle.m_id);
 		}
 
 		Document *add(GeanyDocument *doc)
 		{
-			auto docptr = lookup(doc);
-			if (docptr)
+			g_return_val_if_fail(doc && doc->index >= 0, nullptr);
+
+			auto index = static_cast<size_t>(doc->index);
+			if (auto docptr = lookup(index, doc->id))
 				return docptr;
 
-			docptr = new Document(doc);
-			try
+			if (index >= slots.size())
+				slots.resize(index + 1);
+			else if (slots[index].doc)
+				release(index); // slot re-used without a close event
+
+			if (holes * 2 > doclist.size())
+				compact();
+			// reserve first so nothing below can throw after the
+			// document is owned by the slot
+			doclist.reserve(doclist.size() + 1);
+			dense_slots.reserve(doclist.size() + 1);
+
+			Slot &slot = slots[index];
+			slot.doc.reset(new Document(doc));
+			slot.id = doc->id;
+			slot.dense = doclist.size();
+			doclist.push_back(slot.doc.get());
+			dense_slots.push_back(index);
+			return slot.doc.get();
+		}
+
+		// wraps every document Geany already has open in one pass, for
+		// when the proxy is loaded into a running session
+		void adopt_all()
+		{
+			GPtrArray *docs = Geany::data->documents_array;
+			slots.reserve(docs->len);
+			doclist.reserve(docs->len);
+			dense_slots.reserve(docs->len);
+			for (guint i = 0; i < docs->len; i++)
 			{
-				docmap.emplace(doc, DocPtr(docptr));
-				doclist.emplace_back(docptr);
-				return docptr;
+				auto doc = static_cast<GeanyDocument*>(docs->pdata[i]);
+				if (DOC_VALID(doc))
+					add(doc);
 			}
-			catch (...)
+		}
+
+		bool remove(GeanyDocument *doc)
+		{
+			if (lookup(doc) == nullptr)
+				return false;
+			release(static_cast<size_t>(doc->index));
+			return true;
+		}
+
+		Document *current() const
+		{
+			return lookup(::document_get_current());
+		}
+
+		// DocumentSlot IDs index into each Document's slot array, so
+		// freed IDs are re-used to keep those arrays short
+		size_t alloc_slot(PluginData *owner)
+		{
+			auto found = std::find(slot_owners.begin(), slot_owners.end(), nullptr);
+			if (found != slot_owners.end())
 			{
-				delete docptr;
-				throw;
+				*found = owner;
+				return found - slot_owners.begin();
 			}
+			slot_owners.push_back(owner);
+			return slot_owners.size() - 1;
 		}
 
-		bool remove(GeanyDocument *doc)
+		void free_slot(size_t id, PluginData *owner)
 		{
-			if (auto docptr = lookup(doc))
+			if (id >= slot_owners.size() || slot_owners[id] != owner)
+				return;
+			for (auto doc : list())
 			{
-				size_t old_size = doclist.size();
-				doclist.erase(std::remove(doclist.begin(),
-					doclist.end(), docptr), doclist.end());
-				return (docmap.erase(doc) > 0 && old_size < doclist.size());
+				if (id < doc->m_slots.size())
+					doc->m_slots[id].reset();
 			}
-			return false;
+			slot_owners[id] = nullptr;
 		}
 
-		Document *current() const
+		void free_slots(PluginData *owner)
 		{
-			return lookup(::document_get_current());
+			for (size_t id = 0; id < slot_owners.size(); id++)
+				free_slot(id, owner);
 		}
 
 	private:
-		typedef std::unique_ptr<Document> DocPtr;
-		typedef std::unordered_map<GeanyDocument*, DocPtr> DocMap;
-		DocMap docmap;
-		DocList doclist;
+		struct Slot
+		{
+			std::unique_ptr<Document> doc;
+			unsigned int id;
+			// moved by compact()
+			mutable size_t dense;
+			Slot() : id(0), dense(0) {}
+		};
+
+		std::vector<Slot> slots;
+		// null where a document was removed
+		mutable DocList doclist;
+		mutable std::vector<size_t> dense_slots;
+		mutable size_t holes;
+		std::vector<PluginData*> slot_owners;
+
+		Document *lookup(size_t index, unsigned int id) const
+		{
+			if (index < slots.size())
+			{
+				const Slot &slot = slots[index];
+				if (slot.doc && slot.id == id)
+					return slot.doc.get();
+			}
+			return nullptr;
+		}
+
+		void release(size_t index)
+		{
+			Slot &slot = slots[index];
+			doclist[slot.dense] = nullptr;
+			holes++;
+			slot.doc.reset();
+		}
+
+		void compact() const
+		{
+			size_t n = 0;
+			for (size_t i = 0; i < doclist.size(); i++)
+			{
+				if (doclist[i] == nullptr)
+					continue;
+				doclist[n] = doclist[i];
+				dense_slots[n] = dense_slots[i];
+				slots[dense_slots[n]].dense = n;
+				n++;
+			}
+			doclist.resize(n);
+			dense_slots.resize(n);
+			holes = 0;
+		}
 	};
 
 
@@ -241,9 +370,17 @@ namespace Geany
 		FiletypeManager filetypes;
 		PluginManager plugins;
 		std::unique_ptr<Project> project;
+		std::unique_ptr<Session::Recorder> recorder;
+		// what new files are created with, from the umask
+		mode_t new_file_mode;
 
+		// umask() can only be read by setting it, which is process-wide,
+		// so it's done once here, before the library starts any threads
 		ProxyPlugin() : project(nullptr)
 		{
+			mode_t mask = umask(0);
+			umask(mask);
+			new_file_mode = 0666 & ~mask;
 		}
 
 		Project *new_project(GeanyProject *gproj)
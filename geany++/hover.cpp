@@ -0,0 +1,277 @@
+#include <geany++/hover_p.hpp>
+#include <geany++/editor.hpp>
+#include <geany++/geany_p.hpp>
+#include <geany++/providers_p.hpp>
+
+#ifdef HAVE_CONFIG_H
+#include <geany++/config.h>
+#endif
+
+#include <list>
+#include <unordered_map>
+#include <utility>
+
+// lookups remembered, a few screens of symbols
+#define HOVER_CACHE_ENTRIES 256
+// dwell time set on editors which don't have dwell notifications on
+#define HOVER_DWELL_MSEC    500
+
+namespace Geany
+{
+
+	HoverProvider::HoverProvider(IPlugin &plugin)
+		: m_owner(&plugin.priv)
+	{
+		Hover::add_provider(this, m_owner);
+	}
+
+	HoverProvider::~HoverProvider()
+	{
+		remove();
+	}
+
+	void HoverProvider::remove()
+	{
+		Hover::remove_provider(this);
+	}
+
+	namespace Hover
+	{
+
+		namespace
+		{
+			struct Key
+			{
+				unsigned int doc_id;
+				unsigned long revision;
+				int start;
+				int end;
+
+				bool operator==(const Key &other) const
+				{
+					return (doc_id == other.doc_id && revision == other.revision &&
+						start == other.start && end == other.end);
+				}
+			};
+
+			struct KeyHash
+			{
+				size_t operator()(const Key &key) const
+				{
+					size_t hash = std::hash<unsigned long>()(key.revision);
+					hash = hash * 31 + key.doc_id;
+					hash = hash * 31 + key.start;
+					return hash * 31 + key.end;
+				}
+			};
+
+			struct Request : Providers::Request<HoverContext, std::string>
+			{
+				Key key;
+				// all providers' tips, joined
+				std::string tip;
+			};
+
+			typedef Providers::Service<HoverProvider, Request> Service;
+
+			typedef std::list<std::pair<Key, std::string>> LruList;
+
+			void call(HoverProvider &provider, const HoverContext &ctx, std::string &tip);
+			void gather(Request &request);
+			void finish(const std::shared_ptr<Request> &request);
+
+			Service service("HoverProvider::hover", call, gather, finish);
+			// whether the mouse is still resting where the current
+			// request was made, results are only shown then
+			bool dwelling = false;
+			// whether the calltip showing is ours
+			bool tip_shown = false;
+			// most recently used first
+			LruList lru;
+			std::unordered_map<Key, LruList::iterator, KeyHash> lru_index;
+
+			const std::string *cache_find(const Key &key)
+			{
+				auto found = lru_index.find(key);
+				if (found == lru_index.end())
+					return nullptr;
+				lru.splice(lru.begin(), lru, found->second);
+				return &found->second->second;
+			}
+
+			void cache_add(const Key &key, std::string &&tip)
+			{
+				auto found = lru_index.find(key);
+				if (found != lru_index.end())
+				{
+					found->second->second = std::move(tip);
+					lru.splice(lru.begin(), lru, found->second);
+					return;
+				}
+				lru.emplace_front(key, std::move(tip));
+				lru_index.emplace(key, lru.begin());
+				if (lru.size() > HOVER_CACHE_ENTRIES)
+				{
+					lru_index.erase(lru.back().first);
+					lru.pop_back();
+				}
+			}
+
+			void show(Scintilla &sci, int position, const std::string &tip)
+			{
+				if (tip.empty())
+					return;
+				sci.call_tip_show(position, tip);
+				tip_shown = true;
+			}
+
+			void call(HoverProvider &provider, const HoverContext &ctx, std::string &tip)
+			{
+				if (!provider.hover(ctx, tip))
+					tip.clear();
+			}
+
+			void gather(Request &request)
+			{
+				for (auto &part : request.results)
+				{
+					if (part.empty())
+						continue;
+					if (!request.tip.empty())
+						request.tip += "\n\n";
+					request.tip += part;
+				}
+				request.results.clear();
+			}
+
+			void finish(const std::shared_ptr<Request> &request)
+			{
+				const HoverContext &ctx = request->context;
+				if (ctx.is_cancelled())
+					return;
+
+				// remembered even when there's nothing to show, so the
+				// providers aren't asked again
+				cache_add(request->key, std::string(request->tip));
+
+				if (request != service.current())
+					return;
+				service.clear_current();
+				if (!dwelling)
+					return;
+				Document *doc = ctx.document.get();
+				if (!doc || doc != Document::current() || doc->revision() != ctx.revision)
+					return;
+				show(*doc->editor(), ctx.start, request->tip);
+			}
+
+			void query(Document &doc, Scintilla &sci, const std::vector<Service::EntryPtr> &asked,
+				const Key &key, int position)
+			{
+				std::shared_ptr<Request> request(new Request);
+				request->key = key;
+				request->doc_id = key.doc_id;
+				HoverContext &ctx = request->context;
+				Providers::init_context(ctx, doc, sci, position);
+				ctx.start = key.start;
+				ctx.end = key.end;
+				ctx.symbol = ctx.text->substr(key.start, key.end - key.start);
+				service.submit(request, asked);
+			}
+
+			void dwell_start(Document &doc, Scintilla &sci, int position)
+			{
+				if (position < 0)
+					return;
+				int start = sci.word_start_position(position, true);
+				int end = sci.word_end_position(position, true);
+				if (start >= end)
+					return;
+
+				Key key = { doc.id(), doc.revision(), start, end };
+				if (const std::string *tip = cache_find(key))
+				{
+					show(sci, start, *tip);
+					return;
+				}
+
+				dwelling = true;
+				// still being looked up from the last time
+				if (service.current() && service.current()->key == key)
+					return;
+				service.cancel();
+
+				auto asked = service.handling(doc);
+				if (!asked.empty())
+					query(doc, sci, asked, key, position);
+			}
+
+			void dwell_end(Scintilla &sci)
+			{
+				// a lookup still running finishes into the cache, it's
+				// just not shown
+				dwelling = false;
+				if (tip_shown && sci.call_tip_active())
+					sci.call_tip_cancel();
+				tip_shown = false;
+			}
+
+			void enable_dwell(Document &doc)
+			{
+				Scintilla *sci = doc.editor();
+				if (sci && sci->get_mouse_dwell_time() == Scintilla::TIME_FOREVER)
+					sci->set_mouse_dwell_time(HOVER_DWELL_MSEC);
+			}
+		}
+
+		bool active()
+		{
+			return service.active();
+		}
+
+		void add_provider(HoverProvider *provider, PluginData *owner)
+		{
+			if (service.add(provider, owner))
+			{
+				for (auto doc : Document::list())
+					enable_dwell(*doc);
+			}
+		}
+
+		void remove_provider(HoverProvider *provider)
+		{
+			service.remove(provider);
+		}
+
+		void remove_providers(PluginData *owner)
+		{
+			// what's cached may have come from the plugin
+			if (service.remove_owner(owner))
+			{
+				lru.clear();
+				lru_index.clear();
+			}
+		}
+
+		void document_open(Document &doc)
+		{
+			if (active())
+				enable_dwell(doc);
+		}
+
+		void notify(Document &doc, Scintilla &sci, const SCNotification &nt)
+		{
+			switch (nt.nmhdr.code)
+			{
+				case SCN_DWELLSTART:
+					dwell_start(doc, sci, nt.position);
+					break;
+				case SCN_DWELLEND:
+					dwell_end(sci);
+					break;
+			}
+		}
+
+	}
+
+}
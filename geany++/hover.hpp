@@ -0,0 +1,104 @@
+#pragma once
+
+#include <geany++/common.hpp>
+#include <geany++/document.hpp>
+#include <atomic>
+#include <memory>
+#include <string>
+
+namespace Geany
+{
+
+	/**
+	 * The symbol the mouse is resting on.
+	 *
+	 * Everything is copied on the main thread when the lookup is made,
+	 * so providers can use it from a background thread.
+	 */
+	struct HoverContext
+	{
+		DocumentHandle document;   //!< Only resolve it on the main thread.
+		unsigned long revision;    //!< The document's revision when the text was copied.
+		std::string filetype;      //!< The document's filetype name.
+		std::shared_ptr<const std::string> text;  //!< The whole document.
+		int position;              //!< Where the mouse is.
+		int start;                 //!< Where the symbol starts.
+		int end;                   //!< Where the symbol ends.
+		std::string symbol;        //!< The word under the mouse.
+
+		/**
+		 * Whether the mouse moved on to another symbol, providers
+		 * doing a lot of work should check it now and then and return
+		 * early.
+		 */
+		bool is_cancelled() const
+		{
+			return cancelled && cancelled->load(std::memory_order_relaxed);
+		}
+
+		//! Set by the framework, see is_cancelled().
+		std::shared_ptr<std::atomic<bool>> cancelled;
+	};
+
+	/**
+	 * Base class for plugins' sources of calltips for the symbol under
+	 * the mouse.
+	 *
+	 * On SCN_DWELLSTART the framework finds the word under the mouse and
+	 * asks each provider for it on a background thread. The answers are
+	 * joined into one calltip, shown unless the mouse moved away
+	 * meanwhile, and remembered by document, revision and symbol range,
+	 * so resting on the same symbol again shows it right away. Dwell
+	 * notifications are turned on for editors that don't have them yet.
+	 *
+	 * Providers are registered when they're created. They're removed
+	 * when destroyed, or when their plugin is unloaded, before the
+	 * plugin is destroyed. A provider destroyed while its plugin stays
+	 * loaded must call remove() first, since hover() may be running on
+	 * another thread.
+	 *
+	 * @see CompletionProvider
+	 */
+	class HoverProvider
+	{
+	public:
+
+		virtual ~HoverProvider();
+
+		/**
+		 * Stop asking this provider, waiting for a call to hover()
+		 * running on another thread to return.
+		 */
+		void remove();
+
+		/**
+		 * Whether the provider has calltips for @a doc at all, e.g. by
+		 * its filetype. Called on the main thread.
+		 */
+		virtual bool handles(G_GNUC_UNUSED Document &doc)
+		{
+			return true;
+		}
+
+		/**
+		 * Look up the symbol in @a ctx.
+		 *
+		 * Called on a background thread, so it must not touch GTK,
+		 * Scintilla, Geany or the document, only the context.
+		 *
+		 * @param ctx The symbol and the document's text.
+		 * @param tip Receives the calltip text.
+		 * @return Whether there's anything to show.
+		 */
+		virtual bool hover(const HoverContext &ctx, std::string &tip) = 0;
+
+	protected:
+		HoverProvider(IPlugin &plugin);
+
+	private:
+		PluginData *m_owner;
+		HoverProvider(const HoverProvider&);
+		HoverProvider &operator=(const HoverProvider&);
+	};
+
+}
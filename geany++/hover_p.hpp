@@ -0,0 +1,34 @@
+#pragma once
+
+#include <geany++/hover.hpp>
+#include <geany++/scintilla.hpp>
+
+namespace Geany
+{
+
+	// The engine behind HoverProvider. The proxy feeds it dwell
+	// notifications, providers run on Worker threads and their answers
+	// are cached in a small LRU, keyed by document revision so edits
+	// age stale entries out without tracking them.
+	namespace Hover
+	{
+
+		// whether any provider is registered
+		bool active();
+
+		void add_provider(HoverProvider *provider, PluginData *owner);
+		void remove_provider(HoverProvider *provider);
+
+		// removes all of @a owner's providers, before the plugin is
+		// destroyed
+		void remove_providers(PluginData *owner);
+
+		// turns on dwell notifications for a newly opened document
+		void document_open(Document &doc);
+
+		// handles SCN_DWELLSTART and SCN_DWELLEND
+		void notify(Document &doc, Scintilla &sci, const SCNotification &nt);
+
+	}
+
+}
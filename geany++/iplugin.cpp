@@ -1,9 +1,22 @@
 #include <geany++/iplugin.hpp>
 #include <geany++/geany_p.hpp>
+#include <geany++/tracer_p.hpp>
 
 namespace Geany
 {
 
+	detail::PluginScope::PluginScope(const IPlugin &plugin, const char *name)
+		: m_span(nullptr)
+	{
+		if (Tracer::spans_active())
+			m_span = new Tracer::Span(name, "plugin", 0, plugin.priv.trace_name);
+	}
+
+	detail::PluginScope::~PluginScope()
+	{
+		delete m_span;
+	}
+
 	IPlugin::IPlugin(PluginData &init_data)
 		: priv(init_data)
 	{
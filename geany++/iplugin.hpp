@@ -8,11 +8,59 @@
 #include <memory>
 #include <string>
 #include <type_traits>
+#include <utility>
 
 namespace Geany
 {
 	struct ProxyPlugin;
 	struct PluginData;
+	class IPlugin;
+
+	namespace Tracer
+	{
+		class Span;
+	}
+
+	namespace detail
+	{
+		// attributes what runs while it exists to a plugin, for the
+		// tracer and the Scintilla profiler, see IPlugin::connect()
+		class PluginScope
+		{
+		public:
+			PluginScope(const IPlugin &plugin, const char *name);
+			~PluginScope();
+
+		private:
+			// only while tracing or profiling
+			Tracer::Span *m_span;
+
+			PluginScope(const PluginScope&);
+			PluginScope &operator=(const PluginScope&);
+		};
+
+		template< class R, class Slot >
+		struct PluginSlot : public sigc::functor_base
+		{
+			typedef R result_type;
+
+			const IPlugin *plugin;
+			mutable Slot slot;
+			const char *name;
+
+			PluginSlot(const IPlugin &plugin, const Slot &slot, const char *name)
+				: plugin(&plugin), slot(slot), name(name)
+			{
+			}
+
+			template< class... Args >
+			R operator()(Args&&... args) const
+			{
+				PluginScope scope(*plugin, name);
+				return slot(std::forward<Args>(args)...);
+			}
+		};
+	}
 
 
 	/**
@@ -94,6 +142,34 @@ namespace Geany
 		 */
 		PluginConfig &config();
 
+		/**
+		 * Connect @a slot to @a signal on behalf of this plugin.
+		 *
+		 * The time spent in the slot and the Scintilla messages it
+		 * sends are then attributed to this plugin by the tracer and
+		 * the Scintilla profiler, rather than to whatever emitted the
+		 * signal. Use it for handlers of frequent signals, like
+		 * Scintilla::signal_modified() or Scintilla::signal_update_ui().
+		 *
+		 * @code
+		 *   connect(sci.signal_modified(),
+		 *     sigc::mem_fun(*this, &MyPlugin::on_modified), "on_modified");
+		 * @endcode
+		 *
+		 * @param signal The signal to connect to.
+		 * @param slot The slot, anything the signal could connect to.
+		 * @param name What the slot is called in traces and reports.
+		 *
+		 * @return The connection, as from the signal's connect().
+		 */
+		template< class Signal, class Slot >
+		sigc::connection connect(Signal &&signal, const Slot &slot,
+			const char *name = "signal handler")
+		{
+			typedef typename std::decay<Signal>::type::result_type R;
+			return signal.connect(detail::PluginSlot<R, Slot>(*this, slot, name));
+		}
+
 		/**
 		 * Signal emitted when a new or existing document is emitted.
 		 *
@@ -217,8 +293,13 @@ namespace Geany
 		sigc::signal<void, Project&, Glib::KeyFile> signal_project_open_;
 		sigc::signal<void> signal_project_close_;
 
+		friend class CompletionProvider;
+		friend class DocumentSlotBase;
+		friend class HoverProvider;
+		friend class detail::PluginScope;
 		friend GtkWidget *subplugin_configure(GeanyPlugin*, GtkDialog*, gpointer) noexcept G_GNUC_INTERNAL;
 		friend void emit_document_open(ProxyPlugin *proxy, Document *doc) noexcept G_GNUC_INTERNAL;
+		friend bool replay_documents(PluginData &data) noexcept G_GNUC_INTERNAL;
 		friend void on_project_open(GObject*, GKeyFile *kf, gpointer pdata) noexcept G_GNUC_INTERNAL;
 		friend void on_project_close(GObject*, gpointer pdata) noexcept G_GNUC_INTERNAL;
 	};
@@ -0,0 +1,352 @@
+#include <geany++/document.hpp>
+#include <geany++/geany_p.hpp>
+#include <geany++/tracer_p.hpp>
+
+#ifdef HAVE_CONFIG_H
+#include <geany++/config.h>
+#endif
+
+#include <cstdint>
+#include <cstring>
+#include <memory>
+
+namespace Geany
+{
+
+	LargeFileOptions &Document::large_file_options()
+	{
+		static LargeFileOptions options;
+		return options;
+	}
+
+	// Checks that the data is valid UTF-8, rejecting overlong forms and
+	// surrogates like g_utf8_validate() does. Runs of ASCII, which is
+	// most of any log or source file, are skipped a machine word at a
+	// time instead of a byte at a time.
+	static bool validate_utf8(const char *data, size_t len)
+	{
+		static const uint64_t HIGH_BITS = 0x8080808080808080ULL;
+		auto p = reinterpret_cast<const unsigned char*>(data);
+		auto end = p + len;
+
+		while (p < end)
+		{
+			while (end - p >= 32)
+			{
+				uint64_t w[4];
+				std::memcpy(w, p, sizeof(w));
+				if ((w[0] | w[1] | w[2] | w[3]) & HIGH_BITS)
+					break;
+				p += 32;
+			}
+			while (end - p >= 8)
+			{
+				uint64_t w;
+				std::memcpy(&w, p, sizeof(w));
+				if (w & HIGH_BITS)
+					break;
+				p += 8;
+			}
+			while (p < end && *p < 0x80)
+				p++;
+			if (p == end)
+				break;
+
+			// a multi-byte sequence, the second byte's valid range
+			// depends on the lead byte
+			unsigned int lead = *p, n_cont;
+			unsigned char lo = 0x80, hi = 0xBF;
+			if (lead >= 0xC2 && lead <= 0xDF)
+				n_cont = 1;
+			else if (lead >= 0xE0 && lead <= 0xEF)
+			{
+				n_cont = 2;
+				if (lead == 0xE0)
+					lo = 0xA0;
+				else if (lead == 0xED)
+					hi = 0x9F;
+			}
+			else if (lead >= 0xF0 && lead <= 0xF4)
+			{
+				n_cont = 3;
+				if (lead == 0xF0)
+					lo = 0x90;
+				else if (lead == 0xF4)
+					hi = 0x8F;
+			}
+			else
+				return false;
+
+			if (static_cast<size_t>(end - p) <= n_cont)
+				return false;
+			if (p[1] < lo || p[1] > hi)
+				return false;
+			for (unsigned int i = 2; i <= n_cont; i++)
+			{
+				if ((p[i] & 0xC0) != 0x80)
+					return false;
+			}
+			p += n_cont + 1;
+		}
+
+		return true;
+	}
+
+	// Feeds a mapped file into a document's editor from the main loop.
+	// Kept alive by the idle handler and dropped when loading finishes
+	// or the document goes away.
+	struct LargeFileLoader
+	{
+		GMappedFile *map;
+		std::string filename;
+		// what the caller asked for, for falling back to open()
+		GeanyFiletype *filetype;
+		const char *data;
+		size_t size;
+		size_t offset;
+		// the data before this was checked to be UTF-8
+		size_t checked;
+		size_t chunk_size;
+		gint64 start_time;
+		gint64 first_paint_time;
+		gint64 load_time;
+		DocumentHandle handle;
+		sigc::connection paint_conn;
+
+		LargeFileLoader(GMappedFile *map, const std::string &filename,
+			GeanyFiletype *filetype, size_t offset)
+			: map(map),
+			  filename(filename),
+			  filetype(filetype),
+			  data(::g_mapped_file_get_contents(map)),
+			  size(::g_mapped_file_get_length(map)),
+			  offset(offset),
+			  checked(offset),
+			  chunk_size(Document::large_file_options().chunk_size),
+			  start_time(g_get_monotonic_time()),
+			  first_paint_time(0),
+			  load_time(0)
+		{
+			if (chunk_size == 0)
+				chunk_size = size;
+		}
+
+		~LargeFileLoader()
+		{
+			release_map();
+		}
+
+		void release_map()
+		{
+			if (map)
+				::g_mapped_file_unref(map);
+			map = nullptr;
+			data = nullptr;
+		}
+
+		// end the chunk after a newline where possible, so the editor
+		// never holds a partial line or a partial character
+		size_t next_chunk_end() const
+		{
+			size_t end = offset + chunk_size;
+			if (end >= size)
+				return size;
+			for (size_t pos = end; pos > offset; pos--)
+			{
+				if (data[pos - 1] == '\n')
+					return pos;
+			}
+			while (end > offset && (data[end] & 0xC0) == 0x80)
+				end--;
+			return end;
+		}
+
+		// checks the data up to @a end, a chunk at a time so a huge
+		// file isn't read in full before anything is shown
+		bool check_to(size_t end)
+		{
+			if (end <= checked)
+				return true;
+			if (!validate_utf8(data + checked, end - checked))
+				return false;
+			checked = end;
+			return true;
+		}
+
+		// the file isn't UTF-8 after all, let Geany open it with its
+		// encoding detection instead
+		void fall_back(Document &doc)
+		{
+			update_progress(true);
+			release_map();
+			// so closing doesn't ask to save what was loaded so far
+			doc.editor()->send(SCI_SETSAVEPOINT);
+			::document_set_text_changed(doc.m_doc, FALSE);
+			::document_close(doc.m_doc);
+			::document_open_file(filename.c_str(), TRUE, filetype, nullptr);
+		}
+
+		void update_progress(bool done)
+		{
+			if (!Geany::ui || !Geany::ui->progressbar)
+				return;
+			if (done)
+			{
+				Geany::ui->progressbar->hide();
+				return;
+			}
+			double fraction = size ? double(offset) / size : 1.0;
+			Geany::ui->progressbar->set_fraction(fraction);
+			Geany::ui->progressbar->set_text(
+				Glib::ustring::format(int(fraction * 100), "%"));
+			Geany::ui->progressbar->show();
+		}
+
+		void emit_stats(Document &doc)
+		{
+			LargeFileStats stats;
+			stats.bytes = size;
+			stats.first_paint_ms = (first_paint_time - start_time) / 1000.0;
+			stats.load_ms = (load_time - start_time) / 1000.0;
+			doc.signal_large_file_loaded_.emit(stats);
+		}
+
+		void on_painted()
+		{
+			if (first_paint_time != 0)
+				return;
+			first_paint_time = g_get_monotonic_time();
+			auto doc = handle.get();
+			if (doc && load_time != 0)
+				emit_stats(*doc);
+		}
+
+		// appends the next chunk, returns false once there's nothing
+		// left to do
+		bool load_chunk()
+		{
+			auto doc = handle.get();
+			if (!doc || !doc->is_valid())
+			{
+				update_progress(true);
+				return false;
+			}
+
+			// read-only all along so nothing typed meanwhile ends up
+			// passing for the file's contents
+			size_t end = next_chunk_end();
+			if (!check_to(end))
+			{
+				fall_back(*doc);
+				return false;
+			}
+
+			Scintilla *sci = doc->editor();
+			sci->send(SCI_SETREADONLY, 0);
+			sci->send(SCI_APPENDTEXT, end - offset,
+				reinterpret_cast<intptr_t>(data + offset));
+			sci->send(SCI_SETREADONLY, 1);
+			offset = end;
+
+			if (offset < size)
+			{
+				update_progress(false);
+				return true;
+			}
+
+			sci->send(SCI_SETUNDOCOLLECTION, 1);
+			sci->send(SCI_EMPTYUNDOBUFFER);
+			sci->send(SCI_SETSAVEPOINT);
+			::document_set_text_changed(doc->m_doc, FALSE);
+			update_progress(true);
+
+			load_time = g_get_monotonic_time();
+			if (first_paint_time != 0)
+				emit_stats(*doc);
+			release_map();
+			return false;
+		}
+	};
+
+	Document *Document::open_large(const std::string &filename, Filetype *filetype)
+	{
+		// Geany compares real paths and then names, the latter is what
+		// finds a large file opened before
+		Glib::ustring utf8_filename = Glib::filename_to_utf8(filename);
+		if (GeanyDocument *open = ::document_find_by_filename(utf8_filename.c_str()))
+		{
+			auto doc = g_proxy->documents.add(open);
+			if (doc && Geany::ui)
+				Geany::ui->notebook->set_current_page(::document_get_notebook_page(open));
+			return doc;
+		}
+
+		GError *error = nullptr;
+		GMappedFile *map = ::g_mapped_file_new(filename.c_str(), FALSE, &error);
+		if (!map)
+		{
+			g_warning("unable to map '%s': %s", filename.c_str(), error->message);
+			g_error_free(error);
+			return nullptr;
+		}
+
+		const char *data = ::g_mapped_file_get_contents(map);
+		size_t size = ::g_mapped_file_get_length(map);
+		size_t offset = 0;
+		bool has_bom = (size >= 3 && std::memcmp(data, "\xEF\xBB\xBF", 3) == 0);
+		if (has_bom)
+			offset = 3;
+
+		GeanyFiletype *ft = filetype ? filetype->get() : nullptr;
+		std::shared_ptr<LargeFileLoader> loader(new LargeFileLoader(map, filename, ft, offset));
+
+		// only the first chunk is checked up front, most files that
+		// aren't UTF-8 fail early on
+		if (!loader->check_to(loader->next_chunk_end()))
+			return nullptr;
+
+		size_t lexing_limit = large_file_options().lexing_limit;
+		if (lexing_limit > 0 && size > lexing_limit)
+			ft = ::filetypes_index(GEANY_FILETYPES_NONE);
+		else if (!ft)
+			ft = ::filetypes_detect_from_file(filename.c_str());
+
+		GeanyDocument *gdoc = ::document_new_file(utf8_filename.c_str(), ft, nullptr);
+		auto doc = g_proxy->documents.add(gdoc);
+		if (!doc)
+			return nullptr;
+
+		::document_set_encoding(gdoc, "UTF-8");
+		gdoc->has_bom = has_bom;
+		loader->handle = doc->handle();
+
+		Scintilla *sci = doc->editor();
+		gdoc->readonly = TRUE;
+		sci->send(SCI_SETREADONLY, 1);
+		sci->send(SCI_SETUNDOCOLLECTION, 0);
+		sci->send(SCI_ALLOCATE, size - offset + 1);
+
+		// the connection keeps the loader alive until the first paint
+		// even if loading is done by then
+		loader->paint_conn = sci->signal_painted().connect(
+			[loader](const SCNotification&) {
+				std::shared_ptr<LargeFileLoader> self(loader);
+				self->paint_conn.disconnect();
+				self->on_painted();
+				return false;
+			});
+
+		// get the first screenful in right away, the rest is added
+		// between redraws
+		if (loader->load_chunk())
+		{
+			Glib::signal_idle().connect([loader]() {
+				Tracer::Span span("LargeFileLoader::load_chunk", "idle");
+				return loader->load_chunk();
+			}, Glib::PRIORITY_LOW);
+		}
+
+		return doc;
+	}
+
+}
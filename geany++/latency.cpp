@@ -0,0 +1,193 @@
+#include <geany++/latency.hpp>
+
+#ifdef HAVE_CONFIG_H
+#include <geany++/config.h>
+#endif
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+// a keystroke that isn't painted within this many microseconds, like
+// in a document that isn't visible, isn't measured
+#define TYPING_TIMEOUT_USEC    (2 * G_USEC_PER_SEC)
+
+// how often the statusbar readout is updated at most
+#define STATUSBAR_INTERVAL_USEC (G_USEC_PER_SEC / 2)
+
+namespace Geany
+{
+
+	static LatencyHistogram combined_total;
+	static bool show_statusbar = false;
+	static int64_t statusbar_updated = 0;
+
+	//
+	// LatencyHistogram
+	//
+
+	LatencyHistogram::LatencyHistogram()
+	{
+		reset();
+	}
+
+	void LatencyHistogram::reset()
+	{
+		std::memset(m_buckets, 0, sizeof(m_buckets));
+		m_count = 0;
+		m_sum = 0;
+		m_max = 0;
+	}
+
+	// values below 2 * SUB_BUCKETS each get a bucket, above that each
+	// power of two is split into SUB_BUCKETS buckets
+	size_t LatencyHistogram::bucket(int64_t usec)
+	{
+		if (usec < 2 * SUB_BUCKETS)
+			return usec < 0 ? 0 : usec;
+		unsigned int exponent = 63 - __builtin_clzll(static_cast<uint64_t>(usec));
+		if (exponent > MAX_EXPONENT)
+			return N_BUCKETS - 1;
+		size_t sub = (usec >> (exponent - 3)) & (SUB_BUCKETS - 1);
+		return 2 * SUB_BUCKETS + (exponent - 4) * SUB_BUCKETS + sub;
+	}
+
+	// the middle of a bucket's range
+	int64_t LatencyHistogram::bucket_value(size_t index)
+	{
+		if (index < 2 * SUB_BUCKETS)
+			return index;
+		unsigned int exponent = 4 + (index - 2 * SUB_BUCKETS) / SUB_BUCKETS;
+		int64_t sub = (index - 2 * SUB_BUCKETS) % SUB_BUCKETS;
+		int64_t width = int64_t(1) << (exponent - 3);
+		return (SUB_BUCKETS + sub) * width + width / 2;
+	}
+
+	void LatencyHistogram::add(int64_t usec)
+	{
+		m_buckets[bucket(usec)]++;
+		m_count++;
+		m_sum += usec;
+		m_max = std::max(m_max, usec);
+	}
+
+	void LatencyHistogram::merge(const LatencyHistogram &other)
+	{
+		for (size_t i = 0; i < N_BUCKETS; i++)
+			m_buckets[i] += other.m_buckets[i];
+		m_count += other.m_count;
+		m_sum += other.m_sum;
+		m_max = std::max(m_max, other.m_max);
+	}
+
+	int64_t LatencyHistogram::percentile(double fraction) const
+	{
+		if (m_count == 0)
+			return 0;
+		size_t target = std::max<size_t>(1, std::ceil(fraction * m_count));
+		size_t seen = 0;
+		for (size_t i = 0; i < N_BUCKETS; i++)
+		{
+			seen += m_buckets[i];
+			if (seen >= target)
+				return std::min(bucket_value(i), m_max);
+		}
+		return m_max;
+	}
+
+	//
+	// TypingStats
+	//
+
+	TypingStats::TypingStats()
+	{
+		reset();
+	}
+
+	void TypingStats::reset()
+	{
+		m_total.reset();
+		m_handlers.reset();
+		std::memset(&m_last, 0, sizeof(m_last));
+		m_start = 0;
+		m_modified = 0;
+		m_handlers_end = 0;
+		m_handler_time = 0;
+	}
+
+	const LatencyHistogram &TypingStats::combined()
+	{
+		return combined_total;
+	}
+
+	void TypingStats::set_statusbar_readout(bool enable)
+	{
+		show_statusbar = enable;
+	}
+
+	bool TypingStats::statusbar_readout()
+	{
+		return show_statusbar;
+	}
+
+	// returns whether the notification is part of a keystroke, so its
+	// handlers should be timed
+	bool TypingStats::input(unsigned int code, int modification_type, int64_t now)
+	{
+		bool user_edit = (code == SCN_MODIFIED &&
+			(modification_type & (SC_MOD_INSERTTEXT | SC_MOD_DELETETEXT)) &&
+			(modification_type & SC_PERFORMED_USER));
+		if (!user_edit && code != SCN_KEY && code != SCN_CHARADDED)
+			return false;
+
+		if (m_start == 0 || now - m_start > TYPING_TIMEOUT_USEC)
+		{
+			m_start = now;
+			m_modified = 0;
+			m_handlers_end = now;
+			m_handler_time = 0;
+		}
+		if (user_edit && m_modified == 0)
+			m_modified = now;
+		return true;
+	}
+
+	void TypingStats::handled(int64_t start, int64_t end)
+	{
+		m_handler_time += end - start;
+		m_handlers_end = end;
+	}
+
+	void TypingStats::painted(GeanyDocument *doc, int64_t now)
+	{
+		if (m_start == 0)
+			return;
+		int64_t start = m_start;
+		m_start = 0;
+		if (now - start > TYPING_TIMEOUT_USEC)
+			return;
+
+		m_last.to_modified = m_modified ? m_modified - start : 0;
+		m_last.handlers = m_handler_time;
+		m_last.handlers_to_paint = now - m_handlers_end;
+		m_last.total = now - start;
+		m_last.length = ::scintilla_send_message(doc->editor->sci, SCI_GETLENGTH, 0, 0);
+		m_total.add(m_last.total);
+		m_handlers.add(m_last.handlers);
+		combined_total.add(m_last.total);
+		signal_measured_.emit(m_last);
+
+		if (show_statusbar && now - statusbar_updated >= STATUSBAR_INTERVAL_USEC &&
+			::document_get_current() == doc)
+		{
+			statusbar_updated = now;
+			::ui_set_statusbar(FALSE,
+				"Typing latency: median %.1f ms, 95%% %.1f ms, max %.1f ms "
+				"(plugins %.1f ms median, %zu keys, %zu KiB)",
+				m_total.median() / 1000.0, m_total.percentile(0.95) / 1000.0,
+				m_total.max() / 1000.0, m_handlers.median() / 1000.0,
+				m_total.count(), m_last.length / 1024);
+		}
+	}
+
+}
@@ -0,0 +1,165 @@
+#pragma once
+
+#include <geany++/common.hpp>
+#include <cstddef>
+#include <cstdint>
+
+namespace Geany
+{
+
+	/**
+	 * A histogram of durations in microseconds.
+	 *
+	 * Buckets are log-linear, eight per power of two, so percentiles
+	 * are accurate to within about 6% while adding a value is a few
+	 * instructions and the histogram is a fixed size.
+	 */
+	class LatencyHistogram
+	{
+	public:
+
+		LatencyHistogram();
+
+		void add(int64_t usec);
+		void merge(const LatencyHistogram &other);
+		void reset();
+
+		size_t count() const
+		{
+			return m_count;
+		}
+
+		int64_t max() const
+		{
+			return m_max;
+		}
+
+		double mean() const
+		{
+			return m_count ? double(m_sum) / m_count : 0.0;
+		}
+
+		/**
+		 * Get the value below which @a fraction (0 to 1) of the
+		 * durations fall, 0 if there are none.
+		 */
+		int64_t percentile(double fraction) const;
+
+		int64_t median() const
+		{
+			return percentile(0.5);
+		}
+
+	private:
+		enum { SUB_BUCKETS = 8, MAX_EXPONENT = 25 };
+		enum { N_BUCKETS = (MAX_EXPONENT - 1) * SUB_BUCKETS };
+
+		uint32_t m_buckets[N_BUCKETS];
+		size_t m_count;
+		int64_t m_sum;
+		int64_t m_max;
+
+		static size_t bucket(int64_t usec);
+		static int64_t bucket_value(size_t index);
+	};
+
+	/**
+	 * How long one keystroke took from Scintilla reporting it to the
+	 * editor being repainted, in microseconds.
+	 *
+	 * The keystroke starts with the first of SCN_KEY, a user
+	 * SCN_MODIFIED or SCN_CHARADDED after the previous paint and ends
+	 * with the next SCN_PAINTED of the same editor.
+	 */
+	struct TypingLatency
+	{
+		int64_t to_modified;        //!< Start to the SCN_MODIFIED.
+		int64_t handlers;           //!< Time spent in handlers of the keystroke's notifications.
+		int64_t handlers_to_paint;  //!< Last handler returning to SCN_PAINTED.
+		int64_t total;              //!< Start to SCN_PAINTED.
+		size_t length;              //!< The document's length in bytes when painted.
+	};
+
+	/**
+	 * Typing latency of a document.
+	 *
+	 * Measured for every document as it's edited, see
+	 * Document::typing_stats(). The totals of all documents are
+	 * combined in combined().
+	 */
+	class TypingStats
+	{
+	public:
+
+		/**
+		 * Distribution of TypingLatency::total.
+		 */
+		const LatencyHistogram &total() const
+		{
+			return m_total;
+		}
+
+		/**
+		 * Distribution of TypingLatency::handlers, the part plugins
+		 * and the framework are responsible for.
+		 */
+		const LatencyHistogram &handlers() const
+		{
+			return m_handlers;
+		}
+
+		/**
+		 * The most recent keystroke, all zero before the first.
+		 */
+		const TypingLatency &last() const
+		{
+			return m_last;
+		}
+
+		void reset();
+
+		/**
+		 * Signal emitted after each keystroke was measured.
+		 */
+		sigc::signal<void, const TypingLatency&> &signal_measured()
+		{
+			return signal_measured_;
+		}
+
+		/**
+		 * The total latencies of all documents since the proxy was
+		 * loaded.
+		 */
+		static const LatencyHistogram &combined();
+
+		/**
+		 * Show the current document's typing latency in Geany's
+		 * statusbar, updated at most twice a second while typing.
+		 *
+		 * Also enabled by starting Geany with
+		 * `GEANYCPP_TYPING_LATENCY=1`.
+		 */
+		static void set_statusbar_readout(bool enable);
+		static bool statusbar_readout();
+
+	private:
+		LatencyHistogram m_total;
+		LatencyHistogram m_handlers;
+		TypingLatency m_last;
+		int64_t m_start;
+		int64_t m_modified;
+		int64_t m_handlers_end;
+		int64_t m_handler_time;
+		sigc::signal<void, const TypingLatency&> signal_measured_;
+
+		TypingStats();
+		bool input(unsigned int code, int modification_type, int64_t now);
+		void handled(int64_t start, int64_t end);
+		void painted(GeanyDocument *doc, int64_t now);
+
+		friend class Document;
+		friend gboolean on_editor_notify(GObject*, GeanyEditor*,
+			SCNotification*, gpointer) noexcept G_GNUC_INTERNAL;
+	};
+
+}
@@ -1,8 +1,12 @@
 #include <geany++/pluginconfig.hpp>
 #include <geany++/geany.hpp>
+#include <geany++/tracer_p.hpp>
 #include <geany++/utils.hpp>
 
+#include <functional>
+
 #define DEFAULT_GROUP "settings"
+#define DEFAULT_SAVE_DELAY 500
 
 namespace Geany
 {
@@ -14,20 +18,26 @@ namespace Geany
 			"config.ini");
 	}
 
+	static inline size_t hash_contents(const std::string &data)
+	{
+		return std::hash<std::string>()(data);
+	}
+
 	PluginConfig::PluginConfig(const std::string &plugin_filename)
-		: m_fn(make_cfg_name(plugin_filename))
+		: m_fn(make_cfg_name(plugin_filename)),
+		  m_dirty(false),
+		  m_save_delay(DEFAULT_SAVE_DELAY),
+		  m_saved_hash(hash_contents(std::string()))
 	{
 		load();
-		m_group_stack.emplace_back(DEFAULT_GROUP);
-		update_current_group();
+		begin_group(DEFAULT_GROUP);
 	}
 
 	PluginConfig::~PluginConfig()
 	{
 		try
 		{
-			if (!m_kf.get_groups().empty())
-				save();
+			flush();
 		}
 		catch (...) {}
 	}
@@ -36,8 +46,15 @@ namespace Geany
 	{
 		try
 		{
-			return m_kf.load_from_file(m_fn,
+			bool loaded = m_kf.load_from_file(m_fn,
 				Glib::KEY_FILE_KEEP_COMMENTS | Glib::KEY_FILE_KEEP_TRANSLATIONS);
+			if (loaded)
+			{
+				m_saved_hash = hash_contents(m_kf.to_data());
+				m_dirty = false;
+				signal_loaded_.emit();
+			}
+			return loaded;
 		}
 		catch (Glib::FileError&)
 		{
@@ -51,48 +68,75 @@ namespace Geany
 
 	bool PluginConfig::save()
 	{
-		return m_kf.save_to_file(m_fn);
+		m_save_conn.disconnect();
+
+		std::string data = m_kf.to_data();
+		size_t hash = hash_contents(data);
+		if (hash != m_saved_hash || !Glib::file_test(m_fn, Glib::FILE_TEST_EXISTS))
+		{
+			auto dir = Glib::path_get_dirname(m_fn);
+			if (g_mkdir_with_parents(dir.c_str(), 0755) != 0)
+				return false;
+			// writes a temporary file and renames it over the old one
+			Glib::file_set_contents(m_fn, data);
+			m_saved_hash = hash;
+		}
+
+		m_dirty = false;
+		return true;
 	}
 
 	void PluginConfig::save_later()
 	{
-		Glib::signal_idle().connect([this]() {
-			save();
+		m_save_conn.disconnect();
+		m_save_conn = Glib::signal_timeout().connect([this]() {
+			Tracer::Span span("PluginConfig::save", "idle");
+			try
+			{
+				save();
+			}
+			catch (Glib::FileError &err)
+			{
+				g_warning("unable to save config file '%s': %s",
+					m_fn.c_str(), err.what().c_str());
+			}
 			return false;
-		});
+		}, m_save_delay, Glib::PRIORITY_LOW);
 	}
 
-	void PluginConfig::begin_group(const std::string &group)
+	// keyfile() may have been edited without mark_dirty(), so save
+	// whatever there is and let the hash skip unchanged contents; a
+	// config that was never given any settings isn't created though
+	void PluginConfig::flush()
 	{
-		m_group_stack.emplace_back(group);
-		update_current_group();
+		bool pending = m_save_conn.connected();
+		m_save_conn.disconnect();
+		if (m_dirty || pending || !m_kf.get_groups().empty())
+			save();
 	}
 
-	void PluginConfig::end_group()
+	// the current group name is kept joined and each nesting level only
+	// remembers where it starts, so entering or leaving a group doesn't
+	// rebuild the whole name
+	void PluginConfig::begin_group(const std::string &group)
 	{
-		if (!m_group.empty())
-		{
-			m_group_stack.pop_back();
-			update_current_group();
-		}
+		if (m_group_lengths.empty())
+			m_group.clear();
+		m_group_lengths.push_back(m_group.size());
+		if (m_group_lengths.size() > 1)
+			m_group += '/';
+		m_group += group;
 	}
 
-	void PluginConfig::update_current_group()
+	void PluginConfig::end_group()
 	{
-		if (!m_group_stack.empty())
+		if (!m_group_lengths.empty())
 		{
-			m_group.clear();
-			for (size_t i = 0, last = m_group_stack.size() - 1; i < m_group_stack.size(); i++)
-			{
-				m_group += m_group_stack[i];
-				if (i != last)
-					m_group += "/";
-			}
+			m_group.resize(m_group_lengths.back());
+			m_group_lengths.pop_back();
 		}
-		else
-		{
+		if (m_group_lengths.empty())
 			m_group = DEFAULT_GROUP;
-		}
 	}
 
 }
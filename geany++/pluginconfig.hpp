@@ -27,9 +27,53 @@ namespace Geany
 		}
 
 		bool load();
+
+		/**
+		 * Write the config file now.
+		 *
+		 * The file is written to a temporary file and renamed over the
+		 * old one. Nothing is written if the contents are the same as
+		 * what was last loaded or saved.
+		 */
 		bool save();
+
+		/**
+		 * Schedule a save() after save_delay() milliseconds.
+		 *
+		 * Only one save is ever pending, calling this again before it
+		 * runs pushes it back, so a burst of changes is written once.
+		 */
 		void save_later();
 
+		/**
+		 * Run any pending save right away. Changes made to keyfile()
+		 * without mark_dirty() are saved too.
+		 */
+		void flush();
+
+		bool is_dirty() const
+		{
+			return m_dirty;
+		}
+
+		unsigned int save_delay() const
+		{
+			return m_save_delay;
+		}
+
+		void save_delay(unsigned int msecs)
+		{
+			m_save_delay = msecs;
+		}
+
+		/**
+		 * Mark the config as changed after editing keyfile() directly.
+		 */
+		void mark_dirty()
+		{
+			m_dirty = true;
+		}
+
 		void begin_group(const std::string &group);
 		void end_group();
 
@@ -39,16 +83,38 @@ namespace Geany
 		template< class T >
 		void set(const std::string &key, T value);
 
+		/**
+		 * Signal emitted after the config file was (re)loaded.
+		 */
+		sigc::signal<void> &signal_loaded()
+		{
+			return signal_loaded_;
+		}
+
+		/**
+		 * Signal emitted when a key is changed with set(), the
+		 * arguments are the full group name and the key.
+		 */
+		sigc::signal<void, const std::string&, const std::string&> &signal_changed()
+		{
+			return signal_changed_;
+		}
+
 	private:
 		std::string m_fn;
 		std::string m_group;
 		Glib::KeyFile m_kf;
-		std::vector<std::string> m_group_stack;
+		std::vector<size_t> m_group_lengths;
+		bool m_dirty;
+		unsigned int m_save_delay;
+		size_t m_saved_hash;
+		sigc::connection m_save_conn;
+		sigc::signal<void> signal_loaded_;
+		sigc::signal<void, const std::string&, const std::string&> signal_changed_;
 		PluginConfig(const std::string &plugin_filename);
 		PluginConfig(const PluginConfig&);
 		PluginConfig &operator=(const PluginConfig&);
 		~PluginConfig();
-		void update_current_group();
 		friend class PluginData;
 	};
 
@@ -98,42 +164,56 @@ namespace Geany
 	inline void PluginConfig::set<const std::string&>(const std::string &key, const std::string &value)
 	{
 		m_kf.set_string(m_group, key, value);
+		m_dirty = true;
+		signal_changed_.emit(m_group, key);
 	}
 
 	template<>
 	inline void PluginConfig::set<const std::vector<std::string>&>(const std::string &key, const std::vector<std::string> &value)
 	{
 		m_kf.set_string_list(m_group, key, value);
+		m_dirty = true;
+		signal_changed_.emit(m_group, key);
 	}
 
 	template<>
 	inline void PluginConfig::set<bool>(const std::string &key, bool value)
 	{
 		m_kf.set_boolean(m_group, key, value);
+		m_dirty = true;
+		signal_changed_.emit(m_group, key);
 	}
 
 	template<>
 	inline void PluginConfig::set<int>(const std::string &key, int value)
 	{
 		m_kf.set_integer(m_group, key, value);
+		m_dirty = true;
+		signal_changed_.emit(m_group, key);
 	}
 
 	template<>
 	inline void PluginConfig::set<int64_t>(const std::string &key, int64_t value)
 	{
 		m_kf.set_int64(m_group, key, value);
+		m_dirty = true;
+		signal_changed_.emit(m_group, key);
 	}
 
 	template<>
 	inline void PluginConfig::set<uint64_t>(const std::string &key, uint64_t value)
 	{
 		m_kf.set_uint64(m_group, key, value);
+		m_dirty = true;
+		signal_changed_.emit(m_group, key);
 	}
 
 	template<>
 	inline void PluginConfig::set<double>(const std::string &key, double value)
 	{
 		m_kf.set_double(m_group, key, value);
+		m_dirty = true;
+		signal_changed_.emit(m_group, key);
 	}
 
 }
@@ -0,0 +1,203 @@
+#include <geany++/profiler_p.hpp>
+#include <geany++/scintilla.hpp>
+#include <geany++/scintillameta.hpp>
+#include <geany++/tracer_p.hpp>
+
+#ifdef HAVE_CONFIG_H
+#include <geany++/config.h>
+#endif
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// messages listed per caller in the report
+#define REPORT_TOP_MESSAGES 20
+
+namespace Geany
+{
+
+	namespace Profiler
+	{
+
+		std::atomic<bool> g_enabled(false);
+
+		namespace
+		{
+			// callers are keyed by the span's name pointer, which are
+			// literals, static tables or interned
+			struct Key
+			{
+				const char *caller;
+				bool plugin;
+				unsigned int message;
+
+				bool operator==(const Key &other) const
+				{
+					return (caller == other.caller && plugin == other.plugin &&
+						message == other.message);
+				}
+			};
+
+			struct KeyHash
+			{
+				size_t operator()(const Key &key) const
+				{
+					return (std::hash<const char*>()(key.caller) * 31 +
+						key.message) * 2 + key.plugin;
+				}
+			};
+
+			struct Stat
+			{
+				uint64_t calls;
+				int64_t nsec;
+			};
+
+			struct Caller
+			{
+				Stat total;
+				std::map<unsigned int, Stat> messages;
+			};
+
+			std::mutex stats_mutex;
+			std::unordered_map<Key, Stat, KeyHash> stats;
+			std::string report_filename;
+
+			Key make_key(unsigned int message)
+			{
+				const Tracer::Span *innermost = Tracer::Span::current();
+				for (auto span = innermost; span; span = span->parent())
+				{
+					if (span->plugin())
+						return Key{ span->plugin(), true, message };
+				}
+				return Key{ innermost ? innermost->name() : "(outside of any span)",
+					false, message };
+			}
+
+			void write_caller(FILE *fp, const std::pair<bool, std::string> &id,
+				const Caller &caller)
+			{
+				if (id.first)
+					std::fprintf(fp, "\nplugin \"%s\"", id.second.c_str());
+				else
+					std::fprintf(fp, "\nin \"%s\"", id.second.c_str());
+				std::fprintf(fp, ": %llu messages, %.3f ms\n",
+					static_cast<unsigned long long>(caller.total.calls),
+					caller.total.nsec / 1e6);
+				std::fprintf(fp, "    %10s %10s %9s %6s  %s\n",
+					"calls", "total ms", "mean us", "%", "message");
+
+				std::vector<std::pair<unsigned int, Stat>> hottest(
+					caller.messages.begin(), caller.messages.end());
+				std::sort(hottest.begin(), hottest.end(),
+					[](const std::pair<unsigned int, Stat> &a, const std::pair<unsigned int, Stat> &b) {
+						return a.second.nsec > b.second.nsec;
+					});
+				if (hottest.size() > REPORT_TOP_MESSAGES)
+					hottest.resize(REPORT_TOP_MESSAGES);
+
+				for (auto &entry : hottest)
+				{
+					const Stat &stat = entry.second;
+					std::fprintf(fp, "    %10llu %10.3f %9.2f %6.1f  ",
+						static_cast<unsigned long long>(stat.calls), stat.nsec / 1e6,
+						stat.nsec / 1e3 / stat.calls,
+						caller.total.nsec ? 100.0 * stat.nsec / caller.total.nsec : 0.0);
+					if (const char *name = SciMeta::message_name(entry.first))
+						std::fprintf(fp, "%s\n", name);
+					else
+						std::fprintf(fp, "message %u\n", entry.first);
+				}
+			}
+		}
+
+		bool start(const std::string &filename)
+		{
+			std::lock_guard<std::mutex> lock(stats_mutex);
+			if (g_enabled.load())
+				return false;
+			report_filename = filename;
+			stats.clear();
+			g_enabled.store(true);
+			Tracer::g_span_watchers++;
+			detail::send_observers++;
+			return true;
+		}
+
+		void stop()
+		{
+			std::lock_guard<std::mutex> lock(stats_mutex);
+			if (!g_enabled.exchange(false))
+				return;
+			detail::send_observers--;
+			Tracer::g_span_watchers--;
+
+			// the same name may come from different pointers, merge by
+			// the string, plugins first
+			std::map<std::pair<bool, std::string>, Caller> callers;
+			for (auto &entry : stats)
+			{
+				Caller &caller = callers[std::make_pair(entry.first.plugin,
+					std::string(entry.first.caller))];
+				Stat &stat = caller.messages[entry.first.message];
+				stat.calls += entry.second.calls;
+				stat.nsec += entry.second.nsec;
+				caller.total.calls += entry.second.calls;
+				caller.total.nsec += entry.second.nsec;
+			}
+			stats.clear();
+
+			std::vector<std::pair<const std::pair<bool, std::string>*, const Caller*>> order;
+			for (auto &entry : callers)
+				order.emplace_back(&entry.first, &entry.second);
+			std::stable_sort(order.begin(), order.end(),
+				[](const std::pair<const std::pair<bool, std::string>*, const Caller*> &a,
+					const std::pair<const std::pair<bool, std::string>*, const Caller*> &b) {
+					if (a.first->first != b.first->first)
+						return a.first->first;
+					return a.second->total.nsec > b.second->total.nsec;
+				});
+
+			FILE *fp = std::fopen(report_filename.c_str(), "w");
+			if (!fp)
+			{
+				g_warning("unable to write Scintilla profile '%s': %s",
+					report_filename.c_str(), std::strerror(errno));
+				return;
+			}
+
+			std::fputs("Scintilla messages sent through Geany++, hottest first.\n"
+				"Messages sent outside of a plugin's hooks, like from signal\n"
+				"handlers, are listed by where they were sent.\n", fp);
+			for (auto &entry : order)
+				write_caller(fp, *entry.first, *entry.second);
+
+			if (std::fclose(fp) != 0)
+			{
+				g_warning("unable to write Scintilla profile '%s': %s",
+					report_filename.c_str(), std::strerror(errno));
+			}
+		}
+
+		void record_send(unsigned int message, int64_t nsec)
+		{
+			if (!enabled())
+				return;
+			Key key = make_key(message);
+			std::lock_guard<std::mutex> lock(stats_mutex);
+			Stat &stat = stats[key];
+			stat.calls++;
+			stat.nsec += nsec;
+		}
+
+	}
+
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <geany++/common.hpp>
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+namespace Geany
+{
+
+	// Counts and times every message sent with Scintilla::send(),
+	// per message and per caller. Enabled by starting Geany with
+	// GEANYCPP_SCI_PROFILE=<file>, the report is written when the proxy
+	// is unloaded and lists the hottest messages of each plugin.
+	//
+	// Callers are found through the tracer's spans: the innermost
+	// plugin hook or handler connected with IPlugin::connect(), or for
+	// messages sent outside of one the framework span they were sent
+	// in, like "SCN_MODIFIED" for a handler connected directly.
+	namespace Profiler
+	{
+
+		extern std::atomic<bool> g_enabled;
+
+		inline bool enabled()
+		{
+			return g_enabled.load(std::memory_order_relaxed);
+		}
+
+		// starts profiling, returns false if already profiling
+		bool start(const std::string &filename);
+
+		// stops profiling and writes the report
+		void stop();
+
+		// records one message which took @a nsec
+		void record_send(unsigned int message, int64_t nsec);
+
+	}
+
+}
@@ -4,6 +4,28 @@
 namespace Geany
 {
 
+	Project::Project(GeanyProject *proj)
+		: m_proj(proj),
+		  m_index(new ProjectIndex(index_base_path(), file_patterns(),
+			ProjectIndex::default_cache_filename(filename())))
+	{
+		// the base path or the patterns may have been edited
+		signal_dialog_confirmed_.connect([this](Gtk::Notebook*) {
+			m_index->configure(index_base_path(), file_patterns());
+		});
+	}
+
+	// Geany allows a base path relative to the project file
+	std::string Project::index_base_path() const
+	{
+		if (!m_proj->base_path || !*m_proj->base_path)
+			return std::string();
+		std::string path = m_proj->base_path;
+		if (!Glib::path_is_absolute(path))
+			path = Glib::build_filename(Glib::path_get_dirname(filename()), path);
+		return path;
+	}
+
 #ifdef GEANY_API_HAVE_PROJECT_OPEN
 	Project *Project::open(const std::string &fn)
 	{
@@ -1,6 +1,8 @@
 #pragma once
 
 #include <geany++/common.hpp>
+#include <geany++/projectindex.hpp>
+#include <memory>
 
 #if GEANY_API_VERSION >= 229 && 0
 #define GEANY_API_HAVE_PROJECT_OPEN 1
@@ -46,11 +48,20 @@ namespace Geany
 		std::vector<std::string> file_patterns() const
 		{
 			std::vector<std::string> pats;
-			for (gchar **p=m_proj->file_patterns; *p; p++)
+			for (gchar **p=m_proj->file_patterns; p && *p; p++)
 				pats.emplace_back(*p);
 			return pats;
 		}
 
+		/**
+		 * Get the index of the files below base_path() matching
+		 * file_patterns(), built when the project was opened.
+		 */
+		ProjectIndex &file_index()
+		{
+			return *m_index;
+		}
+
 		void write_config()
 		{
 			::project_write_config();
@@ -87,13 +98,15 @@ namespace Geany
 
 	private:
 		GeanyProject *m_proj;
+		std::unique_ptr<ProjectIndex> m_index;
 		sigc::signal<void, Glib::KeyFile&> signal_save_;
 		sigc::signal<void> signal_close_;
 		sigc::signal<void, Gtk::Notebook*> signal_dialog_open_;
 		sigc::signal<void, Gtk::Notebook*> signal_dialog_confirmed_;
 		sigc::signal<void, Gtk::Notebook*> signal_dialog_close_;
 		friend class ProxyPlugin;
-		Project(GeanyProject *proj) : m_proj(proj) {}
+		Project(GeanyProject *proj);
+		std::string index_base_path() const;
 	};
 
 }
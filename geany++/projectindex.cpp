@@ -0,0 +1,911 @@
+#include <geany++/projectindex.hpp>
+#include <geany++/geany.hpp>
+#include <geany++/tracer_p.hpp>
+#include <geany++/worker_p.hpp>
+
+#ifdef HAVE_CONFIG_H
+#include <geany++/config.h>
+#endif
+
+#include <glib/gstdio.h>
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <iterator>
+#include <mutex>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <sys/inotify.h>
+#endif
+
+// identifies index cache files, the last byte is the format version
+#define CACHE_MAGIC     "GXXPIDX\x01"
+#define CACHE_MAGIC_LEN 8
+// how long changes are collected before files() is rebuilt
+#define FLUSH_MSEC      200
+// how long to wait for a burst of changes which need a rescan to end
+#define RESCAN_MSEC     1000
+
+#ifdef __linux__
+// IN_CLOSE_WRITE only to notice ignore files edited in place
+#define WATCH_MASK (IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | \
+	IN_CLOSE_WRITE | IN_ONLYDIR | IN_DONT_FOLLOW | IN_EXCL_UNLINK)
+#endif
+
+namespace Geany
+{
+
+	namespace
+	{
+		typedef std::shared_ptr<GPatternSpec> PatternPtr;
+
+		// FNV-1a, like the build history, the keys end up on disk
+		uint64_t fnv1a(uint64_t hash, const std::string &str)
+		{
+			for (unsigned char c : str)
+			{
+				hash ^= c;
+				hash *= 0x100000001B3ULL;
+			}
+			return hash;
+		}
+
+		PatternPtr compile_pattern(const std::string &glob)
+		{
+			return PatternPtr(g_pattern_spec_new(glob.c_str()), g_pattern_spec_free);
+		}
+
+		std::string child_path(const std::string &dir, const std::string &name)
+		{
+			return dir.empty() ? name : dir + '/' + name;
+		}
+
+		std::string base_name(const std::string &path)
+		{
+			size_t slash = path.rfind('/');
+			return (slash == std::string::npos) ? path : path.substr(slash + 1);
+		}
+
+		bool starts_with(const std::string &str, const std::string &prefix)
+		{
+			return str.compare(0, prefix.size(), prefix) == 0;
+		}
+
+		bool is_vcs_dir(const std::string &name)
+		{
+			static const char *names[] = { ".git", ".hg", ".svn", ".bzr", "_darcs", "CVS" };
+			for (auto vcs : names)
+			{
+				if (name == vcs)
+					return true;
+			}
+			return false;
+		}
+
+		bool is_ignore_file(const std::string &name)
+		{
+			return (name == ".gitignore" || name == ".ignore");
+		}
+
+		bool matches_any(const std::vector<std::string> &globs, const std::string &name)
+		{
+			if (globs.empty())
+				return true;
+			for (auto &glob : globs)
+			{
+				if (g_pattern_match_simple(glob.c_str(), name.c_str()))
+					return true;
+			}
+			return false;
+		}
+
+		std::string join_patterns(const std::vector<std::string> &patterns)
+		{
+			std::string joined;
+			for (auto &pattern : patterns)
+			{
+				joined += pattern;
+				joined += '\n';
+			}
+			return joined;
+		}
+	}
+
+	PathTable::PathTable(std::vector<std::string> &&paths)
+	{
+		std::sort(paths.begin(), paths.end());
+		paths.erase(std::unique(paths.begin(), paths.end()), paths.end());
+		size_t total = 0;
+		for (auto &path : paths)
+			total += path.size() + 1;
+		m_buffer.reserve(total);
+		m_offsets.reserve(paths.size());
+		for (auto &path : paths)
+			append(path.c_str(), path.size());
+	}
+
+	void PathTable::append(const char *path, size_t length)
+	{
+		m_offsets.push_back(m_buffer.size());
+		m_buffer.append(path, length);
+		m_buffer += '\0';
+	}
+
+	size_t PathTable::lower_bound(const std::string &path) const
+	{
+		auto found = std::lower_bound(m_offsets.begin(), m_offsets.end(), path,
+			[this](uint32_t offset, const std::string &value) {
+				return value.compare(m_buffer.data() + offset) > 0;
+			});
+		return found - m_offsets.begin();
+	}
+
+	bool PathTable::contains(const std::string &path) const
+	{
+		size_t i = lower_bound(path);
+		return i < size() && path == (*this)[i];
+	}
+
+	std::pair<size_t, size_t> PathTable::prefix_range(const std::string &prefix) const
+	{
+		size_t first = lower_bound(prefix), last = first;
+		while (last < size() && std::strncmp((*this)[last], prefix.c_str(), prefix.size()) == 0)
+			last++;
+		return std::make_pair(first, last);
+	}
+
+	// the rules of one ignore file, and of the ones in the directories
+	// above it through parent
+	struct ProjectIndex::IgnoreList
+	{
+		struct Rule
+		{
+			PatternPtr pattern;
+			bool negated;
+			bool dir_only;
+			// matched against the path below the list's directory
+			// rather than just the name
+			bool anchored;
+		};
+
+		std::shared_ptr<const IgnoreList> parent;
+		std::string dir;
+		std::vector<Rule> rules;
+
+		// the common subset of .gitignore, no character classes or
+		// escaped trailing spaces
+		void parse(const std::string &contents)
+		{
+			size_t pos = 0;
+			while (pos < contents.size())
+			{
+				size_t end = contents.find('\n', pos);
+				if (end == std::string::npos)
+					end = contents.size();
+				std::string line = contents.substr(pos, end - pos);
+				pos = end + 1;
+
+				while (!line.empty() && (line.back() == '\r' || line.back() == ' ' || line.back() == '\t'))
+					line.pop_back();
+				if (line.empty() || line[0] == '#')
+					continue;
+
+				Rule rule;
+				rule.negated = (line[0] == '!');
+				if (rule.negated)
+					line.erase(0, 1);
+				else if (line[0] == '\\')
+					line.erase(0, 1);
+				rule.dir_only = (!line.empty() && line.back() == '/');
+				if (rule.dir_only)
+					line.pop_back();
+				if (starts_with(line, "**/"))
+					line.erase(0, 3);
+				rule.anchored = (line.find('/') != std::string::npos);
+				if (!line.empty() && line[0] == '/')
+					line.erase(0, 1);
+				if (line.empty())
+					continue;
+				rule.pattern = compile_pattern(line);
+				rules.push_back(rule);
+			}
+		}
+
+		// the last matching rule of the innermost list decides
+		bool ignores(const std::string &path, bool is_dir) const
+		{
+			for (const IgnoreList *list = this; list; list = list->parent.get())
+			{
+				std::string below;
+				if (list->dir.empty())
+					below = path;
+				else if (path.size() > list->dir.size() && path[list->dir.size()] == '/' &&
+					starts_with(path, list->dir))
+				{
+					below = path.substr(list->dir.size() + 1);
+				}
+				else
+					continue;
+				std::string name = base_name(below);
+				for (auto rule = list->rules.rbegin(); rule != list->rules.rend(); ++rule)
+				{
+					if (rule->dir_only && !is_dir)
+						continue;
+					const std::string &subject = rule->anchored ? below : name;
+					if (g_pattern_match_string(rule->pattern.get(), subject.c_str()))
+						return !rule->negated;
+				}
+			}
+			return false;
+		}
+	};
+
+	// shared with the walks, which add their watches from the workers
+	struct ProjectIndex::Inotify
+	{
+		int fd;
+
+		Inotify()
+			: fd(-1)
+		{
+#ifdef __linux__
+			fd = ::inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+			if (fd < 0)
+				g_warning("unable to watch the project's files: %s", g_strerror(errno));
+#endif
+		}
+
+		~Inotify()
+		{
+			if (fd >= 0)
+				::close(fd);
+		}
+	};
+
+	// a walk of a directory tree, shared with the workers and cut
+	// loose from its ProjectIndex when it's cancelled
+	struct ProjectIndex::Scan
+	{
+		ProjectIndex *owner;
+		std::atomic<bool> cancelled;
+		// a walk of the base path replaces files(), a walk of a new
+		// directory adds to it
+		bool full;
+		std::string base_path;
+		std::vector<PatternPtr> patterns;
+		std::shared_ptr<Inotify> inotify;
+
+		std::mutex mutex;
+		size_t pending;
+		std::vector<std::string> files;
+		std::vector<std::pair<int, Watch>> watches;
+
+		bool matches(const std::string &name) const
+		{
+			if (patterns.empty())
+				return true;
+			for (auto &pattern : patterns)
+			{
+				if (g_pattern_match_string(pattern.get(), name.c_str()))
+					return true;
+			}
+			return false;
+		}
+
+		static void submit(const std::shared_ptr<Scan> &scan, const std::string &dir,
+			const std::shared_ptr<const IgnoreList> &ignore)
+		{
+			{
+				std::lock_guard<std::mutex> lock(scan->mutex);
+				scan->pending++;
+			}
+			Worker::submit([scan, dir, ignore]() {
+				walk(scan, dir, ignore);
+			});
+		}
+
+		// lists one directory, queueing a job for each directory in it
+		static void walk(const std::shared_ptr<Scan> &scan, const std::string &dir,
+			std::shared_ptr<const IgnoreList> ignore)
+		{
+			std::vector<std::string> found;
+			std::vector<std::pair<int, Watch>> watched;
+			if (!scan->cancelled.load())
+			{
+				Tracer::Span span("ProjectIndex::walk", "worker");
+				scan->list(scan, dir, ignore, found, watched);
+			}
+
+			std::lock_guard<std::mutex> lock(scan->mutex);
+			if (scan->files.empty())
+				scan->files.swap(found);
+			else
+			{
+				scan->files.insert(scan->files.end(), std::make_move_iterator(found.begin()),
+					std::make_move_iterator(found.end()));
+			}
+			scan->watches.insert(scan->watches.end(), watched.begin(), watched.end());
+			if (--scan->pending > 0 || scan->cancelled.load())
+				return;
+			Worker::invoke_in_main([scan]() {
+				if (scan->owner)
+					scan->owner->scan_finished(*scan);
+			});
+		}
+
+		void list(const std::shared_ptr<Scan> &self, const std::string &dir,
+			std::shared_ptr<const IgnoreList> ignore, std::vector<std::string> &found,
+			std::vector<std::pair<int, Watch>> &watched)
+		{
+			std::string abs_dir = dir.empty() ? base_path : Glib::build_filename(base_path, dir);
+
+			// watched before it's read, so nothing created in between
+			// is missed
+			int wd = -1;
+#ifdef __linux__
+			if (inotify->fd >= 0)
+			{
+				wd = ::inotify_add_watch(inotify->fd, abs_dir.c_str(), WATCH_MASK);
+				if (wd < 0 && errno == ENOSPC)
+					g_warning("out of inotify watches, raise fs.inotify.max_user_watches");
+			}
+#endif
+
+			DIR *dp = ::opendir(abs_dir.c_str());
+			if (!dp)
+				return;
+			std::vector<std::string> dirs, files;
+			bool has_ignore_file = false;
+			while (struct dirent *ent = ::readdir(dp))
+			{
+				std::string name = ent->d_name;
+				if (name == "." || name == "..")
+					continue;
+				unsigned char type = ent->d_type;
+				if (type == DT_UNKNOWN || type == DT_LNK)
+				{
+					// symlinked files are listed, symlinked directories
+					// aren't followed since they may loop
+					std::string path = Glib::build_filename(abs_dir, name);
+					struct stat st;
+					if (::lstat(path.c_str(), &st) != 0)
+						continue;
+					if (S_ISLNK(st.st_mode) && (::stat(path.c_str(), &st) != 0 || S_ISDIR(st.st_mode)))
+						continue;
+					type = S_ISDIR(st.st_mode) ? DT_DIR : S_ISREG(st.st_mode) ? DT_REG : DT_UNKNOWN;
+				}
+				if (type == DT_DIR)
+					dirs.push_back(name);
+				else if (type == DT_REG)
+				{
+					has_ignore_file = has_ignore_file || is_ignore_file(name);
+					files.push_back(name);
+				}
+			}
+			::closedir(dp);
+
+			if (has_ignore_file)
+			{
+				std::shared_ptr<IgnoreList> list(new IgnoreList);
+				list->parent = ignore;
+				list->dir = dir;
+				for (auto name : { ".gitignore", ".ignore" })
+				{
+					gchar *contents = nullptr;
+					gsize length = 0;
+					std::string path = Glib::build_filename(abs_dir, name);
+					if (g_file_get_contents(path.c_str(), &contents, &length, nullptr))
+					{
+						list->parse(std::string(contents, length));
+						g_free(contents);
+					}
+				}
+				if (!list->rules.empty())
+					ignore = list;
+			}
+
+			if (wd >= 0)
+			{
+				Watch watch;
+				watch.dir = dir;
+				watch.ignore = ignore;
+				watched.emplace_back(wd, watch);
+			}
+
+			for (auto &name : dirs)
+			{
+				std::string path = child_path(dir, name);
+				if (is_vcs_dir(name) || (ignore && ignore->ignores(path, true)))
+					continue;
+				submit(self, path, ignore);
+			}
+			for (auto &name : files)
+			{
+				if (!matches(name))
+					continue;
+				std::string path = child_path(dir, name);
+				if (ignore && ignore->ignores(path, false))
+					continue;
+				found.push_back(std::move(path));
+			}
+		}
+	};
+
+	ProjectIndex::ProjectIndex(const std::string &base_path,
+		const std::vector<std::string> &patterns, const std::string &cache_filename)
+		: m_base_path(base_path),
+		  m_patterns(patterns),
+		  m_cache_filename(cache_filename),
+		  m_files(new PathTable),
+		  m_ready(false),
+		  m_dirty(false)
+	{
+		rescan();
+	}
+
+	ProjectIndex::~ProjectIndex()
+	{
+		for (auto &scan : m_scans)
+		{
+			scan->cancelled.store(true);
+			scan->owner = nullptr;
+		}
+		m_io_conn.disconnect();
+		m_rescan_conn.disconnect();
+		signal_changed_.clear();
+		if (m_flush_conn.connected())
+		{
+			m_flush_conn.disconnect();
+			flush();
+		}
+		save_cache();
+	}
+
+	std::string ProjectIndex::default_cache_filename(const std::string &project_filename)
+	{
+		char buf[17];
+		std::snprintf(buf, sizeof(buf), "%016llx", static_cast<unsigned long long>(
+			fnv1a(0xCBF29CE484222325ULL, project_filename)));
+		return Glib::build_filename(Geany::data->app->configdir,
+			"plugins", "geany++", "project-index", std::string(buf) + ".bin");
+	}
+
+	std::string ProjectIndex::absolute_path(size_t i) const
+	{
+		return Glib::build_filename(m_base_path, (*m_files)[i]);
+	}
+
+	void ProjectIndex::configure(const std::string &base_path,
+		const std::vector<std::string> &patterns)
+	{
+		if (base_path == m_base_path && patterns == m_patterns)
+			return;
+		m_base_path = base_path;
+		m_patterns = patterns;
+		m_files.reset(new PathTable);
+		m_ready = false;
+		m_dirty = false;
+		signal_changed_.emit();
+		rescan();
+	}
+
+	void ProjectIndex::rescan()
+	{
+		for (auto &scan : m_scans)
+		{
+			scan->cancelled.store(true);
+			scan->owner = nullptr;
+		}
+		m_scans.clear();
+		m_rescan_conn.disconnect();
+		m_flush_conn.disconnect();
+		m_io_conn.disconnect();
+		m_watches.clear();
+		m_queued.clear();
+		m_added.clear();
+		m_removed.clear();
+		// a fresh descriptor, so events for the old watches can't be
+		// mistaken for new ones
+		m_inotify.reset();
+
+		if (m_base_path.empty())
+		{
+			if (!m_files->empty() || !m_ready)
+			{
+				m_files.reset(new PathTable);
+				m_ready = true;
+				signal_changed_.emit();
+			}
+			return;
+		}
+
+		m_inotify = std::make_shared<Inotify>();
+		if (m_inotify->fd >= 0)
+		{
+			m_io_conn = Glib::signal_io().connect(
+				sigc::mem_fun(*this, &ProjectIndex::on_inotify),
+				m_inotify->fd, Glib::IO_IN);
+		}
+		start_scan(std::string(), nullptr);
+	}
+
+	void ProjectIndex::start_scan(const std::string &dir, std::shared_ptr<const IgnoreList> ignore)
+	{
+		std::shared_ptr<Scan> scan(new Scan);
+		scan->owner = this;
+		scan->cancelled.store(false);
+		scan->full = dir.empty();
+		scan->base_path = m_base_path;
+		for (auto &pattern : m_patterns)
+			scan->patterns.push_back(compile_pattern(pattern));
+		scan->inotify = m_inotify;
+		scan->pending = 0;
+		m_scans.push_back(scan);
+
+		// queued first, so the cached files show up long before a large
+		// tree is walked
+		if (scan->full && !m_ready && !m_cache_filename.empty())
+		{
+			std::string filename = m_cache_filename;
+			std::string patterns = join_patterns(m_patterns);
+			Worker::submit([scan, filename, patterns]() {
+				std::shared_ptr<const PathTable> files = read_cache(filename,
+					scan->base_path, patterns);
+				if (!files)
+					return;
+				Worker::invoke_in_main([scan, files]() {
+					if (scan->owner)
+						scan->owner->cache_loaded(files);
+				});
+			});
+		}
+
+		Scan::submit(scan, dir, ignore);
+	}
+
+	void ProjectIndex::cache_loaded(std::shared_ptr<const PathTable> files)
+	{
+		// the walk won the race
+		if (m_ready)
+			return;
+		m_files = files;
+		m_ready = true;
+		signal_changed_.emit();
+	}
+
+	void ProjectIndex::scan_finished(Scan &scan)
+	{
+		Tracer::Span span("ProjectIndex::scan_finished", "idle");
+		scan.owner = nullptr;
+		m_scans.erase(std::remove_if(m_scans.begin(), m_scans.end(),
+			[&scan](const std::shared_ptr<Scan> &ptr) {
+				return ptr.get() == &scan;
+			}), m_scans.end());
+		for (auto &watch : scan.watches)
+			m_watches[watch.first] = std::move(watch.second);
+
+		if (scan.full)
+		{
+			std::shared_ptr<const PathTable> files(new PathTable(std::move(scan.files)));
+			bool changed = (files->m_buffer != m_files->m_buffer);
+			if (changed || !m_ready)
+			{
+				m_files = files;
+				m_ready = true;
+				m_dirty = m_dirty || changed;
+				signal_changed_.emit();
+			}
+		}
+		else
+		{
+			for (auto &path : scan.files)
+				add_file(path);
+		}
+
+		if (m_scans.empty())
+		{
+			std::vector<Event> queued;
+			queued.swap(m_queued);
+			for (auto &event : queued)
+				handle_event(event);
+		}
+		if (scan.full)
+			save_cache();
+	}
+
+	bool ProjectIndex::on_inotify(Glib::IOCondition)
+	{
+#ifdef __linux__
+		alignas(struct inotify_event) char buf[16384];
+		while (true)
+		{
+			ssize_t len = ::read(m_inotify->fd, buf, sizeof(buf));
+			if (len <= 0)
+				break;
+			for (char *ptr = buf; ptr < buf + len; )
+			{
+				auto ev = reinterpret_cast<const struct inotify_event*>(ptr);
+				Event event;
+				event.wd = ev->wd;
+				event.mask = ev->mask;
+				if (ev->len > 0)
+					event.name = ev->name;
+				if (m_scans.empty())
+					handle_event(event);
+				else
+					m_queued.push_back(std::move(event));
+				ptr += sizeof(struct inotify_event) + ev->len;
+			}
+		}
+#endif
+		return true;
+	}
+
+	void ProjectIndex::handle_event(const Event &event)
+	{
+#ifdef __linux__
+		if (event.mask & IN_Q_OVERFLOW)
+		{
+			schedule_rescan();
+			return;
+		}
+		auto found = m_watches.find(event.wd);
+		if (found == m_watches.end())
+			return;
+		if (event.mask & IN_IGNORED)
+		{
+			m_watches.erase(found);
+			return;
+		}
+		if (event.name.empty())
+			return;
+		if (event.mask & IN_CLOSE_WRITE)
+		{
+			// the file was already listed when it was created
+			if (is_ignore_file(event.name))
+				schedule_rescan();
+			return;
+		}
+
+		const Watch &watch = found->second;
+		std::string path = child_path(watch.dir, event.name);
+		bool created = (event.mask & (IN_CREATE | IN_MOVED_TO)) != 0;
+		if (event.mask & IN_ISDIR)
+		{
+			if (!created)
+				remove_dir(path);
+			else if (!is_vcs_dir(event.name) && !(watch.ignore && watch.ignore->ignores(path, true)))
+				start_scan(path, watch.ignore);
+			return;
+		}
+
+		// which files are ignored below here may have changed
+		if (is_ignore_file(event.name))
+			schedule_rescan();
+		if (!created)
+			remove_file(path);
+		else if (matches_any(m_patterns, event.name) &&
+			!(watch.ignore && watch.ignore->ignores(path, false)))
+		{
+			add_file(path);
+		}
+#endif
+	}
+
+	void ProjectIndex::add_file(const std::string &path)
+	{
+		m_removed.erase(path);
+		if (!m_files->contains(path))
+			m_added.insert(path);
+		schedule_flush();
+	}
+
+	void ProjectIndex::remove_file(const std::string &path)
+	{
+		m_added.erase(path);
+		if (m_files->contains(path))
+			m_removed.insert(path);
+		schedule_flush();
+	}
+
+	void ProjectIndex::remove_dir(const std::string &dir)
+	{
+		std::string prefix = dir + '/';
+		auto range = m_files->prefix_range(prefix);
+		for (size_t i = range.first; i < range.second; i++)
+			m_removed.insert((*m_files)[i]);
+		auto added = m_added.lower_bound(prefix);
+		while (added != m_added.end() && starts_with(*added, prefix))
+			added = m_added.erase(added);
+
+#ifdef __linux__
+		// a directory moved elsewhere keeps its watches, which would
+		// report under the old path
+		for (auto it = m_watches.begin(); it != m_watches.end(); )
+		{
+			if (it->second.dir == dir || starts_with(it->second.dir, prefix))
+			{
+				::inotify_rm_watch(m_inotify->fd, it->first);
+				it = m_watches.erase(it);
+			}
+			else
+				++it;
+		}
+#endif
+		schedule_flush();
+	}
+
+	void ProjectIndex::schedule_flush()
+	{
+		if (!m_flush_conn.connected())
+		{
+			m_flush_conn = Glib::signal_timeout().connect(
+				sigc::mem_fun(*this, &ProjectIndex::flush), FLUSH_MSEC);
+		}
+	}
+
+	void ProjectIndex::schedule_rescan()
+	{
+		if (!m_rescan_conn.connected())
+		{
+			m_rescan_conn = Glib::signal_timeout().connect([this]() {
+				rescan();
+				return false;
+			}, RESCAN_MSEC);
+		}
+	}
+
+	// merges the collected changes into a new table
+	bool ProjectIndex::flush()
+	{
+		if (m_added.empty() && m_removed.empty())
+			return false;
+
+		Tracer::Span span("ProjectIndex::flush", "idle");
+		const PathTable &old = *m_files;
+		std::shared_ptr<PathTable> files(new PathTable);
+		files->m_buffer.reserve(old.m_buffer.size());
+		files->m_offsets.reserve(old.size() + m_added.size());
+		size_t i = 0;
+		auto added = m_added.begin();
+		while (i < old.size() || added != m_added.end())
+		{
+			int cmp = (added == m_added.end()) ? -1 : (i == old.size()) ? 1 :
+				-added->compare(old[i]);
+			if (cmp > 0)
+			{
+				files->append(added->c_str(), added->size());
+				++added;
+				continue;
+			}
+			// added again after the table was replaced
+			if (cmp == 0)
+				++added;
+			const char *path = old[i++];
+			if (m_removed.empty() || m_removed.find(path) == m_removed.end())
+				files->append(path, std::strlen(path));
+		}
+
+		m_added.clear();
+		m_removed.clear();
+		m_files = files;
+		m_dirty = true;
+		signal_changed_.emit();
+		return false;
+	}
+
+	void ProjectIndex::save_cache()
+	{
+		if (!m_dirty || !m_ready || m_cache_filename.empty())
+			return;
+		m_dirty = false;
+		std::string filename = m_cache_filename, base_path = m_base_path;
+		std::string patterns = join_patterns(m_patterns);
+		std::shared_ptr<const PathTable> files = m_files;
+		Worker::submit([filename, base_path, patterns, files]() {
+			write_cache(filename, base_path, patterns, *files);
+		});
+	}
+
+	// the header is the base path and the patterns the listing is for,
+	// each prefixed by its length, followed by the path count and the
+	// table's buffer
+	std::shared_ptr<PathTable> ProjectIndex::read_cache(const std::string &filename,
+		const std::string &base_path, const std::string &patterns)
+	{
+		std::string contents;
+		try
+		{
+			contents = Glib::file_get_contents(filename);
+		}
+		catch (Glib::FileError&)
+		{
+			return nullptr;
+		}
+
+		size_t pos = CACHE_MAGIC_LEN;
+		auto read_u32 = [&contents, &pos](uint32_t &value) {
+			if (contents.size() - pos < sizeof(value))
+				return false;
+			std::memcpy(&value, contents.data() + pos, sizeof(value));
+			pos += sizeof(value);
+			return true;
+		};
+		auto read_string = [&contents, &pos, &read_u32](const std::string &expected) {
+			uint32_t length;
+			if (!read_u32(length) || contents.size() - pos < length ||
+				contents.compare(pos, length, expected) != 0 || length != expected.size())
+			{
+				return false;
+			}
+			pos += length;
+			return true;
+		};
+
+		if (contents.size() < CACHE_MAGIC_LEN ||
+			std::memcmp(contents.data(), CACHE_MAGIC, CACHE_MAGIC_LEN) != 0)
+		{
+			if (!contents.empty())
+				g_warning("ignoring unknown project index cache '%s'", filename.c_str());
+			return nullptr;
+		}
+		// a cache for another directory or other patterns is just stale
+		uint32_t count, length;
+		if (!read_string(base_path) || !read_string(patterns) ||
+			!read_u32(count) || !read_u32(length) || contents.size() - pos != length ||
+			(length > 0 && contents.back() != '\0'))
+		{
+			return nullptr;
+		}
+
+		std::shared_ptr<PathTable> files(new PathTable);
+		files->m_buffer.assign(contents, pos, length);
+		files->m_offsets.reserve(count);
+		for (size_t offset = 0; offset < length; )
+		{
+			files->m_offsets.push_back(offset);
+			offset += std::strlen(files->m_buffer.data() + offset) + 1;
+		}
+		if (files->m_offsets.size() != count)
+			return nullptr;
+		return files;
+	}
+
+	void ProjectIndex::write_cache(const std::string &filename, const std::string &base_path,
+		const std::string &patterns, const PathTable &files)
+	{
+		Tracer::Span span("ProjectIndex::write_cache", "worker");
+		std::string dir = Glib::path_get_dirname(filename);
+		if (::g_mkdir_with_parents(dir.c_str(), 0755) != 0)
+		{
+			g_warning("unable to create '%s': %s", dir.c_str(), g_strerror(errno));
+			return;
+		}
+
+		std::string contents(CACHE_MAGIC, CACHE_MAGIC_LEN);
+		auto write_u32 = [&contents](uint32_t value) {
+			contents.append(reinterpret_cast<const char*>(&value), sizeof(value));
+		};
+		write_u32(base_path.size());
+		contents += base_path;
+		write_u32(patterns.size());
+		contents += patterns;
+		write_u32(files.size());
+		write_u32(files.m_buffer.size());
+		contents += files.m_buffer;
+
+		// written to a temporary file and renamed, so a crash can't
+		// leave half a cache
+		GError *error = nullptr;
+		if (!g_file_set_contents(filename.c_str(), contents.data(), contents.size(), &error))
+		{
+			g_warning("unable to write '%s': %s", filename.c_str(), error->message);
+			g_error_free(error);
+		}
+	}
+
+}
@@ -0,0 +1,245 @@
+#pragma once
+
+#include <geany++/common.hpp>
+#include <cstdint>
+#include <memory>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace Geany
+{
+
+	/**
+	 * A sorted list of file paths, relative to a project's base path.
+	 *
+	 * The paths are stored back to back in a single buffer, sorted byte
+	 * by byte, so large projects don't cost an allocation per file and
+	 * lookups are binary searches. A table never changes once built, so
+	 * it can be handed to background threads as it is.
+	 */
+	class PathTable
+	{
+	public:
+
+		PathTable()
+		{
+		}
+
+		/**
+		 * Build a table from @a paths, which needn't be sorted and may
+		 * contain duplicates.
+		 */
+		PathTable(std::vector<std::string> &&paths);
+
+		size_t size() const
+		{
+			return m_offsets.size();
+		}
+
+		bool empty() const
+		{
+			return m_offsets.empty();
+		}
+
+		/**
+		 * Get the @a i th path, like `src/main.c`.
+		 */
+		const char *operator[](size_t i) const
+		{
+			return m_buffer.data() + m_offsets[i];
+		}
+
+		/**
+		 * Get the index of the first path not sorting before @a path,
+		 * or size() if there isn't one.
+		 */
+		size_t lower_bound(const std::string &path) const;
+
+		bool contains(const std::string &path) const;
+
+		/**
+		 * Get the range of indices of the paths starting with
+		 * @a prefix, e.g. everything below `src/`.
+		 */
+		std::pair<size_t, size_t> prefix_range(const std::string &prefix) const;
+
+	private:
+		// NUL-terminated paths, in order
+		std::string m_buffer;
+		std::vector<uint32_t> m_offsets;
+		friend class ProjectIndex;
+
+		void append(const char *path, size_t length);
+	};
+
+	/**
+	 * The files of a project, shared by everything which needs them.
+	 *
+	 * The index is built when the project is opened by walking its base
+	 * path on background threads, one directory per job. Files must
+	 * match one of the project's file patterns, if it has any, and
+	 * aren't listed when a `.gitignore` or `.ignore` file on the way
+	 * excludes them. Version control directories are always skipped.
+	 *
+	 * On Linux the walk adds an inotify watch to every directory, so
+	 * files created, deleted or renamed afterwards are picked up
+	 * without walking again. Changes are batched and show up in files()
+	 * shortly after they happen, and saving an ignore file walks again
+	 * in the background. Elsewhere the index is only as recent as the
+	 * last rescan().
+	 *
+	 * The listing is written to a cache file when it changes, and read
+	 * back when the project is opened again. The cached files are
+	 * available straight away while the walk checks them.
+	 *
+	 * Use Project::file_index() to get the index of the open project.
+	 */
+	class ProjectIndex : public sigc::trackable
+	{
+	public:
+
+		/**
+		 * @param base_path The directory to index, nothing is indexed
+		 * if it's empty.
+		 * @param patterns Globs the names of the files must match, all
+		 * files are indexed if it's empty.
+		 * @param cache_filename Where the listing is kept between
+		 * sessions, empty for no cache.
+		 */
+		ProjectIndex(const std::string &base_path,
+			const std::vector<std::string> &patterns,
+			const std::string &cache_filename = std::string());
+		~ProjectIndex();
+
+		const std::string &base_path() const
+		{
+			return m_base_path;
+		}
+
+		const std::vector<std::string> &patterns() const
+		{
+			return m_patterns;
+		}
+
+		/**
+		 * Get the indexed files, an empty table until the cache was
+		 * read or the first walk finished.
+		 *
+		 * Hold on to the pointer rather than the index to use the
+		 * table from another thread.
+		 */
+		std::shared_ptr<const PathTable> files() const
+		{
+			return m_files;
+		}
+
+		/**
+		 * Whether files() is complete, even if it's from the cache
+		 * and is still being checked.
+		 */
+		bool is_ready() const
+		{
+			return m_ready;
+		}
+
+		/**
+		 * Whether the project's directories are being walked.
+		 */
+		bool is_scanning() const
+		{
+			return !m_scans.empty();
+		}
+
+		/**
+		 * Get the absolute filename of the @a i th path in files().
+		 */
+		std::string absolute_path(size_t i) const;
+
+		/**
+		 * Index a different directory or with different patterns,
+		 * walking again if either changed.
+		 */
+		void configure(const std::string &base_path,
+			const std::vector<std::string> &patterns);
+
+		/**
+		 * Walk the whole base path again, e.g. after ignore files
+		 * changed.
+		 */
+		void rescan();
+
+		/**
+		 * Signal emitted when files() changed.
+		 */
+		sigc::signal<void> &signal_changed() { return signal_changed_; }
+
+		/**
+		 * Get the cache filename for the project file @a project_filename.
+		 */
+		static std::string default_cache_filename(const std::string &project_filename);
+
+	private:
+		struct Scan;
+		struct IgnoreList;
+		struct Inotify;
+
+		struct Watch
+		{
+			// relative to the base path, empty for the base path itself
+			std::string dir;
+			std::shared_ptr<const IgnoreList> ignore;
+		};
+
+		struct Event
+		{
+			int wd;
+			uint32_t mask;
+			std::string name;
+		};
+
+		std::string m_base_path;
+		std::vector<std::string> m_patterns;
+		std::string m_cache_filename;
+		std::shared_ptr<const PathTable> m_files;
+		bool m_ready;
+		bool m_dirty;
+		std::vector<std::shared_ptr<Scan>> m_scans;
+		std::shared_ptr<Inotify> m_inotify;
+		std::unordered_map<int, Watch> m_watches;
+		// received while walking, applied once the walk's watches are
+		// known
+		std::vector<Event> m_queued;
+		// not in m_files yet
+		std::set<std::string> m_added;
+		std::set<std::string> m_removed;
+		sigc::connection m_io_conn;
+		sigc::connection m_flush_conn;
+		sigc::connection m_rescan_conn;
+		sigc::signal<void> signal_changed_;
+
+		ProjectIndex(const ProjectIndex&);
+		ProjectIndex &operator=(const ProjectIndex&);
+
+		void start_scan(const std::string &dir, std::shared_ptr<const IgnoreList> ignore);
+		void cache_loaded(std::shared_ptr<const PathTable> files);
+		void save_cache();
+		void scan_finished(Scan &scan);
+		bool on_inotify(Glib::IOCondition cond);
+		void handle_event(const Event &event);
+		void add_file(const std::string &path);
+		void remove_file(const std::string &path);
+		void remove_dir(const std::string &dir);
+		void schedule_flush();
+		void schedule_rescan();
+		bool flush();
+
+		static std::shared_ptr<PathTable> read_cache(const std::string &filename,
+			const std::string &base_path, const std::string &patterns);
+		static void write_cache(const std::string &filename, const std::string &base_path,
+			const std::string &patterns, const PathTable &files);
+	};
+
+}
@@ -0,0 +1,258 @@
+#pragma once
+
+#include <geany++/document.hpp>
+#include <geany++/filetype.hpp>
+#include <geany++/geany_p.hpp>
+#include <geany++/scintilla.hpp>
+#include <geany++/tracer_p.hpp>
+#include <geany++/worker_p.hpp>
+#include <atomic>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace Geany
+{
+
+	// What the completion and hover engines share: the providers plugins
+	// registered and asking them all at once on Worker threads, with the
+	// answers gathered on the thread of the last one to finish and
+	// handed back to the main thread.
+	namespace Providers
+	{
+
+		template< class Provider >
+		struct Entry
+		{
+			// cleared once removed, under call_mutex
+			Provider *provider;
+			PluginData *owner;
+			// held around calls to the provider so removing waits for
+			// them
+			std::mutex call_mutex;
+		};
+
+		// one question put to several providers; @a Result is what one
+		// provider answers
+		template< class Context, class Result >
+		struct Request
+		{
+			typedef Context ContextType;
+			typedef Result ResultType;
+
+			Context context;
+			unsigned int doc_id;
+			std::mutex mutex;
+			// one per provider asked, in registration order
+			std::vector<Result> results;
+			size_t pending;
+		};
+
+		// fills in what every provider context has, the text is a copy
+		// since providers read it on other threads
+		template< class Context >
+		void init_context(Context &ctx, Document &doc, Scintilla &sci, int position)
+		{
+			ctx.document = doc.handle();
+			ctx.revision = doc.revision();
+			Filetype *ft = doc.filetype();
+			ctx.filetype = ft ? ft->name() : std::string();
+
+			int length = sci.get_length();
+			std::shared_ptr<std::string> text(new std::string(length + 1, '\0'));
+			sci.send(SCI_GETTEXT, length + 1, reinterpret_cast<intptr_t>(&(*text)[0]));
+			text->resize(length);
+			ctx.text = text;
+
+			ctx.position = position;
+			ctx.cancelled = std::make_shared<std::atomic<bool>>(false);
+		}
+
+		// The providers of one kind and the request being answered.
+		// Everything but the entries' call_mutex is only used on the
+		// main thread.
+		//
+		// @a RequestT derives from Request, the hooks are plain
+		// functions of the engine: call() asks one provider, gather()
+		// combines the results on the worker thread of the last provider
+		// to answer and finish() gets the request on the main thread,
+		// unless it was cancelled meanwhile.
+		template< class Provider, class RequestT >
+		class Service
+		{
+		public:
+			typedef std::shared_ptr<Entry<Provider>> EntryPtr;
+			typedef std::shared_ptr<RequestT> RequestPtr;
+			typedef typename RequestT::ContextType Context;
+			typedef typename RequestT::ResultType Result;
+
+			typedef void (*CallFunc)(Provider &provider, const Context &ctx, Result &result);
+			typedef void (*GatherFunc)(RequestT &request);
+			typedef void (*FinishFunc)(const RequestPtr &request);
+
+			Service(const char *call_name, CallFunc call, GatherFunc gather,
+				FinishFunc finish)
+				: m_call_name(call_name),
+				  m_call(call),
+				  m_gather(gather),
+				  m_finish(finish)
+			{
+			}
+
+			bool active() const
+			{
+				return !m_entries.empty();
+			}
+
+			// returns whether it's the first provider
+			bool add(Provider *provider, PluginData *owner)
+			{
+				EntryPtr entry(new Entry<Provider>);
+				entry->provider = provider;
+				entry->owner = owner;
+				m_entries.push_back(entry);
+				return m_entries.size() == 1;
+			}
+
+			bool remove(Provider *provider)
+			{
+				for (size_t i = 0; i < m_entries.size(); i++)
+				{
+					if (m_entries[i]->provider == provider)
+					{
+						remove_at(i);
+						return true;
+					}
+				}
+				return false;
+			}
+
+			// removes all of @a owner's providers, returns whether there
+			// were any
+			bool remove_owner(PluginData *owner)
+			{
+				bool removed = false;
+				for (size_t i = m_entries.size(); i > 0; i--)
+				{
+					if (m_entries[i - 1]->owner == owner)
+					{
+						remove_at(i - 1);
+						removed = true;
+					}
+				}
+				return removed;
+			}
+
+			// the providers which want to be asked about @a doc
+			std::vector<EntryPtr> handling(Document &doc) const
+			{
+				std::vector<EntryPtr> asked;
+				for (auto &entry : m_entries)
+				{
+					if (entry->provider->handles(doc))
+						asked.push_back(entry);
+				}
+				return asked;
+			}
+
+			const RequestPtr &current() const
+			{
+				return m_current;
+			}
+
+			// forgets the current request without cancelling it, once
+			// it's answered
+			void clear_current()
+			{
+				m_current.reset();
+			}
+
+			void cancel()
+			{
+				if (m_current)
+				{
+					m_current->context.cancelled->store(true);
+					m_current.reset();
+				}
+			}
+
+			// makes @a request the current one and asks @a asked
+			void submit(const RequestPtr &request, const std::vector<EntryPtr> &asked)
+			{
+				request->results.resize(asked.size());
+				request->pending = asked.size();
+				m_current = request;
+				for (size_t i = 0; i < asked.size(); i++)
+				{
+					EntryPtr ref = asked[i];
+					Worker::submit([this, request, i, ref]() {
+						run(request, i, *ref);
+					});
+				}
+			}
+
+		private:
+			const char *m_call_name;
+			CallFunc m_call;
+			GatherFunc m_gather;
+			FinishFunc m_finish;
+			std::vector<EntryPtr> m_entries;
+			RequestPtr m_current;
+
+			Service(const Service&);
+			Service &operator=(const Service&);
+
+			void remove_at(size_t i)
+			{
+				EntryPtr entry = m_entries[i];
+				m_entries.erase(m_entries.begin() + i);
+				// so a call in progress may give up early
+				cancel();
+				std::lock_guard<std::mutex> lock(entry->call_mutex);
+				entry->provider = nullptr;
+			}
+
+			// on a Worker thread
+			void run(const RequestPtr &request, size_t index, Entry<Provider> &entry)
+			{
+				Result result;
+				{
+					std::lock_guard<std::mutex> lock(entry.call_mutex);
+					if (entry.provider && !request->context.is_cancelled())
+					{
+						Tracer::Span span(m_call_name, "plugin", request->doc_id,
+							entry.owner->trace_name);
+						try
+						{
+							m_call(*entry.provider, request->context, result);
+						}
+						catch (std::exception &exc)
+						{
+							g_critical("unhandled C++ exception caught in %s: %s",
+								m_call_name, exc.what());
+						}
+						catch (...)
+						{
+							g_critical("unhandled unknown C++ exception caught in %s",
+								m_call_name);
+						}
+					}
+				}
+
+				std::lock_guard<std::mutex> lock(request->mutex);
+				request->results[index] = std::move(result);
+				if (--request->pending > 0 || request->context.is_cancelled())
+					return;
+				m_gather(*request);
+				FinishFunc finish = m_finish;
+				Worker::invoke_in_main([finish, request]() {
+					finish(request);
+				});
+			}
+		};
+
+	}
+
+}
@@ -1,4 +1,10 @@
+#include <geany++/completion_p.hpp>
 #include <geany++/geany_p.hpp>
+#include <geany++/hover_p.hpp>
+#include <geany++/profiler_p.hpp>
+#include <geany++/scintillameta.hpp>
+#include <geany++/tracer_p.hpp>
+#include <geany++/worker_p.hpp>
 
 #ifdef HAVE_CONFIG_H
 #include <geany++/config.h>
@@ -20,6 +26,10 @@
 #define PROX_RELATED (PROXY_MATCHED|PROXY_NOLOAD)
 //#endif
 
+// how long each idle slice replaying already open documents to a newly
+// loaded plugin may run, in microseconds
+#define REPLAY_SLICE_USEC 5000
+
 
 // use these around C++ code which might throw an exception that would
 // otherwise go uncaught into plain C code.
@@ -41,15 +51,66 @@ namespace Geany
 	// Sub-plugin callbacks
 	//
 
+	// Hands documents which were open before the plugin was loaded to
+	// its document_open(), a slice at a time so that activating a
+	// plugin in a big session doesn't freeze the UI. Documents closed
+	// while waiting in the queue are skipped.
+	bool replay_documents(PluginData &data) noexcept
+	{
+		CXX_BLOCK_BEGIN
+		{
+			Tracer::Span span("replay_documents", "idle", 0, data.trace_name);
+			gint64 deadline = g_get_monotonic_time() + REPLAY_SLICE_USEC;
+			while (data.replay_pos < data.replay_queue.size())
+			{
+				auto doc = data.replay_queue[data.replay_pos++].get();
+				if (doc && doc->is_valid())
+				{
+					Tracer::Span hook_span("document_open", "plugin", doc->id(), data.trace_name);
+					data.plugin->document_open(*doc);
+				}
+				if (g_get_monotonic_time() >= deadline &&
+					data.replay_pos < data.replay_queue.size())
+				{
+					return true;
+				}
+			}
+			data.replay_queue.clear();
+			data.replay_pos = 0;
+		}
+		CXX_BLOCK_END
+		return false;
+	}
+
+	static void schedule_document_replay(PluginData &data)
+	{
+		auto &docs = data.proxy.documents.list();
+		if (docs.empty())
+			return;
+
+		data.replay_queue.clear();
+		data.replay_queue.reserve(docs.size());
+		for (auto doc : docs)
+			data.replay_queue.push_back(doc->handle());
+		data.replay_pos = 0;
+
+		PluginData *pdata = &data;
+		data.replay_conn = Glib::signal_idle().connect([pdata]() {
+			return replay_documents(*pdata);
+		}, Glib::PRIORITY_LOW);
+	}
+
 	static gboolean subplugin_init(GeanyPlugin *gplugin, gpointer pdata) noexcept
 	{
 		CXX_BLOCK_BEGIN
 		{
 			auto data = PluginData::from_data(pdata);
+			Tracer::Span span("init", "plugin", 0, data->trace_name);
 			data->init();
 			if (data->is_initialized())
 			{
 				data->proxy.plugins.add(gplugin, data->plugin.get());
+				schedule_document_replay(*data);
 				return TRUE;
 			}
 		}
@@ -62,6 +123,7 @@ namespace Geany
 		CXX_BLOCK_BEGIN
 		{
 			auto data = PluginData::from_data(pdata);
+			Tracer::Span span("cleanup", "plugin", 0, data->trace_name);
 			data->cleanup();
 		}
 		CXX_BLOCK_END
@@ -85,6 +147,7 @@ namespace Geany
 			if (auto dialog = dynamic_cast<Gtk::Dialog*>(Glib::wrap(gdialog, true)))
 			{
 				auto data = PluginData::from_data(pdata);
+				Tracer::Span span("configure", "plugin", 0, data->trace_name);
 				if (auto widget = data->plugin->configure(dialog))
 				{
 					prefs_panel = GTK_WIDGET(g_object_ref(widget->gobj()));
@@ -167,8 +230,13 @@ namespace Geany
 		CXX_BLOCK_BEGIN
 		{
 			g_return_if_fail(doc && doc->is_valid());
+			Completion::document_open(*doc);
+			Hover::document_open(*doc);
 			for (auto plugin : proxy->plugins.list_plugins())
+			{
+				Tracer::Span span("document_open", "plugin", doc->id(), plugin->priv.trace_name);
 				plugin->document_open(*doc);
+			}
 		}
 		CXX_BLOCK_END
 	}
@@ -177,7 +245,11 @@ namespace Geany
 	{
 		CXX_BLOCK_BEGIN
 		{
-			if (auto document = ProxyPlugin::from_data(pdata)->documents.lookup(doc))
+			Tracer::Span span("document-activate", "proxy", doc->id);
+			auto proxy = ProxyPlugin::from_data(pdata);
+			if (proxy->recorder)
+				proxy->recorder->document(Session::DOCUMENT_ACTIVATE, doc);
+			if (auto document = proxy->documents.lookup(doc))
 				document->signal_activate().emit();
 		}
 		CXX_BLOCK_END
@@ -187,7 +259,11 @@ namespace Geany
 	{
 		CXX_BLOCK_BEGIN
 		{
-			if (auto document = ProxyPlugin::from_data(pdata)->documents.lookup(doc))
+			Tracer::Span span("document-before-save", "proxy", doc->id);
+			auto proxy = ProxyPlugin::from_data(pdata);
+			if (proxy->recorder)
+				proxy->recorder->document(Session::DOCUMENT_BEFORE_SAVE, doc);
+			if (auto document = proxy->documents.lookup(doc))
 				document->signal_before_save().emit();
 		}
 		CXX_BLOCK_END
@@ -197,7 +273,10 @@ namespace Geany
 	{
 		CXX_BLOCK_BEGIN
 		{
+			Tracer::Span span("document-close", "proxy", doc->id);
 			auto proxy = ProxyPlugin::from_data(pdata);
+			if (proxy->recorder)
+				proxy->recorder->document(Session::DOCUMENT_CLOSE, doc);
 			if (auto document = proxy->documents.lookup(doc))
 				document->signal_close().emit();
 			proxy->documents.remove(doc);
@@ -210,7 +289,10 @@ namespace Geany
 	{
 		CXX_BLOCK_BEGIN
 		{
+			Tracer::Span span("document-filetype-set", "proxy", doc->id);
 			auto proxy = ProxyPlugin::from_data(pdata);
+			if (proxy->recorder)
+				proxy->recorder->document(Session::DOCUMENT_FILETYPE_SET, doc);
 			// filetype-set may be emitted before new/open
 			if (auto document = proxy->documents.add(doc))
 			{
@@ -225,7 +307,10 @@ namespace Geany
 	{
 		CXX_BLOCK_BEGIN
 		{
+			Tracer::Span span("document-new", "proxy", doc->id);
 			auto proxy = ProxyPlugin::from_data(pdata);
+			if (proxy->recorder)
+				proxy->recorder->document(Session::DOCUMENT_NEW, doc);
 			auto document = proxy->documents.add(doc);
 			emit_document_open(proxy, document);
 		}
@@ -236,7 +321,10 @@ namespace Geany
 	{
 		CXX_BLOCK_BEGIN
 		{
+			Tracer::Span span("document-open", "proxy", doc->id);
 			auto proxy = ProxyPlugin::from_data(pdata);
+			if (proxy->recorder)
+				proxy->recorder->document(Session::DOCUMENT_OPEN, doc);
 			auto document = proxy->documents.add(doc);
 			emit_document_open(proxy, document);
 		}
@@ -247,7 +335,11 @@ namespace Geany
 	{
 		CXX_BLOCK_BEGIN
 		{
-			if (auto document = ProxyPlugin::from_data(pdata)->documents.lookup(doc))
+			Tracer::Span span("document-reload", "proxy", doc->id);
+			auto proxy = ProxyPlugin::from_data(pdata);
+			if (proxy->recorder)
+				proxy->recorder->document(Session::DOCUMENT_RELOAD, doc);
+			if (auto document = proxy->documents.lookup(doc))
 				document->signal_reload().emit();
 		}
 		CXX_BLOCK_END
@@ -257,57 +349,130 @@ namespace Geany
 	{
 		CXX_BLOCK_BEGIN
 		{
-			if (auto document = ProxyPlugin::from_data(pdata)->documents.lookup(doc))
+			Tracer::Span span("document-save", "proxy", doc->id);
+			auto proxy = ProxyPlugin::from_data(pdata);
+			if (proxy->recorder)
+				proxy->recorder->document(Session::DOCUMENT_SAVE, doc);
+			if (auto document = proxy->documents.lookup(doc))
 				document->signal_save().emit();
 		}
 		CXX_BLOCK_END
 	}
 
-	static gboolean on_editor_notify(GObject*, GeanyEditor *editor,
+	static gboolean emit_notification(Scintilla *sci, const SCNotification &nt)
+	{
+		switch (nt.nmhdr.code)
+		{
+			case SCN_STYLENEEDED: return sci->signal_style_needed().emit(nt);
+			case SCN_CHARADDED: return sci->signal_char_added().emit(nt);
+			case SCN_SAVEPOINTREACHED: return sci->signal_save_point_reached().emit(nt);
+			case SCN_SAVEPOINTLEFT: return sci->signal_save_point_left().emit(nt);
+			case SCN_MODIFYATTEMPTRO: return sci->signal_modify_attempt_ro().emit(nt);
+			case SCN_KEY: return sci->signal_key().emit(nt);
+			case SCN_DOUBLECLICK: return sci->signal_double_click().emit(nt);
+			case SCN_UPDATEUI: return sci->signal_update_ui().emit(nt);
+			case SCN_MODIFIED: return sci->signal_modified().emit(nt);
+			case SCN_MACRORECORD: return sci->signal_macro_record().emit(nt);
+			case SCN_MARGINCLICK: return sci->signal_margin_click().emit(nt);
+			case SCN_NEEDSHOWN: return sci->signal_need_shown().emit(nt);
+			case SCN_PAINTED: return sci->signal_painted().emit(nt);
+			case SCN_USERLISTSELECTION: return sci->signal_user_list_selection().emit(nt);
+			case SCN_URIDROPPED: return sci->signal_uri_dropped().emit(nt);
+			case SCN_DWELLSTART: return sci->signal_dwell_start().emit(nt);
+			case SCN_DWELLEND: return sci->signal_dwell_end().emit(nt);
+			case SCN_ZOOM: return sci->signal_zoom().emit(nt);
+			case SCN_HOTSPOTCLICK: return sci->signal_hot_spot_click().emit(nt);
+			case SCN_HOTSPOTDOUBLECLICK: return sci->signal_hot_spot_double_click().emit(nt);
+			case SCN_HOTSPOTRELEASECLICK: return sci->signal_hot_spot_release_click().emit(nt);
+			case SCN_INDICATORCLICK: return sci->signal_indicator_click().emit(nt);
+			case SCN_INDICATORRELEASE: return sci->signal_indicator_release().emit(nt);
+			case SCN_CALLTIPCLICK: return sci->signal_call_tip_click().emit(nt);
+			case SCN_AUTOCSELECTION: return sci->signal_auto_c_selection().emit(nt);
+			case SCN_AUTOCCANCELLED: return sci->signal_auto_c_cancelled().emit(nt);
+			case SCN_AUTOCCHARDELETED: return sci->signal_auto_c_char_deleted().emit(nt);
+			case SCN_FOCUSIN: return sci->signal_focus_in().emit(nt);
+			case SCN_FOCUSOUT: return sci->signal_focus_out().emit(nt);
+			case SCN_AUTOCCOMPLETED: return sci->signal_auto_c_completed().emit(nt);
+			default:
+				g_warning("unrecognized Scintilla notification '%d'", nt.nmhdr.code);
+				break;
+		}
+		return FALSE;
+	}
+
+	// plugins' handlers come first, completion and hover requests are
+	// answered later anyway
+	static gboolean emit_notification(Document &doc, Scintilla *sci,
+		const SCNotification &nt)
+	{
+		gboolean handled = emit_notification(sci, nt);
+		if (Completion::active())
+			Completion::notify(doc, *sci, nt);
+		if (Hover::active())
+			Hover::notify(doc, *sci, nt);
+		return handled;
+	}
+
+	gboolean on_editor_notify(GObject*, GeanyEditor *editor,
 		SCNotification *nt, gpointer pdata) noexcept
 	{
 		g_return_val_if_fail(nt, FALSE);
 		CXX_BLOCK_BEGIN
 		{
-			Scintilla *sci = Scintilla::from_widget(editor->sci);
-			if (!sci)
-				return FALSE;
+			Tracer::Span span(SciMeta::notification_name(nt->nmhdr.code), "editor-notify",
+				editor->document->id);
+			auto proxy = ProxyPlugin::from_data(pdata);
+			if (proxy->recorder)
+				proxy->recorder->notify(editor, *nt);
+
+			Document *document = nullptr;
 			switch (nt->nmhdr.code)
 			{
-				case SCN_STYLENEEDED: return sci->signal_style_needed().emit(*nt);
-				case SCN_CHARADDED: return sci->signal_char_added().emit(*nt);
-				case SCN_SAVEPOINTREACHED: return sci->signal_save_point_reached().emit(*nt);
-				case SCN_SAVEPOINTLEFT: return sci->signal_save_point_left().emit(*nt);
-				case SCN_MODIFYATTEMPTRO: return sci->signal_modify_attempt_ro().emit(*nt);
-				case SCN_KEY: return sci->signal_key().emit(*nt);
-				case SCN_DOUBLECLICK: return sci->signal_double_click().emit(*nt);
-				case SCN_UPDATEUI: return sci->signal_update_ui().emit(*nt);
-				case SCN_MODIFIED: return sci->signal_modified().emit(*nt);
-				case SCN_MACRORECORD: return sci->signal_macro_record().emit(*nt);
-				case SCN_MARGINCLICK: return sci->signal_margin_click().emit(*nt);
-				case SCN_NEEDSHOWN: return sci->signal_need_shown().emit(*nt);
-				case SCN_PAINTED: return sci->signal_painted().emit(*nt);
-				case SCN_USERLISTSELECTION: return sci->signal_user_list_selection().emit(*nt);
-				case SCN_URIDROPPED: return sci->signal_uri_dropped().emit(*nt);
-				case SCN_DWELLSTART: return sci->signal_dwell_start().emit(*nt);
-				case SCN_DWELLEND: return sci->signal_dwell_end().emit(*nt);
-				case SCN_ZOOM: return sci->signal_zoom().emit(*nt);
-				case SCN_HOTSPOTCLICK: return sci->signal_hot_spot_click().emit(*nt);
-				case SCN_HOTSPOTDOUBLECLICK: return sci->signal_hot_spot_double_click().emit(*nt);
-				case SCN_HOTSPOTRELEASECLICK: return sci->signal_hot_spot_release_click().emit(*nt);
-				case SCN_INDICATORCLICK: return sci->signal_indicator_click().emit(*nt);
-				case SCN_INDICATORRELEASE: return sci->signal_indicator_release().emit(*nt);
-				case SCN_CALLTIPCLICK: return sci->signal_call_tip_click().emit(*nt);
-				case SCN_AUTOCSELECTION: return sci->signal_auto_c_selection().emit(*nt);
-				case SCN_AUTOCCANCELLED: return sci->signal_auto_c_cancelled().emit(*nt);
-				case SCN_AUTOCCHARDELETED: return sci->signal_auto_c_char_deleted().emit(*nt);
-				case SCN_FOCUSIN: return sci->signal_focus_in().emit(*nt);
-				case SCN_FOCUSOUT: return sci->signal_focus_out().emit(*nt);
-				case SCN_AUTOCCOMPLETED: return sci->signal_auto_c_completed().emit(*nt);
-				default:
-					g_warning("unrecognized Scintilla notification '%d'", nt->nmhdr.code);
+				case SCN_KEY:
+				case SCN_CHARADDED:
+				case SCN_MODIFIED:
+				case SCN_PAINTED:
+					document = proxy->documents.lookup(editor->document);
+					break;
+				case SCN_AUTOCCHARDELETED:
+				case SCN_AUTOCSELECTION:
+				case SCN_AUTOCCANCELLED:
+				case SCN_USERLISTSELECTION:
+					if (Completion::active())
+						document = proxy->documents.lookup(editor->document);
 					break;
+				case SCN_DWELLSTART:
+				case SCN_DWELLEND:
+					if (Hover::active())
+						document = proxy->documents.lookup(editor->document);
+					break;
+			}
+
+			if (document && nt->nmhdr.code == SCN_MODIFIED &&
+				(nt->modificationType & (SC_MOD_INSERTTEXT | SC_MOD_DELETETEXT)))
+			{
+				document->m_revision++;
 			}
+
+			// only editors something wrapped have handlers
+			Scintilla *sci = Scintilla::from_widget(editor->sci);
+			if (!document)
+				return sci ? emit_notification(sci, *nt) : FALSE;
+
+			// typing is measured whether or not the editor is wrapped
+			TypingStats &typing = document->m_typing;
+			gint64 start = g_get_monotonic_time();
+			if (nt->nmhdr.code == SCN_PAINTED)
+			{
+				// handlers of the paint itself come after what's measured
+				typing.painted(editor->document, start);
+				return sci ? emit_notification(sci, *nt) : FALSE;
+			}
+			bool measured = typing.input(nt->nmhdr.code, nt->modificationType, start);
+			gboolean handled = sci ? emit_notification(*document, sci, *nt) : FALSE;
+			if (measured)
+				typing.handled(start, g_get_monotonic_time());
+			return handled;
 		}
 		CXX_BLOCK_END
 		return FALSE;
@@ -317,13 +482,19 @@ namespace Geany
 	{
 		CXX_BLOCK_BEGIN
 		{
+			Tracer::Span span("project-open", "proxy");
 			GeanyProject *gproj = Geany::data->app->project;
 			g_return_if_fail(gproj);
 			auto proxy = ProxyPlugin::from_data(pdata);
+			if (proxy->recorder)
+				proxy->recorder->project_open(gproj);
 			auto proj = proxy->new_project(gproj);
 			Glib::KeyFile keyfile(kf);
 			for (auto plugin : proxy->plugins.list_plugins())
+			{
+				Tracer::Span hook_span("project_open", "plugin", 0, plugin->priv.trace_name);
 				plugin->project_open(*proj, keyfile);
+			}
 		}
 		CXX_BLOCK_END
 	}
@@ -332,11 +503,17 @@ namespace Geany
 	{
 		CXX_BLOCK_BEGIN
 		{
+			Tracer::Span span("project-close", "proxy");
 			auto proxy = ProxyPlugin::from_data(pdata);
+			if (proxy->recorder)
+				proxy->recorder->project_close();
 			if (proxy->project)
 				proxy->project->signal_close().emit();
 			for (auto plugin : proxy->plugins.list_plugins())
+			{
+				Tracer::Span hook_span("project_close", "plugin", 0, plugin->priv.trace_name);
 				plugin->project_close();
+			}
 			proxy->project = nullptr;
 		}
 		CXX_BLOCK_END
@@ -346,6 +523,7 @@ namespace Geany
 	{
 		CXX_BLOCK_BEGIN
 		{
+			Tracer::Span span("project-dialog-open", "proxy");
 			auto proxy = ProxyPlugin::from_data(pdata);
 			g_return_if_fail(proxy->project);
 			Gtk::Notebook *nb = Glib::wrap(GTK_NOTEBOOK(notebook));
@@ -358,6 +536,7 @@ namespace Geany
 	{
 		CXX_BLOCK_BEGIN
 		{
+			Tracer::Span span("project-dialog-confirmed", "proxy");
 			auto proxy = ProxyPlugin::from_data(pdata);
 			g_return_if_fail(proxy->project);
 			Gtk::Notebook *nb = Glib::wrap(GTK_NOTEBOOK(notebook));
@@ -370,6 +549,7 @@ namespace Geany
 	{
 		CXX_BLOCK_BEGIN
 		{
+			Tracer::Span span("project-dialog-close", "proxy");
 			auto proxy = ProxyPlugin::from_data(pdata);
 			g_return_if_fail(proxy->project);
 			Gtk::Notebook *nb = Glib::wrap(GTK_NOTEBOOK(notebook));
@@ -385,15 +565,47 @@ namespace Geany
 			Geany::data = plugin->geany_data;
 			Geany::ui = new UI(data->main_widgets);
 
+			// GEANYCPP_TRACE=<file> writes a trace of what the framework
+			// and plugins do to <file> when the proxy is unloaded
+			if (const char *trace_fn = g_getenv("GEANYCPP_TRACE"))
+				Tracer::start(trace_fn);
+
+			// GEANYCPP_SCI_PROFILE=<file> writes the Scintilla messages each
+			// plugin sent and how long they took to <file> when unloaded
+			if (const char *profile_fn = g_getenv("GEANYCPP_SCI_PROFILE"))
+				Profiler::start(profile_fn);
+
+			// GEANYCPP_TYPING_LATENCY=1 shows typing latency in the statusbar
+			if (const char *latency = g_getenv("GEANYCPP_TYPING_LATENCY"))
+				TypingStats::set_statusbar_readout(std::atoi(latency) != 0);
+
 			auto proxy = new ProxyPlugin();
 			geany_plugin_set_data(plugin, proxy, nullptr);
 			Geany::g_proxy = proxy;
 
-			// todo: go through and add initial docs to docman
+			proxy->documents.adopt_all();
 
 			if (Geany::data->app->project)
 				proxy->new_project(Geany::data->app->project);
 
+			// GEANYCPP_RECORD=<file> records the session for replaying
+			// against plugins later, starting with what's already open
+			if (const char *record_fn = g_getenv("GEANYCPP_RECORD"))
+			{
+				try
+				{
+					proxy->recorder.reset(new Session::Recorder(record_fn));
+					if (Geany::data->app->project)
+						proxy->recorder->project_open(Geany::data->app->project);
+					for (auto document : proxy->documents.list())
+						proxy->recorder->document(Session::DOCUMENT_OPEN, document->get());
+				}
+				catch (std::runtime_error &exc)
+				{
+					g_warning("%s", exc.what());
+				}
+			}
+
 #define PSC(sig_name, cb) \
 	plugin_signal_connect(plugin, NULL, sig_name, TRUE, G_CALLBACK(cb), proxy)
 
@@ -432,6 +644,11 @@ namespace Geany
 
 	void proxy_cleanup(GeanyPlugin*, gpointer pdata) noexcept
 	{
+		// before the workers stop, it may queue writing its cache
+		static_cast<ProxyPlugin*>(pdata)->project.reset();
+		Worker::shutdown();
+		Tracer::stop();
+		Profiler::stop();
 		delete static_cast<ProxyPlugin*>(pdata);
 		delete Geany::ui;
 		Geany::ui = nullptr;
@@ -0,0 +1,366 @@
+#include <geany++/session_p.hpp>
+
+#ifdef HAVE_CONFIG_H
+#include <geany++/config.h>
+#endif
+
+#include <cerrno>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+
+#define SESSION_MAGIC      "GEANY++SESSION\x01"
+#define SESSION_MAGIC_LEN  (sizeof(SESSION_MAGIC) - 1)
+
+// bytes buffered before writing to the file
+#define FLUSH_THRESHOLD    (64 * 1024)
+
+// bit in a notification's field mask for each field that's non-zero,
+// fields that are zero aren't written
+enum
+{
+	NT_POSITION          = 1 << 0,
+	NT_CH                = 1 << 1,
+	NT_MODIFIERS         = 1 << 2,
+	NT_MODIFICATION_TYPE = 1 << 3,
+	NT_LENGTH            = 1 << 4,
+	NT_LINES_ADDED       = 1 << 5,
+	NT_LINE              = 1 << 6,
+	NT_MARGIN            = 1 << 7,
+	NT_LIST_TYPE         = 1 << 8,
+	NT_X                 = 1 << 9,
+	NT_Y                 = 1 << 10,
+	NT_UPDATED           = 1 << 11,
+	NT_CARET             = 1 << 12,
+	NT_TEXT              = 1 << 13,
+};
+
+namespace Geany
+{
+
+	namespace Session
+	{
+
+		static std::string document_text(GeanyDocument *doc)
+		{
+			ScintillaObject *sci = doc->editor->sci;
+			size_t len = scintilla_send_message(sci, SCI_GETLENGTH, 0, 0);
+			std::string text(len + 1, '\0');
+			scintilla_send_message(sci, SCI_GETTEXT, len + 1,
+				reinterpret_cast<sptr_t>(&text[0]));
+			text.resize(len);
+			return text;
+		}
+
+		// the text a notification carries, if any
+		static bool notification_text(const SCNotification &nt,
+			const char *&text, size_t &len)
+		{
+			if (!nt.text)
+				return false;
+			switch (nt.nmhdr.code)
+			{
+				case SCN_MODIFIED:
+					if (!(nt.modificationType & (SC_MOD_INSERTTEXT | SC_MOD_DELETETEXT)))
+						return false;
+					text = nt.text;
+					len = nt.length;
+					return true;
+				case SCN_USERLISTSELECTION:
+				case SCN_AUTOCSELECTION:
+				case SCN_AUTOCCOMPLETED:
+				case SCN_URIDROPPED:
+					text = nt.text;
+					len = std::strlen(nt.text);
+					return true;
+				default:
+					return false;
+			}
+		}
+
+		//
+		// Recorder
+		//
+
+		Recorder::Recorder(const std::string &filename)
+			: m_file(std::fopen(filename.c_str(), "wb")),
+			  m_start(g_get_monotonic_time()),
+			  m_last(m_start),
+			  m_records(0)
+		{
+			if (!m_file)
+			{
+				throw std::runtime_error("unable to create session recording '" +
+					filename + "': " + std::strerror(errno));
+			}
+			m_buf.reserve(FLUSH_THRESHOLD * 2);
+			m_buf.append(SESSION_MAGIC, SESSION_MAGIC_LEN);
+		}
+
+		Recorder::~Recorder()
+		{
+			flush();
+			std::fclose(m_file);
+		}
+
+		void Recorder::flush()
+		{
+			if (!m_buf.empty() &&
+				std::fwrite(m_buf.data(), 1, m_buf.size(), m_file) != m_buf.size())
+			{
+				g_warning("failed writing session recording: %s", std::strerror(errno));
+			}
+			m_buf.clear();
+		}
+
+		void Recorder::put_uint(uint64_t value)
+		{
+			while (value >= 0x80)
+			{
+				m_buf += static_cast<char>((value & 0x7f) | 0x80);
+				value >>= 7;
+			}
+			m_buf += static_cast<char>(value);
+		}
+
+		void Recorder::put_int(int64_t value)
+		{
+			put_uint((static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63));
+		}
+
+		void Recorder::put_string(const char *str, size_t len)
+		{
+			put_uint(len);
+			m_buf.append(str, len);
+		}
+
+		void Recorder::put_string(const char *str)
+		{
+			put_string(str ? str : "", str ? std::strlen(str) : 0);
+		}
+
+		void Recorder::begin(Event event, unsigned int doc_id)
+		{
+			gint64 now = g_get_monotonic_time();
+			m_buf += static_cast<char>(event);
+			put_uint(now - m_last);
+			put_uint(doc_id);
+			m_last = now;
+		}
+
+		void Recorder::end()
+		{
+			m_records++;
+			if (m_buf.size() >= FLUSH_THRESHOLD)
+				flush();
+		}
+
+		void Recorder::document(Event event, GeanyDocument *doc)
+		{
+			begin(event, doc->id);
+			switch (event)
+			{
+				case DOCUMENT_NEW:
+				case DOCUMENT_OPEN:
+				case DOCUMENT_RELOAD:
+				{
+					put_string(doc->file_name);
+					put_string(doc->file_type ? doc->file_type->name : nullptr);
+					std::string text = document_text(doc);
+					put_string(text.data(), text.size());
+					break;
+				}
+				case DOCUMENT_FILETYPE_SET:
+					put_string(doc->file_type ? doc->file_type->name : nullptr);
+					break;
+				default:
+					break;
+			}
+			end();
+		}
+
+		void Recorder::notify(GeanyEditor *editor, const SCNotification &nt)
+		{
+			sptr_t caret = scintilla_send_message(editor->sci, SCI_GETCURRENTPOS, 0, 0);
+			const char *text = nullptr;
+			size_t text_len = 0;
+
+			unsigned int mask = 0;
+			if (nt.position) mask |= NT_POSITION;
+			if (nt.ch) mask |= NT_CH;
+			if (nt.modifiers) mask |= NT_MODIFIERS;
+			if (nt.modificationType) mask |= NT_MODIFICATION_TYPE;
+			if (nt.length) mask |= NT_LENGTH;
+			if (nt.linesAdded) mask |= NT_LINES_ADDED;
+			if (nt.line) mask |= NT_LINE;
+			if (nt.margin) mask |= NT_MARGIN;
+			if (nt.listType) mask |= NT_LIST_TYPE;
+			if (nt.x) mask |= NT_X;
+			if (nt.y) mask |= NT_Y;
+			if (nt.updated) mask |= NT_UPDATED;
+			if (caret) mask |= NT_CARET;
+			if (notification_text(nt, text, text_len)) mask |= NT_TEXT;
+
+			begin(EDITOR_NOTIFY, editor->document->id);
+			put_uint(nt.nmhdr.code);
+			put_uint(mask);
+			if (mask & NT_POSITION) put_int(nt.position);
+			if (mask & NT_CH) put_int(nt.ch);
+			if (mask & NT_MODIFIERS) put_int(nt.modifiers);
+			if (mask & NT_MODIFICATION_TYPE) put_int(nt.modificationType);
+			if (mask & NT_LENGTH) put_int(nt.length);
+			if (mask & NT_LINES_ADDED) put_int(nt.linesAdded);
+			if (mask & NT_LINE) put_int(nt.line);
+			if (mask & NT_MARGIN) put_int(nt.margin);
+			if (mask & NT_LIST_TYPE) put_int(nt.listType);
+			if (mask & NT_X) put_int(nt.x);
+			if (mask & NT_Y) put_int(nt.y);
+			if (mask & NT_UPDATED) put_int(nt.updated);
+			if (mask & NT_CARET) put_int(caret);
+			if (mask & NT_TEXT) put_string(text, text_len);
+			end();
+		}
+
+		void Recorder::project_open(GeanyProject *project)
+		{
+			begin(PROJECT_OPEN, 0);
+			put_string(project->name);
+			put_string(project->base_path);
+			end();
+		}
+
+		void Recorder::project_close()
+		{
+			begin(PROJECT_CLOSE, 0);
+			end();
+		}
+
+		//
+		// Loading
+		//
+
+		namespace
+		{
+			struct Parser
+			{
+				const char *pos;
+				const char *end;
+
+				uint64_t get_uint()
+				{
+					uint64_t value = 0;
+					for (unsigned int shift = 0; shift < 64; shift += 7)
+					{
+						if (pos >= end)
+							throw std::runtime_error("truncated session recording");
+						unsigned char byte = *pos++;
+						value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+						if (!(byte & 0x80))
+							return value;
+					}
+					throw std::runtime_error("malformed number in session recording");
+				}
+
+				int64_t get_int()
+				{
+					uint64_t value = get_uint();
+					return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+				}
+
+				std::string get_string()
+				{
+					uint64_t len = get_uint();
+					if (len > static_cast<uint64_t>(end - pos))
+						throw std::runtime_error("truncated session recording");
+					std::string str(pos, len);
+					pos += len;
+					return str;
+				}
+			};
+		}
+
+		std::vector<Record> load(const std::string &filename)
+		{
+			gchar *contents = nullptr;
+			gsize size = 0;
+			GError *err = nullptr;
+			if (!g_file_get_contents(filename.c_str(), &contents, &size, &err))
+			{
+				std::string msg = err->message;
+				g_error_free(err);
+				throw std::runtime_error(msg);
+			}
+			std::unique_ptr<gchar, decltype(&g_free)> guard(contents, &g_free);
+
+			if (size < SESSION_MAGIC_LEN ||
+				std::memcmp(contents, SESSION_MAGIC, SESSION_MAGIC_LEN) != 0)
+			{
+				throw std::runtime_error("'" + filename + "' isn't a session recording");
+			}
+
+			std::vector<Record> records;
+			Parser p{ contents + SESSION_MAGIC_LEN, contents + size };
+			uint64_t time = 0;
+			while (p.pos < p.end)
+			{
+				Record rec;
+				rec.event = static_cast<Event>(*p.pos++);
+				time += p.get_uint();
+				rec.time = time;
+				rec.doc_id = p.get_uint();
+				std::memset(&rec.nt, 0, sizeof(rec.nt));
+
+				switch (rec.event)
+				{
+					case DOCUMENT_NEW:
+					case DOCUMENT_OPEN:
+					case DOCUMENT_RELOAD:
+						rec.name = p.get_string();
+						rec.filetype = p.get_string();
+						rec.text = p.get_string();
+						break;
+					case DOCUMENT_FILETYPE_SET:
+						rec.filetype = p.get_string();
+						break;
+					case DOCUMENT_CLOSE:
+					case DOCUMENT_ACTIVATE:
+					case DOCUMENT_BEFORE_SAVE:
+					case DOCUMENT_SAVE:
+					case PROJECT_CLOSE:
+						break;
+					case PROJECT_OPEN:
+						rec.name = p.get_string();
+						rec.filetype = p.get_string();
+						break;
+					case EDITOR_NOTIFY:
+					{
+						Notification &nt = rec.nt;
+						nt.code = p.get_uint();
+						uint64_t mask = p.get_uint();
+						if (mask & NT_POSITION) nt.position = p.get_int();
+						if (mask & NT_CH) nt.ch = p.get_int();
+						if (mask & NT_MODIFIERS) nt.modifiers = p.get_int();
+						if (mask & NT_MODIFICATION_TYPE) nt.modification_type = p.get_int();
+						if (mask & NT_LENGTH) nt.length = p.get_int();
+						if (mask & NT_LINES_ADDED) nt.lines_added = p.get_int();
+						if (mask & NT_LINE) nt.line = p.get_int();
+						if (mask & NT_MARGIN) nt.margin = p.get_int();
+						if (mask & NT_LIST_TYPE) nt.list_type = p.get_int();
+						if (mask & NT_X) nt.x = p.get_int();
+						if (mask & NT_Y) nt.y = p.get_int();
+						if (mask & NT_UPDATED) nt.updated = p.get_int();
+						if (mask & NT_CARET) nt.caret = p.get_int();
+						if (mask & NT_TEXT) rec.text = p.get_string();
+						break;
+					}
+					default:
+						throw std::runtime_error("unknown event in session recording");
+				}
+				records.push_back(std::move(rec));
+			}
+			return records;
+		}
+
+	}
+
+}
@@ -0,0 +1,112 @@
+#pragma once
+
+#include <geany++/common.hpp>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+namespace Geany
+{
+
+	// Session recordings: a compact binary log of the document, project
+	// and editor events the proxy receives, with timestamps and the
+	// text needed to reproduce them, so a real editing session can be
+	// replayed against plugins without a user (see bench/replay.cpp).
+	//
+	// The file starts with SESSION_MAGIC followed by records, each an
+	// event byte, the microseconds since the previous record and the
+	// event's fields. Integers are LEB128 varints, signed ones zigzag
+	// encoded, strings are a length followed by the bytes.
+	namespace Session
+	{
+
+		enum Event
+		{
+			DOCUMENT_NEW = 1,
+			DOCUMENT_OPEN,
+			DOCUMENT_CLOSE,
+			DOCUMENT_ACTIVATE,
+			DOCUMENT_BEFORE_SAVE,
+			DOCUMENT_SAVE,
+			DOCUMENT_RELOAD,
+			DOCUMENT_FILETYPE_SET,
+			EDITOR_NOTIFY,
+			PROJECT_OPEN,
+			PROJECT_CLOSE,
+		};
+
+		// the parts of an SCNotification plugins look at, plus the caret
+		// position since handlers of SCN_UPDATEUI etc. usually ask for it
+		struct Notification
+		{
+			unsigned int code;
+			int64_t position;
+			int ch;
+			int modifiers;
+			int modification_type;
+			int64_t length;
+			int64_t lines_added;
+			int64_t line;
+			int margin;
+			int list_type;
+			int x;
+			int y;
+			int updated;
+			int64_t caret;
+		};
+
+		struct Record
+		{
+			Event event;
+			uint64_t time;         // microseconds since the recording started
+			unsigned int doc_id;   // GeanyDocument::id, 0 for project events
+			std::string name;      // file or project name
+			std::string filetype;  // filetype name, or the project's base path
+			std::string text;      // document contents or notification text
+			Notification nt;
+		};
+
+		class Recorder
+		{
+		public:
+			// throws std::runtime_error if the file can't be created
+			Recorder(const std::string &filename);
+			~Recorder();
+
+			void document(Event event, GeanyDocument *doc);
+			void notify(GeanyEditor *editor, const SCNotification &nt);
+			void project_open(GeanyProject *project);
+			void project_close();
+
+			uint64_t records() const
+			{
+				return m_records;
+			}
+
+		private:
+			FILE *m_file;
+			std::string m_buf;
+			gint64 m_start;
+			gint64 m_last;
+			uint64_t m_records;
+
+			void begin(Event event, unsigned int doc_id);
+			void end();
+			void put_uint(uint64_t value);
+			void put_int(int64_t value);
+			void put_string(const char *str, size_t len);
+			void put_string(const char *str);
+			void flush();
+
+			Recorder(const Recorder&);
+			Recorder &operator=(const Recorder&);
+		};
+
+		// parses a whole recording up front so replaying doesn't measure
+		// the parsing, throws std::runtime_error on a malformed file
+		std::vector<Record> load(const std::string &filename);
+
+	}
+
+}
@@ -0,0 +1,250 @@
+#include <geany++/tracer_p.hpp>
+#include <geany++/scintilla.hpp>
+
+#ifdef HAVE_CONFIG_H
+#include <geany++/config.h>
+#endif
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+// events kept per thread, later ones are counted and dropped so a
+// forgotten trace doesn't eat all memory (about 48 bytes each)
+#define MAX_THREAD_EVENTS (1024 * 1024)
+
+// Scintilla messages closer together than this, in microseconds, are
+// merged into one span
+#define SEND_BURST_GAP    50
+
+namespace Geany
+{
+
+	namespace Tracer
+	{
+
+		std::atomic<bool> g_enabled(false);
+		std::atomic<unsigned int> g_span_watchers(0);
+
+		namespace
+		{
+			struct Event
+			{
+				const char *name;
+				const char *category;
+				const char *plugin;
+				gint64 start;
+				gint64 duration;
+				unsigned int doc_id;
+				unsigned int count;
+			};
+
+			struct ThreadBuffer
+			{
+				unsigned int tid;
+				std::vector<Event> events;
+				size_t dropped;
+				size_t burst;       // index of the open send burst or SIZE_MAX
+				gint64 burst_end;
+				unsigned int generation;
+			};
+
+			// the buffers live until the program exits since threads may
+			// outlive a trace, they're re-used by the next trace
+			std::mutex buffers_mutex;
+			std::vector<std::unique_ptr<ThreadBuffer>> buffers;
+			std::string trace_filename;
+			std::atomic<unsigned int> trace_generation(0);
+			gint64 trace_start = 0;
+
+			thread_local ThreadBuffer *local_buffer = nullptr;
+			thread_local Span *current_span = nullptr;
+
+			ThreadBuffer &buffer()
+			{
+				if (G_UNLIKELY(!local_buffer))
+				{
+					std::lock_guard<std::mutex> lock(buffers_mutex);
+					buffers.emplace_back(new ThreadBuffer{ unsigned(buffers.size() + 1),
+						std::vector<Event>(), 0, SIZE_MAX, 0, trace_generation });
+					local_buffer = buffers.back().get();
+				}
+				ThreadBuffer &buf = *local_buffer;
+				// left over from an earlier trace
+				if (G_UNLIKELY(buf.generation != trace_generation))
+				{
+					buf.events.clear();
+					buf.dropped = 0;
+					buf.burst = SIZE_MAX;
+					buf.generation = trace_generation;
+				}
+				return buf;
+			}
+
+			void push(ThreadBuffer &buf, const Event &ev)
+			{
+				if (buf.events.size() < MAX_THREAD_EVENTS)
+					buf.events.push_back(ev);
+				else
+					buf.dropped++;
+			}
+
+			void write_string(FILE *fp, const char *str)
+			{
+				std::fputc('"', fp);
+				for (const char *p = str; *p; p++)
+				{
+					unsigned char c = *p;
+					if (c == '"' || c == '\\')
+						std::fprintf(fp, "\\%c", c);
+					else if (c < 0x20)
+						std::fprintf(fp, "\\u%04x", c);
+					else
+						std::fputc(c, fp);
+				}
+				std::fputc('"', fp);
+			}
+
+			void write_event(FILE *fp, const ThreadBuffer &buf, const Event &ev)
+			{
+				std::fputs(",\n{\"name\":", fp);
+				write_string(fp, ev.name);
+				std::fputs(",\"cat\":", fp);
+				write_string(fp, ev.category);
+				std::fprintf(fp, ",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%" G_GINT64_FORMAT
+					",\"dur\":%" G_GINT64_FORMAT ",\"args\":{", buf.tid,
+					ev.start - trace_start, ev.duration);
+				const char *sep = "";
+				if (ev.plugin)
+				{
+					std::fputs("\"plugin\":", fp);
+					write_string(fp, ev.plugin);
+					sep = ",";
+				}
+				if (ev.doc_id)
+				{
+					std::fprintf(fp, "%s\"doc\":%u", sep, ev.doc_id);
+					sep = ",";
+				}
+				if (ev.count)
+					std::fprintf(fp, "%s\"count\":%u", sep, ev.count);
+				std::fputs("}}", fp);
+			}
+		}
+
+		bool start(const std::string &filename)
+		{
+			std::lock_guard<std::mutex> lock(buffers_mutex);
+			if (g_enabled.load())
+				return false;
+			trace_filename = filename;
+			trace_generation++;
+			trace_start = g_get_monotonic_time();
+			g_enabled.store(true);
+			detail::send_observers++;
+			return true;
+		}
+
+		void stop()
+		{
+			std::lock_guard<std::mutex> lock(buffers_mutex);
+			if (!g_enabled.exchange(false))
+				return;
+			detail::send_observers--;
+
+			FILE *fp = std::fopen(trace_filename.c_str(), "w");
+			if (!fp)
+			{
+				g_warning("unable to write trace '%s': %s",
+					trace_filename.c_str(), std::strerror(errno));
+				return;
+			}
+
+			std::fputs("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n"
+				"{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,"
+				"\"args\":{\"name\":\"Geany++\"}}", fp);
+			size_t dropped = 0;
+			for (auto &buf : buffers)
+			{
+				if (buf->generation != trace_generation)
+					continue;
+				std::fprintf(fp, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,"
+					"\"tid\":%u,\"args\":{\"name\":\"thread %u\"}}", buf->tid, buf->tid);
+				for (auto &ev : buf->events)
+					write_event(fp, *buf, ev);
+				dropped += buf->dropped;
+				buf->events.clear();
+				buf->events.shrink_to_fit();
+			}
+			std::fputs("\n]}\n", fp);
+
+			if (std::fclose(fp) != 0)
+			{
+				g_warning("unable to write trace '%s': %s",
+					trace_filename.c_str(), std::strerror(errno));
+			}
+			if (dropped)
+				g_warning("trace buffers were full, %zu events were dropped", dropped);
+		}
+
+		void record(const char *name, const char *category, gint64 start,
+			gint64 end, unsigned int doc_id, const char *plugin)
+		{
+			if (!enabled())
+				return;
+			ThreadBuffer &buf = buffer();
+			push(buf, Event{ name, category, plugin, start, end - start, doc_id, 0 });
+			// whatever comes next isn't part of the same burst
+			buf.burst = SIZE_MAX;
+		}
+
+		void record_send(gint64 start, gint64 end)
+		{
+			if (!enabled())
+				return;
+			ThreadBuffer &buf = buffer();
+			if (buf.burst < buf.events.size() && start - buf.burst_end <= SEND_BURST_GAP)
+			{
+				Event &ev = buf.events[buf.burst];
+				ev.duration = end - ev.start;
+				ev.count++;
+			}
+			else
+			{
+				buf.burst = buf.events.size();
+				push(buf, Event{ "Scintilla::send", "scintilla", nullptr,
+					start, end - start, 0, 1 });
+			}
+			buf.burst_end = end;
+		}
+
+		void Span::begin(const char *name, const char *category,
+			unsigned int doc_id, const char *plugin)
+		{
+			m_name = name ? name : "(unknown)";
+			m_category = category;
+			m_doc_id = doc_id;
+			m_plugin = plugin;
+			m_start = g_get_monotonic_time();
+			m_parent = current_span;
+			current_span = this;
+		}
+
+		void Span::end()
+		{
+			current_span = m_parent;
+			if (enabled())
+				record(m_name, m_category, m_start, g_get_monotonic_time(), m_doc_id, m_plugin);
+		}
+
+		const Span *Span::current()
+		{
+			return current_span;
+		}
+
+	}
+
+}
@@ -0,0 +1,110 @@
+#pragma once
+
+#include <geany++/common.hpp>
+#include <atomic>
+#include <string>
+
+namespace Geany
+{
+
+	// Records what the framework does as Chrome trace-event JSON, which
+	// chrome://tracing and ui.perfetto.dev load: proxy callbacks, plugin
+	// hooks, idle and worker tasks and bursts of Scintilla messages, as
+	// spans tagged with the plugin and document. Enabled by starting
+	// Geany with GEANYCPP_TRACE=<file>, the file is written when the
+	// proxy is unloaded.
+	//
+	// Each thread appends to its own buffer without locking. When not
+	// tracing a Span costs a relaxed load and a branch.
+	namespace Tracer
+	{
+
+		extern std::atomic<bool> g_enabled;
+
+		// non-zero while something besides the tracer needs to know which
+		// span code runs in, like the Scintilla profiler
+		extern std::atomic<unsigned int> g_span_watchers;
+
+		inline bool enabled()
+		{
+			return g_enabled.load(std::memory_order_relaxed);
+		}
+
+		inline bool spans_active()
+		{
+			return enabled() || g_span_watchers.load(std::memory_order_relaxed);
+		}
+
+		// starts tracing to @a filename, returns false if already tracing
+		bool start(const std::string &filename);
+
+		// stops tracing and writes the file, no other thread may still be
+		// recording, the proxy calls it after Worker::shutdown()
+		void stop();
+
+		// records a complete event, @a plugin may be `nullptr`
+		void record(const char *name, const char *category, gint64 start,
+			gint64 end, unsigned int doc_id, const char *plugin);
+
+		// records one Scintilla message, messages sent in quick succession
+		// are merged into a single "Scintilla::send" span with a count
+		void record_send(gint64 start, gint64 end);
+
+		// a span from construction to destruction, spans begun while
+		// spans_active() form a per-thread stack, see current()
+		class Span
+		{
+		public:
+			// @a plugin must be interned, like PluginData::trace_name
+			Span(const char *name, const char *category, unsigned int doc_id = 0,
+				const char *plugin = nullptr)
+				: m_name(nullptr)
+			{
+				if (spans_active())
+					begin(name, category, doc_id, plugin);
+			}
+
+			~Span()
+			{
+				if (m_name)
+					end();
+			}
+
+			const char *name() const
+			{
+				return m_name;
+			}
+
+			// interned, `nullptr` if the span isn't a plugin's
+			const char *plugin() const
+			{
+				return m_plugin;
+			}
+
+			const Span *parent() const
+			{
+				return m_parent;
+			}
+
+			// the innermost span of the calling thread or `nullptr`
+			static const Span *current();
+
+		private:
+			const char *m_name;
+			const char *m_category;
+			const char *m_plugin;
+			unsigned int m_doc_id;
+			gint64 m_start;
+			Span *m_parent;
+
+			void begin(const char *name, const char *category,
+				unsigned int doc_id, const char *plugin);
+			void end();
+
+			Span(const Span&);
+			Span &operator=(const Span&);
+		};
+
+	}
+
+}
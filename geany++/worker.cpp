@@ -0,0 +1,127 @@
+#include <geany++/worker_p.hpp>
+#include <geany++/tracer_p.hpp>
+
+#ifdef HAVE_CONFIG_H
+#include <geany++/config.h>
+#endif
+
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#define MAX_WORKERS 4u
+
+namespace Geany
+{
+
+	namespace Worker
+	{
+
+		static std::mutex pool_mutex;
+		static std::condition_variable pool_cond;
+		static std::deque<Job> pool_jobs;
+		static std::vector<std::thread> pool_threads;
+		static size_t pool_idle = 0;
+		static bool pool_quit = false;
+
+		static std::mutex main_mutex;
+		static std::deque<Job> main_jobs;
+		static guint main_source = 0;
+
+		static void run_job(const Job &job, const char *category)
+		{
+			Tracer::Span span("job", category);
+			try
+			{
+				job();
+			}
+			catch (std::exception &exc)
+			{
+				g_critical("unhandled C++ exception caught in task: %s", exc.what());
+			}
+			catch (...)
+			{
+				g_critical("unhandled unknown C++ exception caught in task");
+			}
+		}
+
+		static void worker_main()
+		{
+			while (true)
+			{
+				Job job;
+				{
+					std::unique_lock<std::mutex> lock(pool_mutex);
+					pool_idle++;
+					pool_cond.wait(lock, []() {
+						return pool_quit || !pool_jobs.empty();
+					});
+					pool_idle--;
+					// finish everything that was queued before quitting
+					if (pool_jobs.empty())
+						return;
+					job = std::move(pool_jobs.front());
+					pool_jobs.pop_front();
+				}
+				run_job(job, "worker");
+			}
+		}
+
+		void submit(const Job &job)
+		{
+			std::lock_guard<std::mutex> lock(pool_mutex);
+			pool_jobs.push_back(job);
+			unsigned int max_threads = std::max(1u,
+				std::min(MAX_WORKERS, std::thread::hardware_concurrency()));
+			if (pool_idle < pool_jobs.size() && pool_threads.size() < max_threads)
+				pool_threads.emplace_back(worker_main);
+			pool_cond.notify_one();
+		}
+
+		static gboolean on_main_jobs(gpointer) noexcept
+		{
+			std::deque<Job> jobs;
+			{
+				std::lock_guard<std::mutex> lock(main_mutex);
+				jobs.swap(main_jobs);
+				main_source = 0;
+			}
+			for (auto &job : jobs)
+				run_job(job, "idle");
+			return FALSE;
+		}
+
+		void invoke_in_main(const Job &job)
+		{
+			std::lock_guard<std::mutex> lock(main_mutex);
+			main_jobs.push_back(job);
+			if (main_source == 0)
+				main_source = g_idle_add(on_main_jobs, nullptr);
+		}
+
+		void shutdown()
+		{
+			{
+				std::lock_guard<std::mutex> lock(pool_mutex);
+				pool_quit = true;
+			}
+			pool_cond.notify_all();
+			for (auto &thread : pool_threads)
+				thread.join();
+			pool_threads.clear();
+			pool_quit = false;
+
+			std::lock_guard<std::mutex> lock(main_mutex);
+			if (main_source != 0)
+				g_source_remove(main_source);
+			main_source = 0;
+			main_jobs.clear();
+		}
+
+	}
+
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <geany++/common.hpp>
+#include <functional>
+
+namespace Geany
+{
+
+	// Background threads for framework tasks which mustn't block the
+	// main loop, like file I/O. Jobs run on a worker must not touch
+	// GTK, Scintilla or Geany, they hand results back to the main
+	// thread using invoke_in_main().
+	namespace Worker
+	{
+		typedef std::function<void()> Job;
+
+		// queue a job to run on one of the background threads
+		void submit(const Job &job);
+
+		// queue a job to run on the main thread, may be called from
+		// any thread
+		void invoke_in_main(const Job &job);
+
+		// wait for queued background jobs to finish and discard any
+		// main thread jobs which haven't run yet
+		void shutdown();
+	}
+
+}
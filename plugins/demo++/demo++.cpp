@@ -1,4 +1,5 @@
-#include <geany++/geany.hpp>
+#include <geany++/iplugin.hpp>
+#include <geany++/ui.hpp>
 
 #ifdef HAVE_CONFIG_H
 #include <geany++/config.h>
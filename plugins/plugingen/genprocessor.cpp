@@ -1,13 +1,15 @@
 #include "genprocessor.hpp"
+#include "gentemplate.hpp"
 #include <glib/gstdio.h>
+#include <algorithm>
+#include <atomic>
 #include <cstdlib>
 #include <sstream>
 #include <string>
-#include <utility>
+#include <thread>
 #include <vector>
 
 typedef std::vector<std::string> StringList;
-typedef std::vector<std::pair<std::string, std::string>> ReplList;
 
 static void list_files(StringList &list, const std::string &root)
 {
@@ -62,76 +64,78 @@ static unsigned int create_directories(const StringList &list)
 	return failures;
 }
 
+// creates each distinct directory once, skipping those another one
+// in the list lies below since creating it makes them too
+static unsigned int create_directories_batched(StringList &dirs)
+{
+	std::sort(dirs.begin(), dirs.end());
+	dirs.erase(std::unique(dirs.begin(), dirs.end()), dirs.end());
+
+	unsigned int failures = 0;
+	for (size_t i = 0; i < dirs.size(); i++)
+	{
+		if (i + 1 < dirs.size() &&
+			dirs[i + 1].compare(0, dirs[i].size(), dirs[i]) == 0 &&
+			dirs[i + 1].size() > dirs[i].size() &&
+			dirs[i + 1][dirs[i].size()] == G_DIR_SEPARATOR)
+		{
+			continue;
+		}
+		if (g_mkdir_with_parents(dirs[i].c_str(), 0755) != 0)
+			failures++;
+	}
+	return failures;
+}
+
 static std::string current_year_string()
 {
 	auto dt = Glib::DateTime::create_now_local();
 	return std::to_string(dt.get_year());
 }
 
-static void make_replacements_list(ReplList &list, const GenProcessorSettings &settings)
+static void make_template_values(TemplateValues &values, const GenProcessorSettings &settings)
 {
-	list.emplace_back("${plugin_name}", settings.name);
-	list.emplace_back("${plugin_identifier}", settings.identifier);
-	list.emplace_back("${plugin_description}", settings.description);
-	list.emplace_back("${plugin_version}", settings.version);
-	list.emplace_back("${plugin_author_name}", settings.author_name);
-	list.emplace_back("${plugin_author_email}", settings.author_email);
-	list.emplace_back("${plugin_support_url}", settings.support_url);
-	list.emplace_back("${plugin_bug_report_url}", settings.bug_report_url);
-	list.emplace_back("${plugin_base_dir}", settings.base_dir);
-	list.emplace_back("${plugin_template_dir}", settings.template_dir);
-	list.emplace_back("${plugin_year}", current_year_string());
+	values["plugin_name"] = settings.name;
+	values["plugin_identifier"] = settings.identifier;
+	values["plugin_description"] = settings.description;
+	values["plugin_version"] = settings.version;
+	values["plugin_author_name"] = settings.author_name;
+	values["plugin_author_email"] = settings.author_email;
+	values["plugin_support_url"] = settings.support_url;
+	values["plugin_bug_report_url"] = settings.bug_report_url;
+	values["plugin_base_dir"] = settings.base_dir;
+	values["plugin_template_dir"] = settings.template_dir;
+	values["plugin_year"] = current_year_string();
 
 	auto src_file = Glib::build_filename(settings.base_dir, settings.identifier + ".cpp");
-	list.emplace_back("${plugin_cpp_file_escaped}", Glib::uri_escape_string(src_file));
+	values["plugin_cpp_file_escaped"] = Glib::uri_escape_string(src_file);
 }
 
-static void str_replace(std::string &haystack, const std::string &needle,
-		const std::string &replacement)
+static void replace_file_names(StringList &out_list, const TemplateValues &values)
 {
-	if (needle.size() > haystack.size())
-		return;
-
-	for (size_t i=0; ; i += replacement.size())
-	{
-		i = haystack.find(needle, i);
-		if (i == haystack.npos)
-			return;
-		if (needle.size() == replacement.size())
-			haystack.replace(i, needle.size(), replacement);
-		else
-		{
-			haystack.erase(i, needle.size());
-			haystack.insert(i, replacement);
-		}
-	}
-}
-
-static void perform_replacements(std::string &haystack, const ReplList &repl_list)
-{
-	for (auto &pair : repl_list)
-		str_replace(haystack, pair.first, pair.second);
+	for (auto &fn : out_list)
+		fn = GenTemplate::render(fn, values);
 }
 
-static void replace_file_names(StringList &out_list, const ReplList &repl_list)
+static void write_file(const std::string &in_file, const std::string &out_file,
+	const TemplateValues &values, size_t &bytes)
 {
-	for (auto &fn : out_list)
-		perform_replacements(fn, repl_list);
+	auto tmpl = GenTemplate::load(in_file);
+	auto contents = tmpl->render(values);
+	Glib::file_set_contents(out_file, contents);
+	if (Glib::str_has_suffix(out_file, "autogen.sh"))
+		g_chmod(out_file.c_str(), 0755);
+	bytes = contents.size();
 }
 
 static void replace_file_contents(const StringList &in_list,
-	const StringList &out_list, const ReplList &repl_list)
+	const StringList &out_list, const TemplateValues &values)
 {
 	g_return_if_fail(in_list.size() == out_list.size());
 
+	size_t bytes;
 	for (size_t i = 0; i < in_list.size(); i++)
-	{
-		auto contents = Glib::file_get_contents(in_list[i]);
-		perform_replacements(contents, repl_list);
-		Glib::file_set_contents(out_list[i], contents);
-		if (Glib::str_has_suffix(out_list[i], "autogen.sh"))
-			g_chmod(out_list[i].c_str(), 0755);
-	}
+		write_file(in_list[i], out_list[i], values, bytes);
 }
 
 static bool post_process_options(const GenProcessorSettings &settings, const StringList &out_list)
@@ -186,15 +190,17 @@ static bool post_process_options(const GenProcessorSettings &settings, const Str
 			throw;
 		}
 	}
+	return true;
 }
 
-static void remove_project_file(StringList &list)
+static void remove_project_file(StringList &in_list, StringList &out_list)
 {
-	for (size_t i = 0; i < list.size(); i++)
+	for (size_t i = 0; i < out_list.size(); i++)
 	{
-		if (Glib::str_has_suffix(list[i], ".geany"))
+		if (Glib::str_has_suffix(out_list[i], ".geany"))
 		{
-			list.erase(list.begin() + i);
+			in_list.erase(in_list.begin() + i);
+			out_list.erase(out_list.begin() + i);
 			return;
 		}
 	}
@@ -240,16 +246,218 @@ bool GenProcessor::process(const GenProcessorSettings &settings)
 {
 	StringList in_list;
 	StringList out_list;
-	ReplList repl_list;
+	TemplateValues values;
 	list_files(in_list, settings.template_dir);
 	transform_file_list(in_list, out_list, settings.template_dir, settings.base_dir);
-	make_replacements_list(repl_list, settings);
+	make_template_values(values, settings);
 	create_directories(out_list);
-	replace_file_names(out_list, repl_list);
+	replace_file_names(out_list, values);
 	if (! settings.generate_project)
-		remove_project_file(out_list);
-	replace_file_contents(in_list, out_list, repl_list);
+		remove_project_file(in_list, out_list);
+	replace_file_contents(in_list, out_list, values);
 	post_process_options(settings, out_list);
 	finish_processing(settings);
 	return true;
 }
+
+namespace
+{
+	struct BatchTask
+	{
+		size_t project;
+		std::string in_file;
+		std::string out_file;
+		// filled in by the worker
+		bool ok;
+		Glib::ustring error;
+		size_t bytes;
+		gint64 start;
+		gint64 end;
+	};
+}
+
+std::vector<GenBatchResult> GenProcessor::process_batch(
+	const std::vector<GenProcessorSettings> &batch, unsigned int num_threads)
+{
+	std::vector<GenBatchResult> results(batch.size());
+	std::vector<TemplateValues> values(batch.size());
+	std::vector<BatchTask> tasks;
+	std::unordered_map<std::string, StringList> template_files;
+	StringList dirs;
+
+	// work out every output file up front, on this thread
+	for (size_t p = 0; p < batch.size(); p++)
+	{
+		auto &settings = batch[p];
+		auto &result = results[p];
+		result.name = settings.name;
+		result.base_dir = settings.base_dir;
+		result.ok = true;
+		result.files = 0;
+		result.bytes = 0;
+		result.generate_ms = 0;
+		result.post_process_ms = 0;
+
+		auto it = template_files.find(settings.template_dir);
+		if (it == template_files.end())
+		{
+			it = template_files.emplace(settings.template_dir, StringList()).first;
+			list_files(it->second, settings.template_dir);
+		}
+
+		StringList in_list(it->second);
+		StringList out_list;
+		transform_file_list(in_list, out_list, settings.template_dir, settings.base_dir);
+		make_template_values(values[p], settings);
+		replace_file_names(out_list, values[p]);
+		if (! settings.generate_project)
+			remove_project_file(in_list, out_list);
+
+		for (size_t i = 0; i < in_list.size(); i++)
+		{
+			dirs.emplace_back(Glib::path_get_dirname(out_list[i]));
+			BatchTask task;
+			task.project = p;
+			task.in_file = std::move(in_list[i]);
+			task.out_file = std::move(out_list[i]);
+			task.ok = false;
+			task.bytes = 0;
+			task.start = task.end = 0;
+			tasks.push_back(std::move(task));
+		}
+		result.files = in_list.size();
+	}
+
+	create_directories_batched(dirs);
+
+	// render and write on the pool, each thread takes the next file
+	std::atomic<size_t> next(0);
+	auto worker = [&tasks, &values, &next]() {
+		for (size_t i = next++; i < tasks.size(); i = next++)
+		{
+			auto &task = tasks[i];
+			task.start = g_get_monotonic_time();
+			try
+			{
+				write_file(task.in_file, task.out_file, values[task.project], task.bytes);
+				task.ok = true;
+			}
+			catch (Glib::Error &err)
+			{
+				task.error = err.what();
+			}
+			catch (std::exception &err)
+			{
+				task.error = err.what();
+			}
+			task.end = g_get_monotonic_time();
+		}
+	};
+
+	if (num_threads == 0)
+		num_threads = std::max(1u, std::thread::hardware_concurrency());
+	num_threads = std::min<size_t>(num_threads, std::max<size_t>(tasks.size(), 1));
+	std::vector<std::thread> threads;
+	for (unsigned int i = 1; i < num_threads; i++)
+		threads.emplace_back(worker);
+	worker();
+	for (auto &thread : threads)
+		thread.join();
+
+	std::vector<gint64> first_start(batch.size(), 0), last_end(batch.size(), 0);
+	for (auto &task : tasks)
+	{
+		auto &result = results[task.project];
+		result.bytes += task.bytes;
+		if (!task.ok && result.ok)
+		{
+			result.ok = false;
+			result.error = Glib::ustring::compose(_("Failed to write '%1': %2"),
+				Glib::filename_display_name(task.out_file), task.error);
+		}
+		if (first_start[task.project] == 0 || task.start < first_start[task.project])
+			first_start[task.project] = task.start;
+		last_end[task.project] = std::max(last_end[task.project], task.end);
+	}
+
+	// git changes the working directory, so one project at a time
+	for (size_t p = 0; p < batch.size(); p++)
+	{
+		auto &result = results[p];
+		result.generate_ms = (last_end[p] - first_start[p]) / 1000.0;
+		if (!result.ok)
+			continue;
+		gint64 start = g_get_monotonic_time();
+		if (!post_process_options(batch[p], StringList()))
+		{
+			result.ok = false;
+			result.error = _("Failed to set up the Git repository");
+		}
+		result.post_process_ms = (g_get_monotonic_time() - start) / 1000.0;
+	}
+
+	return results;
+}
+
+bool GenProcessor::load_batch(const std::string &filename,
+	std::vector<GenProcessorSettings> &batch, Glib::ustring &error)
+{
+	Glib::KeyFile kf;
+	try
+	{
+		kf.load_from_file(filename);
+	}
+	catch (Glib::Error &err)
+	{
+		error = err.what();
+		return false;
+	}
+
+	auto batch_dir = Glib::path_get_dirname(filename);
+	auto get_string = [&kf](const Glib::ustring &group, const char *key,
+		const Glib::ustring &def) -> Glib::ustring {
+		return kf.has_key(group, key) ? kf.get_string(group, key) : def;
+	};
+	auto get_bool = [&kf](const Glib::ustring &group, const char *key) {
+		return kf.has_key(group, key) && kf.get_boolean(group, key);
+	};
+
+	// each group is a plugin, named by its identifier
+	try
+	{
+		for (auto &group : kf.get_groups())
+		{
+			GenProcessorSettings settings;
+			settings.identifier = get_string(group, "identifier", group);
+			settings.name = get_string(group, "name", settings.identifier);
+			settings.description = get_string(group, "description", "");
+			settings.version = get_string(group, "version", "0.1");
+			settings.author_name = get_string(group, "author_name", Glib::get_real_name());
+			settings.author_email = get_string(group, "author_email", "");
+			settings.support_url = get_string(group, "support_url", "");
+			settings.bug_report_url = get_string(group, "bug_report_url", "");
+
+			settings.base_dir = Glib::filename_from_utf8(get_string(group, "base_dir",
+				Glib::build_filename("plugins", settings.identifier)));
+			if (!Glib::path_is_absolute(settings.base_dir))
+				settings.base_dir = Glib::build_filename(batch_dir, settings.base_dir);
+			settings.template_dir = Glib::filename_from_utf8(get_string(group,
+				"template_dir", PLUGINGEN_TEMPLATE_DIR));
+			if (!Glib::path_is_absolute(settings.template_dir))
+				settings.template_dir = Glib::build_filename(batch_dir, settings.template_dir);
+
+			settings.init_git_repo = get_bool(group, "init_git_repo");
+			settings.initial_git_commit = get_bool(group, "initial_git_commit");
+			settings.set_git_author = get_bool(group, "set_git_author");
+			settings.generate_project = get_bool(group, "generate_project");
+			batch.push_back(settings);
+		}
+	}
+	catch (Glib::KeyFileError &err)
+	{
+		error = err.what();
+		return false;
+	}
+
+	return true;
+}
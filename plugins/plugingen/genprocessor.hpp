@@ -21,8 +21,31 @@ struct GenProcessorSettings
 };
 
 
+// outcome and timing of one plugin generated in batch mode
+struct GenBatchResult
+{
+	Glib::ustring name;
+	std::string base_dir;
+	bool ok;
+	Glib::ustring error;
+	size_t files;
+	size_t bytes;
+	double generate_ms;      // from the first file started to the last written
+	double post_process_ms;  // git setup
+};
+
+
 class GenProcessor
 {
 public:
 	bool process(const GenProcessorSettings &settings);
+
+	// generate several plugins at once, rendering and writing files on
+	// num_threads threads (0 for one per processor)
+	std::vector<GenBatchResult> process_batch(
+		const std::vector<GenProcessorSettings> &batch, unsigned int num_threads = 0);
+
+	// read batch settings from a keyfile with a group per plugin
+	static bool load_batch(const std::string &filename,
+		std::vector<GenProcessorSettings> &batch, Glib::ustring &error);
 };
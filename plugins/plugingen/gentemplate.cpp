@@ -0,0 +1,121 @@
+#include "gentemplate.hpp"
+#include <glib/gstdio.h>
+#include <gtkmm.h>
+#include <mutex>
+
+static inline bool is_name_char(char c)
+{
+	return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') ||
+		(c >= '0' && c <= '9') || c == '_';
+}
+
+GenTemplate::GenTemplate(const std::string &text)
+	: m_text(text)
+{
+	std::unordered_map<std::string, int> name_index;
+	size_t literal_start = 0;
+	size_t pos = 0;
+
+	while ((pos = m_text.find("${", pos)) != std::string::npos)
+	{
+		size_t end = pos + 2;
+		while (end < m_text.size() && is_name_char(m_text[end]))
+			end++;
+		if (end == pos + 2 || end >= m_text.size() || m_text[end] != '}')
+		{
+			pos += 2;
+			continue;
+		}
+
+		if (pos > literal_start)
+			m_segments.push_back({ literal_start, pos - literal_start, -1 });
+
+		std::string name(m_text, pos + 2, end - pos - 2);
+		auto it = name_index.find(name);
+		if (it == name_index.end())
+		{
+			it = name_index.emplace(name, int(m_names.size())).first;
+			m_names.push_back(name);
+		}
+		// the placeholder's own text is kept for when it has no value
+		m_segments.push_back({ pos, end + 1 - pos, it->second });
+
+		pos = literal_start = end + 1;
+	}
+
+	if (literal_start < m_text.size())
+		m_segments.push_back({ literal_start, m_text.size() - literal_start, -1 });
+}
+
+std::shared_ptr<const GenTemplate> GenTemplate::load(const std::string &filename)
+{
+	struct CacheEntry
+	{
+		gint64 mtime;
+		goffset size;
+		std::shared_ptr<const GenTemplate> tmpl;
+	};
+	// batch generation loads templates from several threads
+	static std::unordered_map<std::string, CacheEntry> cache;
+	static std::mutex cache_mutex;
+
+	GStatBuf st;
+	bool have_stat = (g_stat(filename.c_str(), &st) == 0);
+	if (have_stat)
+	{
+		std::lock_guard<std::mutex> lock(cache_mutex);
+		auto it = cache.find(filename);
+		if (it != cache.end() && it->second.mtime == gint64(st.st_mtime) &&
+			it->second.size == goffset(st.st_size))
+		{
+			return it->second.tmpl;
+		}
+	}
+
+	std::shared_ptr<const GenTemplate> tmpl(new GenTemplate(Glib::file_get_contents(filename)));
+	if (have_stat)
+	{
+		std::lock_guard<std::mutex> lock(cache_mutex);
+		cache[filename] = { gint64(st.st_mtime), goffset(st.st_size), tmpl };
+	}
+	return tmpl;
+}
+
+std::string GenTemplate::render(const TemplateValues &values) const
+{
+	// look each name up once, then size the output exactly
+	std::vector<const std::string*> resolved(m_names.size(), nullptr);
+	for (size_t i = 0; i < m_names.size(); i++)
+	{
+		auto it = values.find(m_names[i]);
+		if (it != values.end())
+			resolved[i] = &it->second;
+	}
+
+	size_t size = 0;
+	for (auto &seg : m_segments)
+	{
+		if (seg.name >= 0 && resolved[seg.name])
+			size += resolved[seg.name]->size();
+		else
+			size += seg.length;
+	}
+
+	std::string out;
+	out.reserve(size);
+	for (auto &seg : m_segments)
+	{
+		if (seg.name >= 0 && resolved[seg.name])
+			out += *resolved[seg.name];
+		else
+			out.append(m_text, seg.offset, seg.length);
+	}
+	return out;
+}
+
+std::string GenTemplate::render(const std::string &text, const TemplateValues &values)
+{
+	if (text.find("${") == std::string::npos)
+		return text;
+	return GenTemplate(text).render(values);
+}
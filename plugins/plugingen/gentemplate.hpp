@@ -0,0 +1,40 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+typedef std::unordered_map<std::string, std::string> TemplateValues;
+
+// A template split once into literal text and `${name}` placeholders,
+// so rendering is a single pass with no searching. Placeholders with
+// no value are copied through as they are, templates contain other
+// `${...}` syntax, like shell variables, which must survive.
+class GenTemplate
+{
+public:
+	GenTemplate(const std::string &text);
+
+	// compile a template file, reusing an earlier compilation if the
+	// file hasn't changed since
+	static std::shared_ptr<const GenTemplate> load(const std::string &filename);
+
+	std::string render(const TemplateValues &values) const;
+
+	// render a one-off string, such as a file name
+	static std::string render(const std::string &text, const TemplateValues &values);
+
+private:
+	struct Segment
+	{
+		size_t offset;
+		size_t length;
+		// index into m_names, or -1 for literal text
+		int name;
+	};
+
+	std::string m_text;
+	std::vector<Segment> m_segments;
+	std::vector<std::string> m_names;
+};
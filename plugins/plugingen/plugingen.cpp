@@ -10,16 +10,24 @@
 struct GenPlugin final : public Geany::IPlugin
 {
 	Gtk::MenuItem item;
+	Gtk::MenuItem batch_item;
 
 	GenPlugin(Geany::PluginData &init_data)
 		: Geany::IPlugin(init_data),
-		  item(_("Create C++ Plugin..."))
+		  item(_("Create C++ Plugin...")),
+		  batch_item(_("Create C++ Plugins from Batch File..."))
 	{
 		Geany::ui->tools_menu->append(item);
 		item.set_tooltip_text(
 			_("Generate the boilerplate for creating a Geany++ C++ plugin."));
 		item.signal_activate().connect(sigc::mem_fun(*this, &GenPlugin::generate));
 		item.show();
+
+		Geany::ui->tools_menu->append(batch_item);
+		batch_item.set_tooltip_text(
+			_("Generate several Geany++ C++ plugins described in a keyfile."));
+		batch_item.signal_activate().connect(sigc::mem_fun(*this, &GenPlugin::generate_batch));
+		batch_item.show();
 	}
 
 	void generate()
@@ -33,6 +41,47 @@ struct GenPlugin final : public Geany::IPlugin
 		}
 	}
 
+	void generate_batch()
+	{
+		Gtk::FileChooserDialog chooser(_("Open Batch File"), Gtk::FILE_CHOOSER_ACTION_OPEN);
+		chooser.add_button(_("_Cancel"), Gtk::RESPONSE_CANCEL);
+		chooser.add_button(_("_Open"), Gtk::RESPONSE_ACCEPT);
+		if (chooser.run() != Gtk::RESPONSE_ACCEPT)
+			return;
+		chooser.hide();
+
+		std::vector<GenProcessorSettings> batch;
+		Glib::ustring error;
+		if (!GenProcessor::load_batch(chooser.get_filename(), batch, error))
+		{
+			::msgwin_status_add(_("Failed to read batch file: %s"), error.c_str());
+			return;
+		}
+
+		GenProcessor proc;
+		size_t failed = 0;
+		for (auto &result : proc.process_batch(batch))
+		{
+			if (result.ok)
+			{
+				::msgwin_status_add(_("Generated '%s' in '%s': %lu files, %lu bytes "
+					"in %.1fms (+%.1fms Git)"), result.name.c_str(), result.base_dir.c_str(),
+					static_cast<unsigned long>(result.files),
+					static_cast<unsigned long>(result.bytes),
+					result.generate_ms, result.post_process_ms);
+			}
+			else
+			{
+				::msgwin_status_add(_("Failed to generate '%s': %s"),
+					result.name.c_str(), result.error.c_str());
+				failed++;
+			}
+		}
+		::ui_set_statusbar(FALSE, _("Generated %lu of %lu plugins."),
+			static_cast<unsigned long>(batch.size() - failed),
+			static_cast<unsigned long>(batch.size()));
+	}
+
 };
 
 
@@ -0,0 +1,103 @@
+#!/usr/bin/env python3
+#
+# Times compiling C++ sources against the geany++ headers, cold (every
+# header parsed from scratch) and warm (using a precompiled geany.hpp
+# built with the same flags), so header changes can be measured.
+#
+
+import optparse
+import os
+import shlex
+import shutil
+import statistics
+import subprocess
+import sys
+import tempfile
+import time
+
+def run_compiler(cmd):
+	start = time.perf_counter()
+	proc = subprocess.run(cmd, stdout=subprocess.PIPE, stderr=subprocess.STDOUT,
+		universal_newlines=True)
+	elapsed = time.perf_counter() - start
+	if proc.returncode != 0:
+		sys.stderr.write(' '.join(shlex.quote(c) for c in cmd) + '\n')
+		sys.stderr.write(proc.stdout)
+		raise Exception("compiler failed with exit code %d" % proc.returncode)
+	return elapsed, proc.stdout
+
+def time_compile(cmd, runs):
+	return [ run_compiler(cmd)[0] for x in range(runs) ]
+
+def build_pch(cxx, flags, header, pch_dir):
+	out = os.path.join(pch_dir, 'geany++', 'geany.hpp.gch')
+	os.makedirs(os.path.dirname(out))
+	elapsed, output = run_compiler(cxx + flags + [ '-x', 'c++-header', '-o', out, header ])
+	# as used through pch_cflags in geany++.pc, GCC only needs the .gch
+	return elapsed, out[:-len('.gch')]
+
+def pch_used(cmd):
+	# with -H, GCC marks a precompiled header it loaded with '!'
+	elapsed, output = run_compiler(cmd + [ '-H' ])
+	return any(line.startswith('! ') and line.endswith('geany.hpp.gch')
+		for line in output.splitlines())
+
+def format_times(times):
+	return '%8.3f %8.3f' % (min(times), statistics.median(times))
+
+def main(args):
+
+	par = optparse.OptionParser(usage='%prog [options] SOURCE...')
+
+	par.add_option('--cxx', metavar='COMMAND', dest='cxx',
+		default=os.environ.get('CXX', 'g++'), help='the C++ compiler')
+	par.add_option('--flags', metavar='FLAGS', dest='flags', default='',
+		help='compiler flags, include paths in particular')
+	par.add_option('-D', '--define', metavar='NAME=VALUE', dest='defines',
+		action='append', default=[], help='define a macro for all sources')
+	par.add_option('--header', metavar='FILE', dest='header',
+		default=os.path.join(os.path.dirname(__file__), '..', 'geany++', 'geany.hpp'),
+		help='the header to precompile')
+	par.add_option('-n', '--runs', metavar='N', dest='runs', type='int',
+		default=3, help='number of times to compile each source')
+
+	opts, args = par.parse_args(args[1:])
+
+	if len(args) < 1:
+		par.error("not enough arguments, missing source files")
+
+	cxx = shlex.split(opts.cxx)
+	flags = shlex.split(opts.flags) + [ '-D' + d for d in opts.defines ]
+	# keep compiler caches out of the measurements
+	os.environ['CCACHE_DISABLE'] = '1'
+
+	pch_dir = tempfile.mkdtemp(prefix='geany++-bench-')
+	obj = os.path.join(pch_dir, 'bench.o')
+	try:
+		pch_sec, pch_header = build_pch(cxx, flags, opts.header, pch_dir)
+		print('precompiling %s: %.3fs' % (os.path.basename(opts.header), pch_sec))
+		print()
+		print('%-32s %17s %17s' % ('', 'cold (s)', 'warm (s)'))
+		print('%-32s %8s %8s %8s %8s' % ('source', 'min', 'median', 'min', 'median'))
+
+		cold_total = warm_total = 0.0
+		for src in args:
+			base = cxx + flags + [ '-c', '-o', obj, src ]
+			warm = cxx + [ '-include', pch_header, '-Winvalid-pch' ] + flags + [ '-c', '-o', obj, src ]
+			cold_times = time_compile(base, opts.runs)
+			warm_times = time_compile(warm, opts.runs)
+			note = '' if pch_used(warm) else '  (precompiled header not used)'
+			print('%-32s %s %s%s' % (os.path.basename(src),
+				format_times(cold_times), format_times(warm_times), note))
+			cold_total += statistics.median(cold_times)
+			warm_total += statistics.median(warm_times)
+
+		print('%-32s %8s %8.3f %8s %8.3f' % ('total', '', cold_total, '', warm_total))
+	finally:
+		shutil.rmtree(pch_dir)
+
+	return 0
+
+
+if __name__ == "__main__":
+	sys.exit(main(sys.argv))
@@ -133,29 +133,154 @@ def gen_enums(iface, ind_lvl=0, ind_tp='\t'):
 		gen.iwriteln('};\n')
 	return out.getvalue().rstrip()
 
-def gen_sparse_lexer_names(iface, ind_lvl=0, ind_tp='\t'):
-	max_lex = max(lex.value for lex in iface.lexers)
-	lexer_names = [ 'nullptr' for x in range(0, max_lex+1) ]
-	for lexer in iface.lexers:
-		lexer_names[lexer.value] = '"%s"' % lexer.name
+ARG_TYPES = {
+	"": "VOID",
+	"void": "VOID",
+	"bool": "BOOL",
+	"int": "INT",
+	"position": "POSITION",
+	"colour": "COLOUR",
+	"string": "STRING",
+	"stringresult": "STRINGRESULT",
+	"cells": "CELLS",
+	"textrange": "TEXTRANGE",
+	"findtext": "FINDTEXT",
+	"formatrange": "FORMATRANGE",
+	"keymod": "KEYMOD",
+}
+
+# lookups on message IDs go through a table indexed by ID minus this
+MESSAGE_ID_BASE = 2000
+
+# FNV-1a, must match Geany::SciMeta::detail::fnv1a()
+FNV_BASIS = 0x811C9DC5
+FNV_PRIME = 0x01000193
+# start values for the second and third hash of each key
+HASH_SEED_1 = 0x9747B28C
+HASH_SEED_2 = 0x2C1B3C6D
+# mixed into the start values to tell styles of different lexers apart
+LEXER_MIX = 0x9E3779B1
+
+def fnv1a(data, h):
+	for c in data.encode('utf-8'):
+		h = ((h ^ c) * FNV_PRIME) & 0xFFFFFFFF
+	return h
+
+def perfect_hash(hashes):
+	"""
+	Build a hash-and-displace perfect hash. Takes a (bucket, h1, h2)
+	triple per key; each key lands in a bucket, then buckets are placed
+	largest first, each getting the smallest displacement d for which
+	(h1 + d * h2) mod 2^32 mod the number of slots puts all its keys into
+	free slots. Returns (displacements, slots) where slots holds key
+	indices or -1.
+	"""
+	n = len(hashes)
+	if len(set((h1, h2) for b, h1, h2 in hashes)) != n:
+		raise Exception("duplicate keys in perfect hash")
+	num_slots = max(1, n + n // 4)
+	num_buckets = max(1, (n + 3) // 4)
+	buckets = [ [] for x in range(num_buckets) ]
+	for i, (b, h1, h2) in enumerate(hashes):
+		buckets[b % num_buckets].append(i)
+	displace = [ 0 for x in range(num_buckets) ]
+	slots = [ -1 for x in range(num_slots) ]
+	order = sorted(range(num_buckets), key=lambda b: -len(buckets[b]))
+	for b in order:
+		if len(buckets[b]) == 0:
+			continue
+		d = 0
+		while True:
+			taken = [ ((hashes[i][1] + d * hashes[i][2]) & 0xFFFFFFFF) % num_slots for i in buckets[b] ]
+			if len(set(taken)) == len(taken) and all(slots[t] < 0 for t in taken):
+				break
+			d += 1
+			if d > 0xFFFFFF:
+				raise Exception("unable to build perfect hash")
+		displace[b] = d
+		for i, t in zip(buckets[b], taken):
+			slots[t] = i
+	return displace, slots
+
+def name_hashes(name, mix=0):
+	return (fnv1a(name, FNV_BASIS ^ mix), fnv1a(name, HASH_SEED_1 ^ mix),
+		fnv1a(name, HASH_SEED_2 ^ mix) | 1)
+
+def write_int_array(gen, decl, values, per_line=12):
+	gen.iwriteln('%s[%d]' % (decl, len(values)))
+	gen.iwriteln('{')
+	gen.indent()
+	for i in range(0, len(values), per_line):
+		gen.iwriteln(' '.join('%d,' % v for v in values[i:i+per_line]))
+	gen.unindent()
+	gen.iwriteln('};')
+
+def all_messages(iface):
+	msgs = list(iface.functions)
+	for prop in iface.properties:
+		if prop.getter is not None:
+			msgs.append(prop.getter)
+		if prop.setter is not None:
+			msgs.append(prop.setter)
+	return sorted(msgs, key=lambda f: int(f.value))
+
+def gen_message_table(iface, ind_lvl=0, ind_tp='\t'):
 	out = io.StringIO()
 	gen = sciface.CodeGen(out, ind_lvl, ind_tp)
-	for name in lexer_names:
-		gen.iwriteln('%s,' % name)
+	msgs = all_messages(iface)
+	gen.iwriteln('constexpr Message messages[%d]' % len(msgs))
+	gen.iwriteln('{')
+	gen.indent()
+	for msg in msgs:
+		args = [ ARG_TYPES[msg.type] ]
+		for param in msg.parameters:
+			args.append(ARG_TYPES[param.type or ''])
+		gen.iwriteln('{ %d, "%s", ArgType::%s, ArgType::%s, ArgType::%s },' %
+			(int(msg.value), msg.name, args[0], args[1], args[2]))
+	gen.unindent()
+	gen.iwriteln('};')
+	gen.iwriteln()
+	gen.iwriteln('constexpr unsigned int message_id_base = %d;' % MESSAGE_ID_BASE)
+	index = [ -1 for x in range(int(msgs[-1].value) - MESSAGE_ID_BASE + 1) ]
+	for i, msg in enumerate(msgs):
+		index[int(msg.value) - MESSAGE_ID_BASE] = i
+	write_int_array(gen, 'constexpr int16_t message_index', index)
 	return out.getvalue().rstrip()
 
-def gen_lexer_style_defs(iface, ind_lvl=0, ind_tp='\t'):
+def gen_notification_table(iface, ind_lvl=0, ind_tp='\t'):
 	out = io.StringIO()
 	gen = sciface.CodeGen(out, ind_lvl, ind_tp)
+	base = min(int(event.value) for event in iface.events)
+	names = [ None for x in range(max(int(event.value) for event in iface.events) - base + 1) ]
+	for event in iface.events:
+		names[int(event.value) - base] = 'SCN_' + event.name.replace('_', '').upper()
+	gen.iwriteln('constexpr unsigned int notification_code_base = %d;' % base)
+	gen.iwriteln('constexpr const char *notification_names[%d]' % len(names))
+	gen.iwriteln('{')
+	gen.indent()
+	for name in names:
+		gen.iwriteln('"%s",' % name if name else 'nullptr,')
+	gen.unindent()
+	gen.iwriteln('};')
+	return out.getvalue().rstrip()
+
+def style_array_name(lexer):
+	return 'styles_%s' % lexer.name.lower()
+
+def lexer_style_count(lexer):
+	if len(lexer.styles) == 0:
+		return 1
+	return max(style.value for style in lexer.styles) + 1
+
+def gen_lexer_tables(iface, ind_lvl=0, ind_tp='\t'):
+	out = io.StringIO()
+	gen = sciface.CodeGen(out, ind_lvl, ind_tp)
+
 	for lexer in iface.lexers:
-		if len(lexer.styles) > 0:
-			max_style = max(style.value for style in lexer.styles)
-		else:
-			max_style = 0
-		style_names = [ 'nullptr' for x in range(0, max_style+1) ]
+		style_names = [ 'nullptr' for x in range(lexer_style_count(lexer)) ]
 		for style in lexer.styles:
 			style_names[style.value] = '"%s"' % style.name.lower()
-		gen.iwriteln('static const char *%s_styles[%d]' % (lexer.name.lower(), max_style+2))
+		gen.iwriteln('constexpr const char *%s[%d]' % (style_array_name(lexer), len(style_names) + 1))
 		gen.iwriteln('{')
 		gen.indent()
 		for name in style_names:
@@ -164,24 +289,57 @@ def gen_lexer_style_defs(iface, ind_lvl=0, ind_tp='\t'):
 		gen.unindent()
 		gen.iwriteln('};')
 		gen.iwriteln()
-	return out.getvalue().rstrip() + '\n'
 
-def gen_lexer_style_refs(iface, ind_lvl=0, ind_tp='\t'):
 	max_lex = max(lex.value for lex in iface.lexers)
-	lexer_counts = [ 0 for x in range(0, max_lex+1) ]
-	lexer_names = [ 'nullptr' for x in range(0, max_lex+1) ]
+	entries = [ '{ nullptr, 0, nullptr },' for x in range(max_lex + 1) ]
 	for lexer in iface.lexers:
-		if len(lexer.styles) > 0:
-			max_style = max(style.value for style in lexer.styles)
-		else:
-			max_style = 0
-		lexer_counts[lexer.value] = max_style+1
-		lexer_names[lexer.value] = lexer.name.lower() + '_styles'
+		entries[lexer.value] = '{ "%s", %d, %s },' % (lexer.name,
+			lexer_style_count(lexer), style_array_name(lexer))
+	gen.iwriteln('constexpr LexerInfo lexers[%d]' % len(entries))
+	gen.iwriteln('{')
+	gen.indent()
+	for entry in entries:
+		gen.iwriteln(entry)
+	gen.unindent()
+	gen.iwriteln('};')
+	return out.getvalue().rstrip()
+
+def gen_name_hashes(iface, ind_lvl=0, ind_tp='\t'):
 	out = io.StringIO()
 	gen = sciface.CodeGen(out, ind_lvl, ind_tp)
-	for i in range(0, max_lex+1):
-		gen.iwriteln('{ %d, %s },' % (lexer_counts[i], lexer_names[i]))
-	return out.getvalue()
+
+	lexers = sorted(iface.lexers, key=lambda l: l.value)
+	displace, slots = perfect_hash([ name_hashes(lex.name) for lex in lexers ])
+	slots = [ lexers[i].value if i >= 0 else -1 for i in slots ]
+	write_int_array(gen, 'constexpr uint32_t lexer_hash_displace', displace)
+	gen.iwriteln()
+	write_int_array(gen, 'constexpr int16_t lexer_hash_slots', slots)
+	gen.iwriteln()
+
+	# HTML and XML repeat names for each embedded language's styles,
+	# only the first style of a name can be looked up
+	styles = []
+	seen = set()
+	for lexer in lexers:
+		for style in sorted(lexer.styles, key=lambda s: s.value):
+			key = (lexer.value, style.name.lower())
+			if key not in seen:
+				seen.add(key)
+				styles.append((lexer.value, style.name.lower(), style.value))
+	displace, slots = perfect_hash([ name_hashes(name, (lex * LEXER_MIX) & 0xFFFFFFFF)
+		for lex, name, value in styles ])
+	gen.iwriteln('constexpr StyleName style_names[%d]' % len(styles))
+	gen.iwriteln('{')
+	gen.indent()
+	for lex, name, value in styles:
+		gen.iwriteln('{ %d, %d, "%s" },' % (lex, value, name))
+	gen.unindent()
+	gen.iwriteln('};')
+	gen.iwriteln()
+	write_int_array(gen, 'constexpr uint32_t style_hash_displace', displace)
+	gen.iwriteln()
+	write_int_array(gen, 'constexpr int16_t style_hash_slots', slots)
+	return out.getvalue().rstrip()
 
 def write_if_diff(text, outfn):
 	if outfn == '-':
@@ -326,16 +484,24 @@ def main(args):
 	text = '// This file is auto-generated, do not edit.\n'
 	with open(template) as f:
 		text += f.read()
-	text = text.replace('/*@@enums@@*/', gen_enums(iface, 1))
-	text = text.replace('/*@@lexer_names@@*/', gen_sparse_lexer_names(iface, 2))
-	text = text.replace('/*@@lexer_style_defs@@*/', gen_lexer_style_defs(iface, 1))
-	text = text.replace('/*@@lexer_style_refs@@*/', gen_lexer_style_refs(iface, 2))
-	text = text.replace('/*@@methods@@*/', gen_functions(iface, 2))
-	text = text.replace('/*@@constant_undefs@@*/', gen_constant_undefs(iface))
-	text = text.replace('/*@@constant_decls@@*/', gen_constant_decls(iface, 2))
-	text = text.replace('/*@@properties@@*/', gen_properties(iface, 2))
-	text = text.replace('/*@@signals@@*/', gen_signals(iface, 2))
-	text = text.replace('/*@@signal_accessors@@*/', gen_signal_accessors(iface, 2))
+	generators = [
+		('enums', lambda: gen_enums(iface, 1)),
+		('message_table', lambda: gen_message_table(iface, 2)),
+		('notification_table', lambda: gen_notification_table(iface, 2)),
+		('lexer_tables', lambda: gen_lexer_tables(iface, 2)),
+		('name_hashes', lambda: gen_name_hashes(iface, 2)),
+		('methods', lambda: gen_functions(iface, 2)),
+		('constant_undefs', lambda: gen_constant_undefs(iface)),
+		('constant_decls', lambda: gen_constant_decls(iface, 2)),
+		('properties', lambda: gen_properties(iface, 2)),
+		('signals', lambda: gen_signals(iface, 2)),
+		('signal_accessors', lambda: gen_signal_accessors(iface, 2)),
+	]
+	# only generate what the template uses
+	for name, func in generators:
+		placeholder = '/*@@%s@@*/' % name
+		if placeholder in text:
+			text = text.replace(placeholder, func())
 
 	write_if_diff(text, out_fn)
 